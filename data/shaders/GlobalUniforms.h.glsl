@@ -12,6 +12,8 @@
 #define CULL_PRIMITIVE_SMALL    (1 << 4)
 #define CULL_PRIMITIVE_VSM      (1 << 5)
 #define USE_HASHED_TRANSPARENCY (1 << 6)
+#define USE_MESHLET_LOD         (1 << 7)
+#define CULL_MESHLET_BACKFACE   (1 << 8)
 
 //layout (binding = 0, std140) uniform PerFrameUniformsBuffer
 FVOG_DECLARE_STORAGE_BUFFERS(restrict readonly PerFrameUniformsBuffer)
@@ -28,6 +30,8 @@ FVOG_DECLARE_STORAGE_BUFFERS(restrict readonly PerFrameUniformsBuffer)
   float bindlessSamplerLodBias;
   uint flags;
   float alphaHashScale;
+  float lodErrorThreshold;
+  float lodProjectionScale;
 } perFrameUniformsBuffers[];
 
 #endif // GLOBAL_UNIFORMS_H
\ No newline at end of file
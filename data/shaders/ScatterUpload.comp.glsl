@@ -0,0 +1,34 @@
+#include "ScatterUpload.shared.h"
+
+FVOG_DECLARE_STORAGE_BUFFERS(restrict readonly UploadBuffers)
+{
+  uint words[];
+} uploadBuffers[];
+
+FVOG_DECLARE_STORAGE_BUFFERS(restrict writeonly DstBuffers)
+{
+  uint words[];
+} dstBuffers[];
+
+#define d_upload uploadBuffers[uploadBuffer.bufIdx]
+
+// Each workgroup copies whole records, so the destination buffer index is uniform across it
+layout(local_size_x = 64) in;
+void main()
+{
+  const uint payloadBase = recordCount * SCATTER_UPLOAD_RECORD_WORDS;
+
+  for (uint recordIndex = gl_WorkGroupID.x; recordIndex < recordCount; recordIndex += gl_NumWorkGroups.x)
+  {
+    const uint recordBase = recordIndex * SCATTER_UPLOAD_RECORD_WORDS;
+    const uint dstBuffer  = d_upload.words[recordBase + 0];
+    const uint dstOffset  = d_upload.words[recordBase + 1];
+    const uint srcOffset  = d_upload.words[recordBase + 2] + payloadBase;
+    const uint wordCount  = d_upload.words[recordBase + 3];
+
+    for (uint i = gl_LocalInvocationIndex; i < wordCount; i += gl_WorkGroupSize.x)
+    {
+      dstBuffers[dstBuffer].words[dstOffset + i] = d_upload.words[srcOffset + i];
+    }
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef SCATTER_UPLOAD_H
+#define SCATTER_UPLOAD_H
+
+#include "Resources.h.glsl"
+
+// Offsets and sizes are in 32-bit words, which every structure uploaded this way is made of
+#define SCATTER_UPLOAD_RECORD_WORDS 4
+
+// Large uploads are split into records of at most this many words so they are spread across workgroups
+#define SCATTER_UPLOAD_MAX_RECORD_WORDS 4096
+
+#ifdef __cplusplus
+namespace shared {
+#endif
+
+struct ScatterUploadRecord
+{
+  Buffer dstBuffer;
+  FVOG_UINT32 dstWordOffset;
+  FVOG_UINT32 srcWordOffset; // Relative to the first word after the records
+  FVOG_UINT32 wordCount;
+};
+
+FVOG_DECLARE_ARGUMENTS(ScatterUploadArguments)
+{
+  // Holds recordCount records, followed by their payloads
+  Buffer uploadBuffer;
+  FVOG_UINT32 recordCount;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCATTER_UPLOAD_H
@@ -317,23 +317,48 @@ HitSurfaceParameters GetHitSurfaceParameters(rayQueryEXT rayQuery)
   const int primitiveId = rayQueryGetIntersectionPrimitiveIndexEXT(rayQuery, true);
   const int instanceId = rayQueryGetIntersectionInstanceCustomIndexEXT(rayQuery, true);
   ObjectUniforms obj = TransformBuffers[NonUniformIndex(shadingUniforms.instanceBufferIndex)].transforms[instanceId];
-  const Vertex v0 = obj.vertexBuffer.vertices[obj.indexBuffer.indices[primitiveId * 3 + 0]];
-  const Vertex v1 = obj.vertexBuffer.vertices[obj.indexBuffer.indices[primitiveId * 3 + 1]];
-  const Vertex v2 = obj.vertexBuffer.vertices[obj.indexBuffer.indices[primitiveId * 3 + 2]];
+  // BLASes are built from the triangles of the full-detail meshlets, in order. Find the last meshlet whose first triangle is at or before the hit.
+  const uint geometryBufferIndex = shadingUniforms.instanceBufferIndex;
+  uint first = 0;
+  uint last = obj.baseMeshletCount - 1;
+  while (first < last)
+  {
+    const uint middle = (first + last + 1) / 2;
+    if (MeshletIndexBuffers[geometryBufferIndex].indices[obj.blasMeshletStartsOffset + middle] <= uint(primitiveId))
+    {
+      first = middle;
+    }
+    else
+    {
+      last = middle - 1;
+    }
+  }
+  const uint meshletPrimitive = uint(primitiveId) - MeshletIndexBuffers[geometryBufferIndex].indices[obj.blasMeshletStartsOffset + first];
+  const Meshlet meshlet = MeshletDataBuffers[geometryBufferIndex].meshlets[obj.meshletOffset + first];
+  const uint primitiveOffset = meshlet.primitiveOffset + meshletPrimitive * 3;
+  const uint i0 = MeshletIndexBuffers[geometryBufferIndex].indices[meshlet.indexOffset + uint(MeshletPrimitiveBuffers[geometryBufferIndex].primitives[primitiveOffset + 0])];
+  const uint i1 = MeshletIndexBuffers[geometryBufferIndex].indices[meshlet.indexOffset + uint(MeshletPrimitiveBuffers[geometryBufferIndex].primitives[primitiveOffset + 1])];
+  const uint i2 = MeshletIndexBuffers[geometryBufferIndex].indices[meshlet.indexOffset + uint(MeshletPrimitiveBuffers[geometryBufferIndex].primitives[primitiveOffset + 2])];
+  const VertexAttributes v0 = obj.vertexBuffer.vertices[i0];
+  const VertexAttributes v1 = obj.vertexBuffer.vertices[i1];
+  const VertexAttributes v2 = obj.vertexBuffer.vertices[i2];
+  const vec3 p0 = DecodePosition(obj.positionBuffer.positions[i0]);
+  const vec3 p1 = DecodePosition(obj.positionBuffer.positions[i1]);
+  const vec3 p2 = DecodePosition(obj.positionBuffer.positions[i2]);
   
   const vec2 baryBC = rayQueryGetIntersectionBarycentricsEXT(rayQuery, true);
   const vec3 bary = vec3(1.0 - baryBC.x - baryBC.y, baryBC.x, baryBC.y);
 
   const vec3 smooth_normal_object = OctToVec3(unpackSnorm2x16(v0.normal)) * bary.x + OctToVec3(unpackSnorm2x16(v1.normal)) * bary.y + OctToVec3(unpackSnorm2x16(v2.normal)) * bary.z;
-  const vec3 position_object = PackedToVec3(v0.position) * bary.x + PackedToVec3(v1.position) * bary.y + PackedToVec3(v2.position) * bary.z;
-  const vec3 flat_normal_object = cross(PackedToVec3(v1.position) - PackedToVec3(v0.position), PackedToVec3(v2.position) - PackedToVec3(v0.position));
+  const vec3 position_object = p0 * bary.x + p1 * bary.y + p2 * bary.z;
+  const vec3 flat_normal_object = cross(p1 - p0, p2 - p0);
 #if 1 // Fetch model matrix manually
-  const mat3 world_from_object_normal = transpose(inverse(mat3(obj.modelCurrent)));
+  const mat3 world_from_object_normal = transpose(mat3(obj.objectFromWorld));
 #else // Fetch model matrix from ray query
   const mat3 world_from_object_normal = transpose(inverse(mat3(rayQueryGetIntersectionObjectToWorldEXT(rayQuery, true))));
 #endif
 
-  hit.texCoord = PackedToVec2(v0.uv) * bary.x + PackedToVec2(v1.uv) * bary.y + PackedToVec2(v2.uv) * bary.z;
+  hit.texCoord = LoadUv(obj, i0, v0.uv) * bary.x + LoadUv(obj, i1, v1.uv) * bary.y + LoadUv(obj, i2, v2.uv) * bary.z;
   hit.smoothNormalWorld = normalize(world_from_object_normal * smooth_normal_object);
   hit.flatNormalWorld = normalize(world_from_object_normal * flat_normal_object);
 #if 1 // Calculate world-space position manually
@@ -363,7 +388,7 @@ HitSurfaceParameters GetHitSurfaceParameters(rayQueryEXT rayQuery)
   hit.roughness = hit.material.roughnessFactor;
   if (bool(hit.material.flags & MATERIAL_HAS_METALLIC_ROUGHNESS))
   {
-    const vec2 metallicRoughnessSampled = textureLod(Fvog_sampler2D(hit.material.metallicRoughnessTextureIndex, nearestSamplerIndex), hit.texCoord, 0.0).rg;
+    const vec2 metallicRoughnessSampled = SwizzleMetallicRoughness(hit.material, textureLod(Fvog_sampler2D(hit.material.metallicRoughnessTextureIndex, nearestSamplerIndex), hit.texCoord, 0.0));
     hit.metallic *= metallicRoughnessSampled.x;
     hit.roughness *= metallicRoughnessSampled.y;
   }
@@ -14,10 +14,17 @@ FVOG_DECLARE_STORAGE_BUFFERS(ArgsBuffers)
 {
   mat4 clipFromWorld;
   mat4 worldFromObject;
+  PositionBuffer positionBuffer;
   VertexBuffer vertexBuffer;
+  TexcoordBuffer texcoordBuffer;
+  vec2 uvOffset;
+  vec2 uvScale;
   FVOG_UINT32 materialId;
   FVOG_UINT32 materialBufferIndex;
   FVOG_UINT32 samplerIndex;
+  FVOG_UINT32 fullPrecisionTexcoords;
+  FVOG_UINT32 geometryBufferIndex;
+  FVOG_UINT32 meshletOffset;
 }argsBuffers[];
 
 #define pc argsBuffers[argsBufferIndex]
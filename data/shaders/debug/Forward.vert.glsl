@@ -1,26 +1,21 @@
-#include "../Resources.h.glsl"
-#include "../Utility.h.glsl"
-
-struct Vertex
-{
-  vec3 position;
-  uint normal;
-  vec2 uv;
-};
-
-FVOG_DECLARE_BUFFER_REFERENCE(VertexBuffer)
-{
-  Vertex vertices[];
-};
+#define VISBUFFER_NO_PUSH_CONSTANTS
+#include "../visbuffer/VisbufferCommon.h.glsl"
 
 FVOG_DECLARE_STORAGE_BUFFERS(ArgsBuffers)
 {
   mat4 clipFromWorld;
   mat4 worldFromObject;
+  PositionBuffer positionBuffer;
   VertexBuffer vertexBuffer;
+  TexcoordBuffer texcoordBuffer;
+  vec2 uvOffset;
+  vec2 uvScale;
   FVOG_UINT32 materialId;
   FVOG_UINT32 materialBufferIndex;
   FVOG_UINT32 samplerIndex;
+  FVOG_UINT32 fullPrecisionTexcoords;
+  FVOG_UINT32 geometryBufferIndex;
+  FVOG_UINT32 meshletOffset;
 }argsBuffers[];
 
 FVOG_DECLARE_ARGUMENTS(DebugForwardArgs)
@@ -33,12 +28,27 @@ FVOG_DECLARE_ARGUMENTS(DebugForwardArgs)
 layout(location = 0) out vec2 o_uv;
 layout(location = 1) out vec3 o_normal;
 
+// Triangles are pulled from the full-detail meshlets, so this works whether or not the original index buffer was kept.
+// Each meshlet gets MAX_PRIMITIVES triangles' worth of vertices, and the ones past its last triangle are collapsed to a point.
 void main()
 {
-  Vertex vertex = pc.vertexBuffer.vertices[gl_VertexIndex];
-
-  o_uv = vertex.uv;
+  const uint corner = uint(gl_VertexIndex) % (MAX_PRIMITIVES * 3);
+  const Meshlet meshlet = MeshletDataBuffers[pc.geometryBufferIndex].meshlets[pc.meshletOffset + uint(gl_VertexIndex) / (MAX_PRIMITIVES * 3)];
+  if (corner >= meshlet.primitiveCount * 3)
+  {
+    gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+    return;
+  }
+
+  const uint primitive = uint(MeshletPrimitiveBuffers[pc.geometryBufferIndex].primitives[meshlet.primitiveOffset + corner]);
+  const uint index = MeshletIndexBuffers[pc.geometryBufferIndex].indices[meshlet.indexOffset + primitive];
+
+  const QuantizedPosition quantizedPosition = pc.positionBuffer.positions[index];
+  const VertexAttributes vertex = pc.vertexBuffer.vertices[index];
+  const vec3 position = DecodePosition(quantizedPosition);
+
+  o_uv = pc.fullPrecisionTexcoords != 0 ? pc.texcoordBuffer.texcoords[index] : DecodeUv(vertex.uv, pc.uvOffset, pc.uvScale);
   o_normal = OctToVec3(unpackSnorm2x16(vertex.normal));
 
-  gl_Position = pc.clipFromWorld * pc.worldFromObject * vec4(vertex.position, 1.0);
+  gl_Position = pc.clipFromWorld * pc.worldFromObject * vec4(position, 1.0);
 }
\ No newline at end of file
@@ -22,12 +22,12 @@ void main()
 
   const uint primitive = uint(d_primitives[primitiveOffset + primitiveId]);
   const uint index = d_indices[indexOffset + primitive];
-  const Vertex vertex = d_vertices[vertexOffset + index];
-  const vec3 position = PackedToVec3(vertex.position);
-  const mat4 transform = d_transforms[instanceId].modelCurrent;
+  const vec3 position = DecodePosition(d_positions[vertexOffset + index]);
+  const ObjectUniforms obj = d_transforms[instanceId];
+  const mat4 transform = obj.modelCurrent;
 
-  v_materialId = d_transforms[instanceId].materialId;
-  v_uv = PackedToVec2(vertex.uv);
+  v_materialId = obj.materialId;
+  v_uv = LoadUv(obj, meshlet.attributeOffset - obj.attributeOffset + index, d_attributes[meshlet.attributeOffset + index].uv);
   i_objectSpacePos = position;
   gl_Position = d_currentView.viewProj * transform * vec4(position, 1.0);
 }
\ No newline at end of file
@@ -207,6 +207,58 @@ bool CullMeshletFrustum(uint meshletInstanceId, View view)
   return true;
 }
 
+// Projects the error of a meshlet's LOD to pixels, relative to the main camera.
+// The same camera is used for every view so that shadows are cast by the geometry that is seen.
+float GetProjectedLodError(vec4 bounds, float error, mat4 transform)
+{
+  const float scale = max(max(length(transform[0].xyz), length(transform[1].xyz)), length(transform[2].xyz));
+  const vec3 center = vec3(transform * vec4(bounds.xyz, 1.0));
+  const float distance = max(length(center - d_perFrameUniforms.cameraPos.xyz) - bounds.w * scale, 1e-4);
+  return error * scale / distance * d_perFrameUniforms.lodProjectionScale;
+}
+
+// Since siblings share their parent's bounds and error, exactly one level of the hierarchy passes this test anywhere on the mesh.
+bool IsMeshletLodSelected(uint meshletInstanceId)
+{
+  const MeshletInstance meshletInstance = d_meshletInstances[meshletInstanceId];
+  const Meshlet meshlet = d_meshlets[meshletInstance.meshletId];
+  const mat4 transform = d_transforms[meshletInstance.instanceId].modelCurrent;
+
+  // With a threshold of zero, only meshlets that weren't simplified (or were simplified without error) are selected
+  const float threshold = (d_perFrameUniforms.flags & USE_MESHLET_LOD) != 0 ? d_perFrameUniforms.lodErrorThreshold : 0.0;
+
+  return GetProjectedLodError(PackedToVec4(meshlet.lodBounds), meshlet.lodError, transform) <= threshold &&
+    GetProjectedLodError(PackedToVec4(meshlet.parentLodBounds), meshlet.parentLodError, transform) > threshold;
+}
+
+// Returns false if every triangle in the meshlet faces away from the view.
+// The test is done in object space, where the normal cone was computed, so non-uniform scale is handled.
+// Only the main view is tested. Back faces of single-sided casters still cast shadows, so culling them from shadow views would make thin geometry leak light.
+bool CullMeshletBackface(uint meshletInstanceId, View view)
+{
+  if (view.type != VIEW_TYPE_MAIN)
+  {
+    return true;
+  }
+
+  const MeshletInstance meshletInstance = d_meshletInstances[meshletInstanceId];
+  const Meshlet meshlet = d_meshlets[meshletInstance.meshletId];
+  const ObjectUniforms obj = d_transforms[meshletInstance.instanceId];
+  if ((d_materials[obj.materialId].flags & MATERIAL_IS_DOUBLE_SIDED) != 0)
+  {
+    return true;
+  }
+
+  const vec4 cone = unpackSnorm4x8(meshlet.coneAxisCutoff);
+  const vec3 aabbMin = PackedToVec3(meshlet.aabbMin);
+  const vec3 aabbMax = PackedToVec3(meshlet.aabbMax);
+  const vec3 center = (aabbMin + aabbMax) / 2.0;
+  const float radius = length(aabbMax - aabbMin) / 2.0;
+  const vec3 cameraPos = vec3(obj.objectFromWorld * vec4(view.cameraPos.xyz, 1.0));
+  const vec3 cameraToCenter = center - cameraPos;
+  return dot(cameraToCenter, cone.xyz) < cone.w * length(cameraToCenter) + radius;
+}
+
 layout (local_size_x = 128) in;
 void main()
 {
@@ -217,7 +269,15 @@ void main()
     return;
   }
 
-  const MeshletInstance meshletInstance = d_meshletInstances[meshletInstanceId];
+  if (!IsMeshletLodSelected(meshletInstanceId))
+  {
+    return;
+  }
+
+  if ((d_perFrameUniforms.flags & CULL_MESHLET_BACKFACE) != 0 && !CullMeshletBackface(meshletInstanceId, d_currentView))
+  {
+    return;
+  }
 
   if ((d_perFrameUniforms.flags & CULL_MESHLET_FRUSTUM) == 0 || CullMeshletFrustum(meshletInstanceId, d_currentView))
   {
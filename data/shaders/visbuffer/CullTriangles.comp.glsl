@@ -90,7 +90,6 @@ bool CullTriangle(Meshlet meshlet, uint localId)
 
   const uint primitiveId = localId * 3;
 
-  // TODO: SoA vertices
   const uint vertexOffset = meshlet.vertexOffset;
   const uint indexOffset = meshlet.indexOffset;
   const uint primitiveOffset = meshlet.primitiveOffset;
@@ -100,12 +99,9 @@ bool CullTriangle(Meshlet meshlet, uint localId)
   const uint index0 = d_indices[indexOffset + primitive0];
   const uint index1 = d_indices[indexOffset + primitive1];
   const uint index2 = d_indices[indexOffset + primitive2];
-  const Vertex vertex0 = d_vertices[vertexOffset + index0];
-  const Vertex vertex1 = d_vertices[vertexOffset + index1];
-  const Vertex vertex2 = d_vertices[vertexOffset + index2];
-  const vec3 position0 = PackedToVec3(vertex0.position);
-  const vec3 position1 = PackedToVec3(vertex1.position);
-  const vec3 position2 = PackedToVec3(vertex2.position);
+  const vec3 position0 = DecodePosition(d_positions[vertexOffset + index0]);
+  const vec3 position1 = DecodePosition(d_positions[vertexOffset + index1]);
+  const vec3 position2 = DecodePosition(d_positions[vertexOffset + index2]);
   const vec4 posClip0 = sh_mvp * vec4(position0, 1.0);
   const vec4 posClip1 = sh_mvp * vec4(position1, 1.0);
   const vec4 posClip2 = sh_mvp * vec4(position2, 1.0);
@@ -21,16 +21,16 @@ void main()
   
   const uint primitive = uint(d_primitives[primitiveOffset + primitiveId]);
   const uint index = d_indices[indexOffset + primitive];
-  const Vertex vertex = d_vertices[vertexOffset + index];
-  const vec3 position = PackedToVec3(vertex.position);
-  const mat4 transform = d_transforms[instanceId].modelCurrent;
-  const vec2 uv = PackedToVec2(vertex.uv);
+  const vec3 position = DecodePosition(d_positions[vertexOffset + index]);
+  const ObjectUniforms obj = d_transforms[instanceId];
+  const mat4 transform = obj.modelCurrent;
+  const vec2 uv = LoadUv(obj, meshlet.attributeOffset - obj.attributeOffset + index, d_attributes[meshlet.attributeOffset + index].uv);
   
   o_visibleMeshletId = visibleMeshletId;
   o_primitiveId = primitiveId / 3;
   o_uv = uv;
   o_objectSpacePos = position;
-  o_materialId = d_transforms[instanceId].materialId;
+  o_materialId = obj.materialId;
 
   gl_Position = d_perFrameUniforms.viewProj * transform * vec4(position, 1.0);
 }
\ No newline at end of file
@@ -19,25 +19,35 @@
 #define MESHLET_MATERIAL_ID_MASK ((1u << MESHLET_MATERIAL_ID_BITS) - 1u)
 #define MESHLET_PRIMITIVE_MASK ((1u << MESHLET_PRIMITIVE_BITS) - 1u)
 
-#define MATERIAL_HAS_BASE_COLOR         (1u << 0u)
-#define MATERIAL_HAS_METALLIC_ROUGHNESS (1u << 1u)
-#define MATERIAL_HAS_NORMAL             (1u << 2u)
-#define MATERIAL_HAS_OCCLUSION          (1u << 3u)
-#define MATERIAL_HAS_EMISSION           (1u << 4u)
+#define MATERIAL_HAS_BASE_COLOR           (1u << 0u)
+#define MATERIAL_HAS_METALLIC_ROUGHNESS   (1u << 1u)
+#define MATERIAL_HAS_NORMAL               (1u << 2u)
+#define MATERIAL_HAS_OCCLUSION            (1u << 3u)
+#define MATERIAL_HAS_EMISSION             (1u << 4u)
+#define MATERIAL_IS_DOUBLE_SIDED          (1u << 5u)
+#define MATERIAL_METALLIC_ROUGHNESS_IN_RG (1u << 6u)
 
 #define VIEW_TYPE_MAIN    (0)
 #define VIEW_TYPE_VIRTUAL (1)
 
-struct Vertex
+// Vertices are split into two streams so that passes which only need positions don't have to fetch anything else.
+// Positions are snorm16 relative to the bounds of their mesh. ObjectUniforms::modelCurrent/modelPrevious map them back to world space.
+struct QuantizedPosition
+{
+  uint xy; // Decode with DecodePosition
+  uint z; // High 16 bits are padding
+};
+
+struct VertexAttributes
 {
-  PackedVec3 position;
   uint normal; // Octahedral encoding: decode with unpackSnorm2x16 and OctToFloat32x3
-  PackedVec2 uv;
+  uint uv; // unorm16x2 relative to the texcoord range of the mesh: read with LoadUv
 };
 
 struct Meshlet
 {
   uint vertexOffset;
+  uint attributeOffset;
   uint indexOffset;
   uint primitiveOffset;
   uint indexCount;
@@ -45,6 +55,11 @@ struct Meshlet
   //uint instanceId;
   PackedVec3 aabbMin;
   PackedVec3 aabbMax;
+  PackedVec4 lodBounds;
+  float lodError;
+  PackedVec4 parentLodBounds;
+  float parentLodError;
+  uint coneAxisCutoff; // Decode with unpackSnorm4x8
 };
 
 struct MeshletInstance
@@ -152,12 +167,19 @@ FVOG_DECLARE_STORAGE_BUFFERS(restrict readonly MeshletPrimitiveBuffer)
 #define d_primitives MeshletPrimitiveBuffers[meshletPrimitivesIndex].primitives
 
 //layout (std430, binding = 2) restrict readonly buffer MeshletVertexBuffer
-FVOG_DECLARE_STORAGE_BUFFERS(restrict readonly MeshletVertexBuffer)
+FVOG_DECLARE_STORAGE_BUFFERS(restrict readonly MeshletPositionBuffer)
+{
+  QuantizedPosition positions[];
+}MeshletPositionBuffers[];
+
+// Both streams live in the same buffer
+FVOG_DECLARE_STORAGE_BUFFERS(restrict readonly MeshletAttributeBuffer)
 {
-  Vertex vertices[];
-}MeshletVertexBuffers[];
+  VertexAttributes attributes[];
+}MeshletAttributeBuffers[];
 
-#define d_vertices MeshletVertexBuffers[meshletVerticesIndex].vertices
+#define d_positions MeshletPositionBuffers[meshletVerticesIndex].positions
+#define d_attributes MeshletAttributeBuffers[meshletVerticesIndex].attributes
 
 //layout (std430, binding = 3) restrict readonly buffer MeshletIndexBuffer
 FVOG_DECLARE_STORAGE_BUFFERS(restrict readonly MeshletIndexBuffer)
@@ -167,26 +189,66 @@ FVOG_DECLARE_STORAGE_BUFFERS(restrict readonly MeshletIndexBuffer)
 
 #define d_indices MeshletIndexBuffers[meshletIndicesIndex].indices
 
+layout(buffer_reference, scalar, buffer_reference_align = 4) buffer PositionBuffer
+{
+  QuantizedPosition positions[];
+};
+
 layout(buffer_reference, scalar, buffer_reference_align = 4) buffer VertexBuffer
 {
-  Vertex vertices[];
+  VertexAttributes vertices[];
 };
 
-layout(buffer_reference, scalar, buffer_reference_align = 4) buffer IndexBuffer
+// Texcoords of meshes whose texcoord range is too wide to quantize (e.g. tiled terrain)
+layout(buffer_reference, scalar, buffer_reference_align = 4) buffer TexcoordBuffer
 {
-  uint indices[];
+  vec2 texcoords[];
 };
 
 struct ObjectUniforms
 {
   mat4 modelPrevious;
   mat4 modelCurrent;
+  mat4 objectFromWorld; // Inverse of modelCurrent
+  PositionBuffer positionBuffer;
   VertexBuffer vertexBuffer;
-  IndexBuffer indexBuffer;
+  TexcoordBuffer texcoordBuffer; // Only valid if fullPrecisionTexcoords != 0
+  uint meshletOffset;
+  uint attributeOffset;
   uint materialId;
-  uint _padding[3];
+  uint fullPrecisionTexcoords;
+  vec2 uvOffset;
+  vec2 uvScale;
+  uint baseMeshletCount;
+  uint blasMeshletStartsOffset; // Index into the geometry buffer as uints of each full-detail meshlet's first BLAS primitive
 };
 
+vec3 DecodePosition(QuantizedPosition position)
+{
+  return vec3(unpackSnorm2x16(position.xy), unpackSnorm2x16(position.z).x);
+}
+
+vec2 DecodeUv(uint uv, vec2 uvOffset, vec2 uvScale)
+{
+  return uvOffset + unpackUnorm2x16(uv) * uvScale;
+}
+
+// vertexIndex is relative to the object's geometry, and packedUv is VertexAttributes::uv of that vertex
+vec2 LoadUv(ObjectUniforms obj, uint vertexIndex, uint packedUv)
+{
+  if (obj.fullPrecisionTexcoords != 0)
+  {
+    return obj.texcoordBuffer.texcoords[vertexIndex];
+  }
+  return DecodeUv(packedUv, obj.uvOffset, obj.uvScale);
+}
+
+// Returns (metallic, roughness). glTF stores metallic in B and roughness in G, but two-channel images have them moved to G and R.
+vec2 SwizzleMetallicRoughness(GpuMaterial material, vec4 texel)
+{
+  return bool(material.flags & MATERIAL_METALLIC_ROUGHNESS_IN_RG) ? texel.gr : texel.bg;
+}
+
 //layout (std430, binding = 4) restrict readonly buffer TransformBuffer
 FVOG_DECLARE_STORAGE_BUFFERS(restrict readonly TransformBuffer)
 {
@@ -96,27 +96,28 @@ uint[3] VisbufferLoadIndexIds(in Meshlet meshlet, in uint primitiveId)
 vec3[3] VisbufferLoadPosition(in uint[3] indexIds, in uint vertexOffset)
 {
   return vec3[3](
-    PackedToVec3(d_vertices[vertexOffset + indexIds[0]].position),
-    PackedToVec3(d_vertices[vertexOffset + indexIds[1]].position),
-    PackedToVec3(d_vertices[vertexOffset + indexIds[2]].position)
+    DecodePosition(d_positions[vertexOffset + indexIds[0]]),
+    DecodePosition(d_positions[vertexOffset + indexIds[1]]),
+    DecodePosition(d_positions[vertexOffset + indexIds[2]])
   );
 }
 
-vec2[3] VisbufferLoadUv(in uint[3] indexIds, in uint vertexOffset)
+vec2[3] VisbufferLoadUv(in uint[3] indexIds, in uint attributeOffset, in ObjectUniforms obj)
 {
+  const uint geometryOffset = attributeOffset - obj.attributeOffset;
   return vec2[3](
-    PackedToVec2(d_vertices[vertexOffset + indexIds[0]].uv),
-    PackedToVec2(d_vertices[vertexOffset + indexIds[1]].uv),
-    PackedToVec2(d_vertices[vertexOffset + indexIds[2]].uv)
+    LoadUv(obj, geometryOffset + indexIds[0], d_attributes[attributeOffset + indexIds[0]].uv),
+    LoadUv(obj, geometryOffset + indexIds[1], d_attributes[attributeOffset + indexIds[1]].uv),
+    LoadUv(obj, geometryOffset + indexIds[2], d_attributes[attributeOffset + indexIds[2]].uv)
   );
 }
 
-vec3[3] VisbufferLoadNormal(in uint[3] indexIds, in uint vertexOffset)
+vec3[3] VisbufferLoadNormal(in uint[3] indexIds, in uint attributeOffset)
 {
   return vec3[3](
-    OctToVec3(unpackSnorm2x16(d_vertices[vertexOffset + indexIds[0]].normal)),
-    OctToVec3(unpackSnorm2x16(d_vertices[vertexOffset + indexIds[1]].normal)),
-    OctToVec3(unpackSnorm2x16(d_vertices[vertexOffset + indexIds[2]].normal))
+    OctToVec3(unpackSnorm2x16(d_attributes[attributeOffset + indexIds[0]].normal)),
+    OctToVec3(unpackSnorm2x16(d_attributes[attributeOffset + indexIds[1]].normal)),
+    OctToVec3(unpackSnorm2x16(d_attributes[attributeOffset + indexIds[2]].normal))
   );
 }
 
@@ -191,11 +192,9 @@ vec2 SampleMetallicRoughness(in GpuMaterial material, in UvGradient uvGrad)
   {
     return metallicRoughnessFactor;
   }
-  // Metallic is stored in the B channel
-  // Roughness is stored in the G channel
   return
     metallicRoughnessFactor *
-    textureGrad(Fvog_sampler2D(material.metallicRoughnessTextureIndex, materialSamplerIndex), uvGrad.uv, uvGrad.ddx, uvGrad.ddy).bg;
+    SwizzleMetallicRoughness(material, textureGrad(Fvog_sampler2D(material.metallicRoughnessTextureIndex, materialSamplerIndex), uvGrad.uv, uvGrad.ddx, uvGrad.ddy));
 }
 
 float SampleOcclusion(in GpuMaterial material, in UvGradient uvGrad)
@@ -244,14 +243,15 @@ void main()
   const uint primitiveId = payload & MESHLET_PRIMITIVE_MASK;
   const MeshletInstance meshletInstance = d_meshletInstances[meshletInstanceId];
   const Meshlet meshlet = d_meshlets[meshletInstance.meshletId];
-  const GpuMaterial material = d_materials[d_transforms[meshletInstance.instanceId].materialId];
-  const mat4 transform = d_transforms[meshletInstance.instanceId].modelCurrent;
-  const mat4 transformPrevious = d_transforms[meshletInstance.instanceId].modelPrevious;
+  const ObjectUniforms obj = d_transforms[meshletInstance.instanceId];
+  const GpuMaterial material = d_materials[obj.materialId];
+  const mat4 transform = obj.modelCurrent;
+  const mat4 transformPrevious = obj.modelPrevious;
 
   const uint[] indexIDs = VisbufferLoadIndexIds(meshlet, primitiveId);
   const vec3[] rawPosition = VisbufferLoadPosition(indexIDs, meshlet.vertexOffset);
-  const vec2[] rawUv = VisbufferLoadUv(indexIDs, meshlet.vertexOffset);
-  const vec3[] rawNormal = VisbufferLoadNormal(indexIDs, meshlet.vertexOffset);
+  const vec2[] rawUv = VisbufferLoadUv(indexIDs, meshlet.attributeOffset, obj);
+  const vec3[] rawNormal = VisbufferLoadNormal(indexIDs, meshlet.attributeOffset);
   const vec4[] worldPosition = vec4[](
     transform * vec4(rawPosition[0], 1.0),
     transform * vec4(rawPosition[1], 1.0),
@@ -1,5 +1,6 @@
 #pragma once
 #include "Fvog/Device.h"
+#include "Paths.h"
 #include <VkBootstrap.h>
 
 #include <cstddef>
@@ -139,8 +140,3 @@ private:
   bool graveHeldLastFrame = false;
   bool swapchainOk = true;
 };
-
-std::filesystem::path GetAssetDirectory();
-std::filesystem::path GetShaderDirectory();
-std::filesystem::path GetTextureDirectory();
-std::filesystem::path GetConfigDirectory();
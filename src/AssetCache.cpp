@@ -0,0 +1,172 @@
+#include "AssetCache.h"
+#include "Paths.h"
+
+#include <tracy/Tracy.hpp>
+
+#include <array>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace Utility::AssetCache
+{
+  namespace
+  {
+    constexpr uint64_t prime1 = 0x9E3779B97F4A7C15ull;
+    constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+
+    // MurmurHash3 finalizer
+    uint64_t Avalanche(uint64_t h)
+    {
+      h ^= h >> 33;
+      h *= 0xFF51AFD7ED558CCDull;
+      h ^= h >> 33;
+      h *= 0xC4CEB9FE1A85EC53ull;
+      h ^= h >> 33;
+      return h;
+    }
+
+    uint64_t Round(uint64_t h, uint64_t word)
+    {
+      h ^= std::rotl(word * prime2, 31) * prime1;
+      return std::rotl(h, 27) * prime1 + 0x52DCE729;
+    }
+
+    std::size_t PaddingFor(std::size_t size)
+    {
+      return (sectionAlignment - size % sectionAlignment) % sectionAlignment;
+    }
+  } // namespace
+
+  uint64_t Hash(std::span<const std::byte> data, uint64_t seed)
+  {
+    uint64_t h = seed ^ (data.size() * prime1);
+
+    const auto* p    = data.data();
+    const auto words = data.size() / sizeof(uint64_t);
+    for (size_t i = 0; i < words; i++)
+    {
+      uint64_t word;
+      std::memcpy(&word, p + i * sizeof(uint64_t), sizeof(uint64_t));
+      h = Round(h, word);
+    }
+
+    if (const auto tail = data.size() % sizeof(uint64_t); tail != 0)
+    {
+      uint64_t word = 0;
+      std::memcpy(&word, p + words * sizeof(uint64_t), tail);
+      h = Round(h, word);
+    }
+
+    return Avalanche(h);
+  }
+
+  std::filesystem::path GetEntryPath(std::string_view category, uint64_t key)
+  {
+    char name[17]{};
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return GetCacheDirectory() / category / name;
+  }
+
+  bool WriteEntry(std::string_view category, uint64_t key, std::span<const std::span<const std::byte>> sections)
+  {
+    ZoneScoped;
+    const auto path = GetEntryPath(category, key);
+
+    auto ec = std::error_code();
+    std::filesystem::create_directories(path.parent_path(), ec);
+    if (ec)
+    {
+      return false;
+    }
+
+    // Unique per thread so that concurrent loaders writing the same entry don't clobber each other's temporary files
+    auto tempPath = path;
+    tempPath += "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+
+    {
+      auto file = std::ofstream(tempPath, std::ofstream::binary | std::ofstream::trunc);
+      if (!file.is_open())
+      {
+        return false;
+      }
+
+      constexpr auto zeros = std::array<char, sectionAlignment>{};
+      for (auto section : sections)
+      {
+        file.write(reinterpret_cast<const char*>(section.data()), static_cast<std::streamsize>(section.size()));
+        file.write(zeros.data(), static_cast<std::streamsize>(PaddingFor(section.size())));
+      }
+
+      if (!file.good())
+      {
+        file.close();
+        std::filesystem::remove(tempPath, ec);
+        return false;
+      }
+    }
+
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec)
+    {
+      std::filesystem::remove(tempPath, ec);
+      return false;
+    }
+
+    return true;
+  }
+
+  EntryReader::EntryReader(std::string_view category, uint64_t key)
+    : path_(GetEntryPath(category, key)),
+      file_(path_, std::ifstream::binary)
+  {
+    auto ec = std::error_code();
+    size_   = std::filesystem::file_size(path_, ec);
+    if (ec)
+    {
+      file_.close();
+    }
+  }
+
+  bool EntryReader::ReadSection(std::span<std::byte> dst)
+  {
+    if (!IsOpen())
+    {
+      return false;
+    }
+
+    file_.read(reinterpret_cast<char*>(dst.data()), static_cast<std::streamsize>(dst.size()));
+    file_.ignore(static_cast<std::streamsize>(PaddingFor(dst.size())));
+    return file_.good();
+  }
+
+  bool EntryReader::AtEnd()
+  {
+    return IsOpen() && file_.peek() == std::ifstream::traits_type::eof();
+  }
+
+  uint64_t EntryReader::RemainingBytes()
+  {
+    if (!IsOpen())
+    {
+      return 0;
+    }
+
+    const auto position = file_.tellg();
+    if (position < 0 || static_cast<uint64_t>(position) > size_)
+    {
+      return 0;
+    }
+
+    return size_ - static_cast<uint64_t>(position);
+  }
+
+  void EntryReader::Discard()
+  {
+    file_.close();
+    auto ec = std::error_code();
+    std::filesystem::remove(path_, ec);
+  }
+} // namespace Utility::AssetCache
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+// Content-addressed on-disk cache for derived asset data that is expensive to compute (e.g. meshlets).
+// Entries are immutable files named after a hash of everything that went into producing them, so there is nothing to invalidate.
+// Any kind of failure (missing directory, truncated file, etc.) is simply treated as a cache miss.
+namespace Utility::AssetCache
+{
+  // Fast, non-cryptographic 64-bit hash suitable for content addressing.
+  [[nodiscard]] uint64_t Hash(std::span<const std::byte> data, uint64_t seed = 0);
+
+  template<typename T>
+    requires std::is_trivially_copyable_v<T>
+  [[nodiscard]] uint64_t HashValue(const T& value, uint64_t seed = 0)
+  {
+    return Hash(std::as_bytes(std::span(&value, 1)), seed);
+  }
+
+  // Sections of an entry are stored back-to-back, each starting on a multiple of this alignment.
+  // This would let a memory-mapped entry be used in-place, though entries are currently read with EntryReader instead.
+  inline constexpr std::size_t sectionAlignment = 16;
+
+  [[nodiscard]] std::filesystem::path GetEntryPath(std::string_view category, uint64_t key);
+
+  // Writes to a temporary file that is renamed when complete, so readers never observe a partially-written entry.
+  // Returns false if the entry could not be written.
+  bool WriteEntry(std::string_view category, uint64_t key, std::span<const std::span<const std::byte>> sections);
+
+  // Entries are read with plain file streams rather than memory-mapped.
+  // Loaders read each section straight into the array that will hold it, so mapping would only save the kernel's copy, and it would need
+  // separate Win32 and POSIX code paths along with care about files being replaced while mapped.
+  class EntryReader
+  {
+  public:
+    EntryReader(std::string_view category, uint64_t key);
+
+    [[nodiscard]] bool IsOpen() const
+    {
+      return file_.is_open() && file_.good();
+    }
+
+    // Reads the next section directly into dst. dst must be exactly as large as the section that was written.
+    [[nodiscard]] bool ReadSection(std::span<std::byte> dst);
+
+    template<typename T>
+      requires std::is_trivially_copyable_v<T>
+    [[nodiscard]] bool ReadSection(std::span<T> dst)
+    {
+      return ReadSection(std::as_writable_bytes(dst));
+    }
+
+    // True if every byte of the entry was consumed
+    [[nodiscard]] bool AtEnd();
+
+    // Number of bytes that haven't been read yet, including section padding. Lets sizes read from the entry be checked before allocating for them.
+    [[nodiscard]] uint64_t RemainingBytes();
+
+    // Closes and deletes the entry, so that a corrupt entry is rebuilt instead of being rejected on every load
+    void Discard();
+
+  private:
+    std::filesystem::path path_;
+    uint64_t size_ = 0;
+    std::ifstream file_;
+  };
+} // namespace Utility::AssetCache
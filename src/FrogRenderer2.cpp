@@ -10,6 +10,7 @@
 using namespace Fvog::detail;
 
 #include "shaders/Config.shared.h"
+#include "shaders/ScatterUpload.shared.h"
 #include "shaders/visbuffer/CullMeshlets.h.glsl"
 
 #include "MathUtilities.h"
@@ -24,7 +25,10 @@ using namespace Fvog::detail;
 #include <tracy/Tracy.hpp>
 #include <tracy/TracyVulkan.hpp>
 
+#include <algorithm>
 #include <memory_resource>
+#include <execution>
+#include <numeric>
 
 #define CONCAT_HELPER(x, y) x##y
 #define CONCAT(x, y)        CONCAT_HELPER(x, y)
@@ -136,6 +140,96 @@ static std::vector<Debug::Line> GenerateFrustumWireframe(const glm::mat4& invVie
   return GenerateSubfrustumWireframe(invViewProj, color, near, far, 0, 1, 0, 1);
 }
 
+// Drops updates of objects that were deleted, and all but the latest update of each object, since writing the same region
+// more than once in a flush would race on the GPU. What remains is sorted by ID.
+template<typename T, typename Allocs>
+static void RemoveStaleUpdates(std::vector<std::pair<uint64_t, T>>& updates, const Utility::SlotMap<Allocs>& allocations)
+{
+  std::erase_if(updates, [&](const auto& update) { return !allocations.Contains(update.first); });
+
+  // Reversing first makes the latest update of each object the one that unique() keeps
+  auto GetId = [](const auto& update) { return update.first; };
+  std::ranges::reverse(updates);
+  std::ranges::stable_sort(updates, {}, GetId);
+  updates.erase(std::ranges::unique(updates, {}, GetId).begin(), updates.end());
+}
+
+namespace
+{
+  // Collects writes to GPU buffers so they can be packed into one upload buffer and applied by a single scatter dispatch,
+  // instead of issuing a transfer command for each of them
+  class ScatterUploadBatch
+  {
+  public:
+    void Add(Fvog::Buffer& dstBuffer, size_t dstOffset, const void* data, size_t sizeBytes)
+    {
+      assert(dstOffset % sizeof(uint32_t) == 0);
+      assert(sizeBytes % sizeof(uint32_t) == 0);
+      const auto dstBufferHandle = dstBuffer.GetBuffer();
+      const auto dstWordOffset   = dstOffset / sizeof(uint32_t);
+      const auto wordCount       = sizeBytes / sizeof(uint32_t);
+      const auto srcWordOffset   = payload_.size();
+
+      payload_.resize(srcWordOffset + wordCount);
+      std::memcpy(payload_.data() + srcWordOffset, data, sizeBytes);
+
+      for (size_t i = 0; i < wordCount; i += SCATTER_UPLOAD_MAX_RECORD_WORDS)
+      {
+        records_.push_back({
+          .dstBuffer     = dstBufferHandle,
+          .dstWordOffset = uint32_t(dstWordOffset + i),
+          .srcWordOffset = uint32_t(srcWordOffset + i),
+          .wordCount     = uint32_t(std::min<size_t>(wordCount - i, SCATTER_UPLOAD_MAX_RECORD_WORDS)),
+        });
+      }
+    }
+
+    template<typename T>
+      requires std::is_trivially_copyable_v<T>
+    void Add(Fvog::Buffer& dstBuffer, size_t dstOffset, const T& data)
+    {
+      Add(dstBuffer, dstOffset, &data, sizeof(T));
+    }
+
+    // uploadBuffer must not be in use by the GPU. It is grown geometrically if the batch doesn't fit, and kept for later batches.
+    void Dispatch(Fvog::Context& ctx, const Fvog::ComputePipeline& pipeline, std::optional<Fvog::Buffer>& uploadBuffer) const
+    {
+      ZoneScoped;
+      if (records_.empty())
+      {
+        return;
+      }
+
+      ZoneTextF("Records: %zu, bytes: %zu", records_.size(), payload_.size() * sizeof(uint32_t));
+
+      const auto recordBytes  = records_.size() * sizeof(shared::ScatterUploadRecord);
+      const auto payloadBytes = payload_.size() * sizeof(uint32_t);
+      if (!uploadBuffer || uploadBuffer->SizeBytes() < recordBytes + payloadBytes)
+      {
+        const auto size = std::max<VkDeviceSize>({recordBytes + payloadBytes, uploadBuffer ? uploadBuffer->SizeBytes() * 2 : 0, minUploadBufferSize});
+        uploadBuffer.emplace(Fvog::BufferCreateInfo{.size = size, .flag = Fvog::BufferFlagThingy::MAP_SEQUENTIAL_WRITE}, "Scatter Upload Buffer");
+      }
+      std::memcpy(uploadBuffer->GetMappedMemory(), records_.data(), recordBytes);
+      std::memcpy(static_cast<std::byte*>(uploadBuffer->GetMappedMemory()) + recordBytes, payload_.data(), payloadBytes);
+
+      ctx.BindComputePipeline(pipeline);
+      ctx.SetPushConstants(shared::ScatterUploadArguments{
+        .uploadBuffer = *uploadBuffer,
+        .recordCount  = uint32_t(records_.size()),
+      });
+      // Workgroups loop over records, so the dispatch can stay within the smallest guaranteed workgroup count limit
+      ctx.Dispatch(uint32_t(std::min<size_t>(records_.size(), 65535)), 1, 1);
+    }
+
+  private:
+    static_assert(sizeof(shared::ScatterUploadRecord) == SCATTER_UPLOAD_RECORD_WORDS * sizeof(uint32_t));
+    static constexpr size_t minUploadBufferSize = size_t(64) << 10;
+
+    std::vector<shared::ScatterUploadRecord> records_;
+    std::vector<uint32_t> payload_;
+  };
+} // namespace
+
 void FrogRenderer2::CreatePipelines()
 {
   cullMeshletsPipeline = GetPipelineManager().EnqueueCompileComputePipeline({
@@ -158,6 +252,11 @@ void FrogRenderer2::CreatePipelines()
     .shaderModuleInfo = {.path = GetShaderDirectory() / "hzb/HZBReduce.comp.glsl"},
   });
 
+  scatterUploadPipeline = GetPipelineManager().EnqueueCompileComputePipeline({
+    .name             = "Scatter Upload",
+    .shaderModuleInfo = {.path = GetShaderDirectory() / "ScatterUpload.comp.glsl"},
+  });
+
   visbufferPipeline = GetPipelineManager().EnqueueCompileGraphicsPipeline({
     .name = "Visbuffer",
     .vertexModuleInfo =
@@ -595,12 +694,7 @@ FrogRenderer2::FrogRenderer2(const Application::CreateInfo& createInfo)
   {
     ZoneScopedN("Load scene");
 
-    auto* oldResource = std::pmr::get_default_resource();
-    auto arena = std::pmr::monotonic_buffer_resource();
-    auto sync  = std::pmr::synchronized_pool_resource(&arena);
-    std::pmr::set_default_resource(&sync);
-
-    scene.Import(*this, Utility::LoadModelFromFile(GetAssetDirectory() / "models/simple_scene.glb", glm::scale(glm::vec3{.5})));
+    scene.ImportAsync(GetAssetDirectory() / "models/simple_scene.glb", glm::scale(glm::vec3{.5}));
     //scene.Import(*this, Utility::LoadModelFromFile("H:/Repositories/glTF-Sample-Models/downloaded schtuff/cube.glb", glm::scale(glm::vec3{1})));
     //Utility::LoadModelFromFile(*device_, scene, "H:\\Repositories\\glTF-Sample-Models\\2.0\\BoomBox\\glTF/BoomBox.gltf", glm::scale(glm::vec3{10.0f}));
     //scene.Import(*this, Utility::LoadModelFromFile("H:/Repositories/glTF-Sample-Models/2.0/Sponza/glTF/Sponza.gltf", glm::scale(glm::vec3{1})));
@@ -619,8 +713,6 @@ FrogRenderer2::FrogRenderer2(const Application::CreateInfo& createInfo)
     //scene.Import(*this, Utility::LoadModelFromFile("H:/Repositories/glTF-Sample-Models/downloaded schtuff/triangles.glb", glm::scale(glm::vec3{1})));
     //scene.Import(*this, Utility::LoadModelFromFile("H:/Repositories/glTF-Sample-Models/downloaded schtuff/cornell.glb", glm::scale(glm::vec3{1})));
     //scene.Import(*this, Utility::LoadModelFromFile("H:/Repositories/glTF-Sample-Models/downloaded schtuff/cornell_box(1).glb", glm::translate(glm::vec3{3, 0, 0})));
-    
-    std::pmr::set_default_resource(oldResource);
   }
 
   meshletIndirectCommand = Fvog::TypedBuffer<Fvog::DrawIndexedIndirectCommand>({}, "Meshlet Indirect Command");
@@ -695,6 +787,7 @@ FrogRenderer2::~FrogRenderer2()
 
   meshGeometryAllocations.clear();
   meshAllocations.clear();
+  meshInstancesAllocations.clear();
   lightAllocations.clear();
   materialAllocations.clear();
 
@@ -865,6 +958,7 @@ void FrogRenderer2::OnUpdate([[maybe_unused]] double dt)
     }
   }
 
+  scene.AdvanceImports(*this, importBudget);
   scene.CalcUpdatedData(*this);
 
   shadingUniforms.numberOfLights = NumLights();
@@ -911,6 +1005,7 @@ void FrogRenderer2::CullMeshletsForView(VkCommandBuffer commandBuffer, const Vie
     .meshletDataIndex      = geometryBuffer.GetResourceHandle().index,
     .transformsIndex       = geometryBuffer.GetResourceHandle().index,
     .indirectDrawIndex     = meshletIndirectCommand->GetResourceHandle().index,
+    .materialsIndex        = geometryBuffer.GetResourceHandle().index,
     .viewIndex             = viewBuffer->GetResourceHandle().index,
 
     .pageTablesIndex            = vsmPushConstants.pageTablesIndex,
@@ -1005,33 +1100,31 @@ void FrogRenderer2::OnRender([[maybe_unused]] double dt, VkCommandBuffer command
 
   FlushUpdatedSceneData(commandBuffer);
 
-  if (Fvog::GetDevice().supportsRayTracing)
+  // Static scenes skip this entirely
+  if (Fvog::GetDevice().supportsRayTracing && (tlasNeedsRebuild || tlasNeedsRefit))
   {
-    tlas = [&]
+    TracyVkZone(tracyVkContext_, commandBuffer, "Update TLAS");
+    ZoneScopedN("Update TLAS");
+    if (tlasNeedsRebuild || tlasRefitsSinceBuild >= tlasMaxRefits)
     {
-      TracyVkZone(tracyVkContext_, commandBuffer, "Build TLAS");
-      ZoneScopedN("Build TLAS");
-      auto instances = std::vector<Fvog::TlasInstance>();
-      instances.reserve(meshAllocations.size());
-      for (const auto& [meshId, instance] : meshAllocations)
-      {
-        instances.push_back(instance.tlasInstance.value());
-      }
-
-      auto tlasInstances =
-        Fvog::TypedBuffer<Fvog::TlasInstance>({(uint32_t)instances.size(), Fvog::BufferFlagThingy::MAP_SEQUENTIAL_WRITE_DEVICE}, "TLAS Instances Buffer");
-
-      std::memcpy(tlasInstances.GetMappedMemory(), instances.data(), sizeof(Fvog::TlasInstance) * instances.size());
-
-      return Fvog::Tlas(
+      tlas = Fvog::Tlas(
         Fvog::TlasCreateInfo{
           .commandBuffer  = commandBuffer,
           .geoemtryFlags  = Fvog::AccelerationStructureGeometryFlag::OPAQUE,
-          .buildFlags     = Fvog::AccelerationStructureBuildFlag::FAST_TRACE | Fvog::AccelerationStructureBuildFlag::ALLOW_DATA_ACCESS,
-          .instanceBuffer = &tlasInstances,
+          .buildFlags     = Fvog::AccelerationStructureBuildFlag::FAST_TRACE | Fvog::AccelerationStructureBuildFlag::ALLOW_DATA_ACCESS | Fvog::AccelerationStructureBuildFlag::ALLOW_UPDATE,
+          .instanceBuffer = &tlasInstancesBuffer.value(),
+          .instanceCount  = tlasInstanceCount,
         },
         "TLAS");
-    }();
+      tlasRefitsSinceBuild = 0;
+    }
+    else
+    {
+      tlas->Update(commandBuffer);
+      tlasRefitsSinceBuild++;
+    }
+    tlasNeedsRebuild = false;
+    tlasNeedsRefit   = false;
   }
 
   // A few of these buffers are really slow to create (2-3ms) and destroy every frame (large ones hit vkAllocateMemory), so
@@ -1132,6 +1225,7 @@ void FrogRenderer2::OnRender([[maybe_unused]] double dt, VkCommandBuffer command
   // globalUniforms.maxIndices = static_cast<uint32_t>(scene.primitives.size() * 3);
   globalUniforms.maxIndices             = 0; // TODO: This doesn't seem to be used for anything.
   globalUniforms.bindlessSamplerLodBias = fsr2LodBias;
+  globalUniforms.lodProjectionScale     = projUnjittered[1][1] * renderInternalHeight * 0.5f;
 
   globalUniformsBuffer.UpdateData(commandBuffer, globalUniforms);
 
@@ -1749,7 +1843,7 @@ void FrogRenderer2::OnPathDrop([[maybe_unused]] std::span<const char*> paths)
   ZoneScoped;
   for (const auto& path : paths)
   {
-    scene.Import(*this, Utility::LoadModelFromFile(path, glm::identity<glm::mat4>()));
+    scene.ImportAsync(path, glm::identity<glm::mat4>());
   }
 }
 
@@ -1757,61 +1851,138 @@ Render::MeshGeometryID FrogRenderer2::RegisterMeshGeometry(MeshGeometryInfo mesh
 {
   ZoneScoped;
   totalMeshlets += meshGeometry.meshlets.size();
-  totalVertices += meshGeometry.vertices.size();
+  totalVertices += meshGeometry.positions.size();
   totalRemappedIndices += meshGeometry.remappedIndices.size();
   totalOriginalIndices += meshGeometry.originalIndices.size();
   totalPrimitives += meshGeometry.primitives.size();
 
-  auto verticesAlloc   = geometryBuffer.Allocate(std::span(meshGeometry.vertices).size_bytes(), sizeof(Render::Vertex));
+  // The full-detail meshlets come first and cover every original triangle exactly once
+  size_t baseMeshletCount = 0;
+  for (size_t triangles = 0; triangles < meshGeometry.originalIndices.size() / 3; baseMeshletCount++)
+  {
+    triangles += meshGeometry.meshlets[baseMeshletCount].primitiveCount;
+  }
+
+  // The BLAS is built from the triangles of the full-detail meshlets, in meshlet order. Hit shaders find the meshlet of a primitive index by
+  // binary searching the index of each meshlet's first triangle, so the original indices don't need to stay resident for ray tracing.
+  // Built before the meshlets are massaged, while their offsets are still relative to this geometry.
+  auto blasIndices            = std::optional<Fvog::TypedBuffer<Render::index_t>>();
+  auto blasMeshletStartsAlloc = std::optional<Fvog::ManagedBuffer::Alloc>();
+  if (Fvog::GetDevice().supportsRayTracing)
+  {
+    auto blasMeshletStarts      = std::vector<uint32_t>(baseMeshletCount);
+    uint32_t blasPrimitiveCount = 0;
+    for (size_t i = 0; i < baseMeshletCount; i++)
+    {
+      blasMeshletStarts[i] = blasPrimitiveCount;
+      blasPrimitiveCount += meshGeometry.meshlets[i].primitiveCount;
+    }
+
+    blasIndices.emplace(Fvog::TypedBufferCreateInfo{
+      .count = blasPrimitiveCount * 3,
+      .flag  = Fvog::BufferFlagThingy::MAP_SEQUENTIAL_WRITE | Fvog::BufferFlagThingy::NO_DESCRIPTOR,
+    }, "BLAS Indices");
+
+    auto meshletIndices = std::vector<size_t>(baseMeshletCount);
+    std::iota(meshletIndices.begin(), meshletIndices.end(), size_t(0));
+    std::for_each(std::execution::par,
+      meshletIndices.begin(),
+      meshletIndices.end(),
+      [&, dst = blasIndices->GetMappedMemory()](size_t meshletIndex)
+      {
+        const auto& meshlet = meshGeometry.meshlets[meshletIndex];
+        auto* meshletDst    = dst + blasMeshletStarts[meshletIndex] * 3;
+        for (uint32_t i = 0; i < meshlet.primitiveCount * 3; i++)
+        {
+          meshletDst[i] = meshGeometry.remappedIndices[meshlet.indexOffset + meshGeometry.primitives[meshlet.primitiveOffset + i]];
+        }
+      });
+
+    blasMeshletStartsAlloc = geometryBuffer.Allocate(std::span(blasMeshletStarts).size_bytes(), sizeof(uint32_t));
+    std::memcpy(geometryBuffer.GetMappedMemory() + blasMeshletStartsAlloc->GetOffset(), blasMeshletStarts.data(), blasMeshletStartsAlloc->GetDataSize());
+  }
+
+  // Only the geometry inspector reads the original indices, so they are dropped unless requested
+  auto originalIndicesAlloc = std::optional<Fvog::ManagedBuffer::Alloc>();
+  if (keepOriginalIndices)
+  {
+    originalIndicesAlloc = geometryBuffer.Allocate(std::span(meshGeometry.originalIndices).size_bytes(), sizeof(Render::index_t));
+  }
+  else
+  {
+    droppedOriginalIndexBytes += std::span(meshGeometry.originalIndices).size_bytes();
+  }
+
+  auto positionsAlloc  = geometryBuffer.Allocate(std::span(meshGeometry.positions).size_bytes(), sizeof(Render::QuantizedPosition));
+  auto attributesAlloc = geometryBuffer.Allocate(std::span(meshGeometry.attributes).size_bytes(), sizeof(Render::VertexAttributes));
+  auto texcoordsAlloc  = std::optional<Fvog::ManagedBuffer::Alloc>();
+  if (!meshGeometry.texcoords.empty())
+  {
+    texcoordsAlloc = geometryBuffer.Allocate(std::span(meshGeometry.texcoords).size_bytes(), sizeof(glm::vec2));
+  }
   auto indicesAlloc    = geometryBuffer.Allocate(std::span(meshGeometry.remappedIndices).size_bytes(), sizeof(Render::index_t));
   auto primitivesAlloc = geometryBuffer.Allocate(std::span(meshGeometry.primitives).size_bytes(), sizeof(Render::primitive_t));
   auto meshletAlloc    = geometryBuffer.Allocate(std::span(meshGeometry.meshlets).size_bytes(), sizeof(Render::Meshlet));
-  auto originalIndicesAlloc = geometryBuffer.Allocate(std::span(meshGeometry.originalIndices).size_bytes(), sizeof(Render::index_t));
 
   // Massage meshlets before uploading
-  const auto baseVertex    = verticesAlloc.GetOffset() / sizeof(Render::Vertex);
+  const auto baseVertex    = positionsAlloc.GetOffset() / sizeof(Render::QuantizedPosition);
+  const auto baseAttribute = attributesAlloc.GetOffset() / sizeof(Render::VertexAttributes);
   const auto baseIndex     = indicesAlloc.GetOffset() / sizeof(Render::index_t);
   const auto basePrimitive = primitivesAlloc.GetOffset() / sizeof(Render::primitive_t);
   for (auto& meshlet : meshGeometry.meshlets)
   {
     meshlet.vertexOffset += (uint32_t)baseVertex;
+    meshlet.attributeOffset += (uint32_t)baseAttribute;
     meshlet.indexOffset += (uint32_t)baseIndex;
     meshlet.primitiveOffset += (uint32_t)basePrimitive;
   }
 
   std::memcpy(geometryBuffer.GetMappedMemory() + meshletAlloc.GetOffset(), meshGeometry.meshlets.data(), meshletAlloc.GetDataSize());
-  std::memcpy(geometryBuffer.GetMappedMemory() + verticesAlloc.GetOffset(), meshGeometry.vertices.data(), verticesAlloc.GetDataSize());
+  std::memcpy(geometryBuffer.GetMappedMemory() + positionsAlloc.GetOffset(), meshGeometry.positions.data(), positionsAlloc.GetDataSize());
+  std::memcpy(geometryBuffer.GetMappedMemory() + attributesAlloc.GetOffset(), meshGeometry.attributes.data(), attributesAlloc.GetDataSize());
+  if (texcoordsAlloc)
+  {
+    std::memcpy(geometryBuffer.GetMappedMemory() + texcoordsAlloc->GetOffset(), meshGeometry.texcoords.data(), texcoordsAlloc->GetDataSize());
+  }
   std::memcpy(geometryBuffer.GetMappedMemory() + indicesAlloc.GetOffset(), meshGeometry.remappedIndices.data(), indicesAlloc.GetDataSize());
   std::memcpy(geometryBuffer.GetMappedMemory() + primitivesAlloc.GetOffset(), meshGeometry.primitives.data(), primitivesAlloc.GetDataSize());
-  std::memcpy(geometryBuffer.GetMappedMemory() + originalIndicesAlloc.GetOffset(), meshGeometry.originalIndices.data(), originalIndicesAlloc.GetDataSize());
+  if (originalIndicesAlloc)
+  {
+    std::memcpy(geometryBuffer.GetMappedMemory() + originalIndicesAlloc->GetOffset(), meshGeometry.originalIndices.data(), originalIndicesAlloc->GetDataSize());
+  }
 
-  [[maybe_unused]] auto verticesOffset        = verticesAlloc.GetOffset();
-  [[maybe_unused]] auto originalIndicesOffset = originalIndicesAlloc.GetOffset();
+  [[maybe_unused]] auto positionsOffset = positionsAlloc.GetOffset();
 
-  auto myId = nextId++;
-  [[maybe_unused]] const auto& meshGeometryAlloc = meshGeometryAllocations.emplace(myId,
+  const auto myId = meshGeometryAllocations.Insert(
     MeshGeometryAllocs{
       .meshletsAlloc   = std::move(meshletAlloc),
-      .verticesAlloc   = std::move(verticesAlloc),
+      .positionsAlloc  = std::move(positionsAlloc),
+      .attributesAlloc = std::move(attributesAlloc),
+      .texcoordsAlloc  = std::move(texcoordsAlloc),
       .indicesAlloc    = std::move(indicesAlloc),
       .primitivesAlloc = std::move(primitivesAlloc),
       .originalIndicesAlloc = std::move(originalIndicesAlloc),
+      .originalIndexCount   = meshGeometry.originalIndices.size(),
+      .baseMeshletCount     = uint32_t(baseMeshletCount),
+      .blasMeshletStartsAlloc = std::move(blasMeshletStartsAlloc),
+      .dequantization  = meshGeometry.dequantization,
   });
 
   if (Fvog::GetDevice().supportsRayTracing)
   {
-    meshGeometryAlloc.first->second.blas = Fvog::Blas(Fvog::BlasCreateInfo{
+    auto& meshGeometryAlloc = meshGeometryAllocations.at(myId);
+    meshGeometryAlloc.blas  = Fvog::Blas(Fvog::BlasCreateInfo{
       .geoemtryFlags = Fvog::AccelerationStructureGeometryFlag::OPAQUE,
       .buildFlags    = Fvog::AccelerationStructureBuildFlag::FAST_TRACE | Fvog::AccelerationStructureBuildFlag::ALLOW_DATA_ACCESS | Fvog::AccelerationStructureBuildFlag::ALLOW_COMPACTION,
-      .vertexFormat  = VK_FORMAT_R32G32B32_SFLOAT,
-      .vertexBuffer  = geometryBuffer.GetBuffer().GetDeviceAddress() + verticesOffset,
-      .indexBuffer   = geometryBuffer.GetBuffer().GetDeviceAddress() + originalIndicesOffset,
-      .vertexStride  = sizeof(Render::Vertex),
-      .numVertices   = (uint32_t)meshGeometry.vertices.size(),
+      .vertexFormat  = VK_FORMAT_R16G16B16A16_SNORM,
+      .vertexBuffer  = geometryBuffer.GetBuffer().GetDeviceAddress() + positionsOffset,
+      .indexBuffer   = blasIndices->GetDeviceAddress(),
+      .vertexStride  = sizeof(Render::QuantizedPosition),
+      .numVertices   = (uint32_t)meshGeometry.positions.size(),
       .indexType     = VK_INDEX_TYPE_UINT32,
-      .numIndices    = (uint32_t)meshGeometry.originalIndices.size(),
+      .numIndices    = blasIndices->Size(),
     }),
-    totalBlasMemory += meshGeometryAlloc.first->second.blas->GetBuffer().SizeBytes();
+    totalBlasMemory += meshGeometryAlloc.blas->GetBuffer().SizeBytes();
   }
 
   return {myId};
@@ -1820,27 +1991,30 @@ Render::MeshGeometryID FrogRenderer2::RegisterMeshGeometry(MeshGeometryInfo mesh
 void FrogRenderer2::UnregisterMeshGeometry(Render::MeshGeometryID meshGeometry)
 {
   ZoneScoped;
-  auto it = meshGeometryAllocations.find(meshGeometry.id);
-  assert(it != meshGeometryAllocations.end());
-  totalMeshlets -= it->second.meshletsAlloc.GetDataSize() / sizeof(Render::Meshlet);
-  totalVertices -= it->second.verticesAlloc.GetDataSize() / sizeof(Render::Vertex);
-  totalRemappedIndices -= it->second.indicesAlloc.GetDataSize() / sizeof(Render::index_t);
-  totalOriginalIndices -= it->second.originalIndicesAlloc.GetDataSize() / sizeof(Render::index_t);
-  totalPrimitives -= it->second.primitivesAlloc.GetDataSize() / sizeof(Render::primitive_t);
+  const auto& allocs = meshGeometryAllocations.at(meshGeometry.id);
+  totalMeshlets -= allocs.meshletsAlloc.GetDataSize() / sizeof(Render::Meshlet);
+  totalVertices -= allocs.positionsAlloc.GetDataSize() / sizeof(Render::QuantizedPosition);
+  totalRemappedIndices -= allocs.indicesAlloc.GetDataSize() / sizeof(Render::index_t);
+  totalOriginalIndices -= allocs.originalIndexCount;
+  if (!allocs.originalIndicesAlloc)
+  {
+    droppedOriginalIndexBytes -= allocs.originalIndexCount * sizeof(Render::index_t);
+  }
+  totalPrimitives -= allocs.primitivesAlloc.GetDataSize() / sizeof(Render::primitive_t);
   if (Fvog::GetDevice().supportsRayTracing)
   {
-    totalBlasMemory -= it->second.blas.value().GetBuffer().SizeBytes();
+    totalBlasMemory -= allocs.blas.value().GetBuffer().SizeBytes();
   }
-  meshGeometryAllocations.erase(it);
+  meshGeometryAllocations.Erase(meshGeometry.id);
 }
 
 Render::MeshID FrogRenderer2::SpawnMesh(Render::MeshGeometryID meshGeometry)
 {
   ZoneScoped;
-  auto myId = nextId++;
-  auto& meshAllocation = meshAllocations[myId];
-  meshAllocation.instanceAlloc = geometryBuffer.Allocate(sizeof(Render::ObjectUniforms), sizeof(Render::ObjectUniforms));
-  meshAllocation.geometryId    = meshGeometry; 
+  const auto myId = meshAllocations.Insert(MeshAllocs{
+    .geometryId    = meshGeometry,
+    .instanceAlloc = geometryBuffer.Allocate(sizeof(Render::ObjectUniforms), sizeof(Render::ObjectUniforms)),
+  });
   spawnedMeshes.emplace_back(Render::MeshID{myId}, meshGeometry);
   return {myId};
 }
@@ -1851,11 +2025,31 @@ void FrogRenderer2::DeleteMesh(Render::MeshID mesh)
   deletedMeshes.emplace_back(mesh.id);
 }
 
+Render::MeshInstancesID FrogRenderer2::SpawnMeshInstances(Render::MeshGeometryID meshGeometry, uint32_t instanceCount)
+{
+  ZoneScoped;
+  assert(instanceCount > 0);
+  const auto myId = meshInstancesAllocations.Insert(
+    MeshInstancesAllocs{
+      .geometryId    = meshGeometry,
+      .instanceCount = instanceCount,
+      .uniformsAlloc = geometryBuffer.Allocate(instanceCount * sizeof(Render::ObjectUniforms), sizeof(Render::ObjectUniforms)),
+    });
+  spawnedMeshInstances.emplace_back(myId);
+  return {myId};
+}
+
+void FrogRenderer2::DeleteMeshInstances(Render::MeshInstancesID meshInstances)
+{
+  ZoneScoped;
+  deletedMeshInstances.emplace_back(meshInstances.id);
+}
+
 // Having the data payload in the alloc function is kinda quirky and inconsistent, but I'll keep it for now.
 Render::LightID FrogRenderer2::SpawnLight(const GpuLight& lightData)
 {
   ZoneScoped;
-  auto myId = nextId++;
+  const auto myId = lightAllocations.Insert(LightAlloc{});
   spawnedLights.emplace_back(myId, lightData);
   return {myId};
 }
@@ -1872,33 +2066,118 @@ Render::MaterialID FrogRenderer2::RegisterMaterial(Render::Material&& material)
   auto materialAlloc = geometryBuffer.Allocate(sizeof(Render::GpuMaterial), sizeof(Render::GpuMaterial));
   std::memcpy(geometryBuffer.GetMappedMemory() + materialAlloc.GetOffset(), &material.gpuMaterial, sizeof(Render::GpuMaterial));
 
-  auto myId = nextId++;
-  materialAllocations.emplace(myId, MaterialAlloc{.materialAlloc = std::move(materialAlloc), .material = std::move(material)});
+  const auto myId = materialAllocations.Insert(MaterialAlloc{.materialAlloc = std::move(materialAlloc), .material = std::move(material)});
   return {myId};
 }
 
 void FrogRenderer2::UnregisterMaterial(Render::MaterialID material)
 {
   ZoneScoped;
-  materialAllocations.erase(material.id);
+  materialAllocations.Erase(material.id);
+}
+
+void FrogRenderer2::SetGeometryUniforms(const MeshGeometryAllocs& meshGeometryAllocs, Render::ObjectUniforms& uniforms)
+{
+  const auto baseAddress           = geometryBuffer.GetBuffer().GetDeviceAddress();
+  const auto& texcoordsAlloc       = meshGeometryAllocs.texcoordsAlloc;
+  const auto& blasMeshletStarts    = meshGeometryAllocs.blasMeshletStartsAlloc;
+  uniforms.attributeOffset         = uint32_t(meshGeometryAllocs.attributesAlloc.GetOffset() / sizeof(Render::VertexAttributes));
+  uniforms.fullPrecisionTexcoords  = texcoordsAlloc.has_value();
+  uniforms.texcoordBuffer          = texcoordsAlloc ? baseAddress + texcoordsAlloc->GetOffset() : 0;
+  uniforms.baseMeshletCount        = meshGeometryAllocs.baseMeshletCount;
+  uniforms.blasMeshletStartsOffset = blasMeshletStarts ? uint32_t(blasMeshletStarts->GetOffset() / sizeof(uint32_t)) : 0;
 }
 
 void FrogRenderer2::UpdateMesh(Render::MeshID mesh, const Render::ObjectUniforms& uniforms)
+{
+  UpdateMeshes(std::span(&mesh, 1), std::span(&uniforms, 1));
+}
+
+void FrogRenderer2::UpdateMeshes(std::span<const Render::MeshID> meshes, std::span<const Render::ObjectUniforms> uniforms)
 {
   ZoneScoped;
-  modifiedMeshUniforms[mesh.id] = uniforms;
+  ZoneTextF("Meshes: %zu", meshes.size());
+  assert(meshes.size() == uniforms.size());
+
+  // The allocation maps are only read here, so they can be searched from every thread
+  auto gpuUniforms = std::vector<Render::ObjectUniforms>(meshes.size());
+  auto indices     = std::vector<size_t>(meshes.size());
+  std::iota(indices.begin(), indices.end(), size_t(0));
+  std::for_each(std::execution::par,
+    indices.begin(),
+    indices.end(),
+    [&](size_t i)
+    {
+      const auto& meshGeometryAllocs = meshGeometryAllocations.at(meshAllocations.at(meshes[i].id).geometryId->id);
+      const auto& dequantization     = meshGeometryAllocs.dequantization;
+      const auto objectFromQuantized = dequantization.GetPositionTransform();
+
+      auto& meshUniforms           = gpuUniforms[i];
+      meshUniforms                 = uniforms[i];
+      meshUniforms.modelPrevious   = uniforms[i].modelPrevious * objectFromQuantized;
+      meshUniforms.modelCurrent    = uniforms[i].modelCurrent * objectFromQuantized;
+      meshUniforms.objectFromWorld = glm::inverse(meshUniforms.modelCurrent);
+      meshUniforms.uvOffset        = dequantization.texcoordOffset;
+      meshUniforms.uvScale         = dequantization.texcoordScale;
+      SetGeometryUniforms(meshGeometryAllocs, meshUniforms);
+    });
+
+  modifiedMeshUniforms.reserve(modifiedMeshUniforms.size() + meshes.size());
+  for (size_t i = 0; i < meshes.size(); i++)
+  {
+    modifiedMeshUniforms.emplace_back(meshes[i].id, gpuUniforms[i]);
+  }
+}
+
+void FrogRenderer2::UpdateMeshInstances(Render::MeshInstancesID meshInstances,
+  Render::MaterialID material,
+  const glm::mat4& parentTransform,
+  std::span<const glm::mat4> instanceTransforms)
+{
+  ZoneScoped;
+  const auto& meshInstancesAlloc = meshInstancesAllocations.at(meshInstances.id);
+  assert(instanceTransforms.size() == meshInstancesAlloc.instanceCount);
+  const auto& meshGeometryAllocs = meshGeometryAllocations.at(meshInstancesAlloc.geometryId.id);
+  const auto& dequantization     = meshGeometryAllocs.dequantization;
+  const auto objectFromQuantized = dequantization.GetPositionTransform();
+  const auto baseAddress         = geometryBuffer.GetBuffer().GetDeviceAddress();
+
+  // Everything but the transforms is shared by the whole group
+  auto sharedUniforms = Render::ObjectUniforms{
+    .positionBuffer = baseAddress + meshGeometryAllocs.positionsAlloc.GetOffset(),
+    .vertexBuffer   = baseAddress + meshGeometryAllocs.attributesAlloc.GetOffset(),
+    .meshletOffset  = uint32_t(meshGeometryAllocs.meshletsAlloc.GetOffset() / sizeof(Render::Meshlet)),
+    .materialId     = GetMaterialGpuIndex(material),
+    .uvOffset       = dequantization.texcoordOffset,
+    .uvScale        = dequantization.texcoordScale,
+  };
+  SetGeometryUniforms(meshGeometryAllocs, sharedUniforms);
+
+  auto& gpuUniforms = modifiedMeshInstancesUniforms.emplace_back(meshInstances.id, instanceTransforms.size()).second;
+  std::transform(std::execution::par,
+    instanceTransforms.begin(),
+    instanceTransforms.end(),
+    gpuUniforms.begin(),
+    [&](const glm::mat4& instanceTransform)
+    {
+      auto uniforms            = sharedUniforms;
+      uniforms.modelCurrent    = parentTransform * instanceTransform * objectFromQuantized;
+      uniforms.modelPrevious   = uniforms.modelCurrent;
+      uniforms.objectFromWorld = glm::inverse(uniforms.modelCurrent);
+      return uniforms;
+    });
 }
 
 void FrogRenderer2::UpdateLight(Render::LightID light, const GpuLight& lightData)
 {
   ZoneScoped;
-  modifiedLights[light.id] = lightData;
+  modifiedLights.emplace_back(light.id, lightData);
 }
 
 void FrogRenderer2::UpdateMaterial(Render::MaterialID material, const Render::GpuMaterial& materialData)
 {
   ZoneScoped;
-  modifiedMaterials[material.id] = materialData;
+  modifiedMaterials.emplace_back(material.id, materialData);
 }
 
 uint32_t FrogRenderer2::GetMaterialGpuIndex(Render::MaterialID material)
@@ -1913,16 +2192,22 @@ Render::Material& FrogRenderer2::GetMaterial(Render::MaterialID material)
   return materialAllocations.at(material.id).material;
 }
 
+VkDeviceAddress FrogRenderer2::GetPositionBufferPointerFromMesh(Render::MeshID meshId)
+{
+  const auto& meshGeometryAllocs = meshGeometryAllocations.at(meshAllocations.at(meshId.id).geometryId->id);
+  return geometryBuffer.GetBuffer().GetDeviceAddress() + meshGeometryAllocs.positionsAlloc.GetOffset();
+}
+
 VkDeviceAddress FrogRenderer2::GetVertexBufferPointerFromMesh(Render::MeshID meshId)
 {
   const auto& meshGeometryAllocs = meshGeometryAllocations.at(meshAllocations.at(meshId.id).geometryId->id);
-  return geometryBuffer.GetBuffer().GetDeviceAddress() + meshGeometryAllocs.verticesAlloc.GetOffset();
+  return geometryBuffer.GetBuffer().GetDeviceAddress() + meshGeometryAllocs.attributesAlloc.GetOffset();
 }
 
-VkDeviceAddress FrogRenderer2::GetOriginalIndexBufferPointerFromMesh(Render::MeshID meshId)
+uint32_t FrogRenderer2::GetMeshletOffsetFromMesh(Render::MeshID meshId)
 {
   const auto& meshGeometryAllocs = meshGeometryAllocations.at(meshAllocations.at(meshId.id).geometryId->id);
-  return geometryBuffer.GetBuffer().GetDeviceAddress() + meshGeometryAllocs.originalIndicesAlloc.GetOffset();
+  return static_cast<uint32_t>(meshGeometryAllocs.meshletsAlloc.GetOffset() / sizeof(Render::Meshlet));
 }
 
 void FrogRenderer2::FlushUpdatedSceneData(VkCommandBuffer commandBuffer)
@@ -1937,11 +2222,42 @@ void FrogRenderer2::FlushUpdatedSceneData(VkCommandBuffer commandBuffer)
   // Deleted meshes
   for (auto id : deletedMeshes)
   {
-    auto it = meshAllocations.find(id);
-    meshletInstancesBuffer.Free(it->second.meshletInstancesAlloc.value(), commandBuffer);
-    meshAllocations.erase(it);
+    meshletInstancesBuffer.Free(meshAllocations.at(id).meshletInstancesAlloc.value());
+    meshAllocations.Erase(id);
+  }
+
+  // Deleted mesh instances
+  for (auto id : deletedMeshInstances)
+  {
+    meshletInstancesBuffer.Free(meshInstancesAllocations.at(id).meshletInstancesAlloc.value());
+    meshInstancesAllocations.Erase(id);
+  }
+
+  // Close the holes left by deleted meshes all at once, then point the remaining meshes at their moved meshlet instances
+  if (const auto relocations = meshletInstancesBuffer.Compact(commandBuffer); !relocations.empty())
+  {
+    ZoneScopedN("Relocate meshlet instances");
+    for (auto& meshAlloc : meshAllocations.Values())
+    {
+      // Meshes spawned this frame are allocated after compaction
+      if (auto& alloc = meshAlloc.meshletInstancesAlloc)
+      {
+        alloc->offset = Fvog::ContiguousManagedBuffer::GetRelocatedOffset(relocations, alloc->offset);
+      }
+    }
+    for (auto& meshInstancesAlloc : meshInstancesAllocations.Values())
+    {
+      if (auto& alloc = meshInstancesAlloc.meshletInstancesAlloc)
+      {
+        alloc->offset = Fvog::ContiguousManagedBuffer::GetRelocatedOffset(relocations, alloc->offset);
+      }
+    }
   }
 
+  // IDs of deleted objects stay invalid even if their slots are reused, so their updates are simply dropped
+  RemoveStaleUpdates(modifiedMeshUniforms, meshAllocations);
+  RemoveStaleUpdates(modifiedMeshInstancesUniforms, meshInstancesAllocations);
+
   struct MeshletInstancesUpload
   {
     size_t srcOffset;
@@ -1988,53 +2304,103 @@ void FrogRenderer2::FlushUpdatedSceneData(VkCommandBuffer commandBuffer)
       partialMeshAlloc.tlasInstance = tlasInstance;
     }
   }
-  
-  // Upload meshlet instances of spawned meshes.
-  // TODO: This should be a scatter-write compute shader
-  if (!meshletInstancesUploads.empty())
+
+  // Spawned mesh instances. Each group gets a single range of meshlet instances that is filled in parallel.
+  for (auto id : spawnedMeshInstances)
   {
-    auto uploadBuffer = Fvog::TypedBuffer<Render::MeshletInstance>({
-        .count = (uint32_t)meshletInstances.size(),
-        .flag  = Fvog::BufferFlagThingy::MAP_SEQUENTIAL_WRITE | Fvog::BufferFlagThingy::NO_DESCRIPTOR,
-      },
-      "Meshlet Upload Staging Buffer");
+    auto& meshInstancesAlloc       = meshInstancesAllocations.at(id);
+    const auto& meshGeometryAllocs = meshGeometryAllocations.at(meshInstancesAlloc.geometryId.id);
+    const auto instanceCount       = meshInstancesAlloc.instanceCount;
+
+    const auto meshletCount         = meshGeometryAllocs.meshletsAlloc.GetDataSize() / sizeof(Render::Meshlet);
+    const auto baseMeshletIndex     = meshGeometryAllocs.meshletsAlloc.GetOffset() / sizeof(Render::Meshlet);
+    const auto baseInstanceIndex    = meshInstancesAlloc.uniformsAlloc.GetOffset() / sizeof(Render::ObjectUniforms);
+    const auto firstMeshletInstance = meshletInstances.size();
+    meshletInstances.resize(firstMeshletInstance + meshletCount * instanceCount);
+
+    auto instanceIndices = std::vector<uint32_t>(instanceCount);
+    std::iota(instanceIndices.begin(), instanceIndices.end(), 0u);
+    std::for_each(std::execution::par,
+      instanceIndices.begin(),
+      instanceIndices.end(),
+      [&](uint32_t i)
+      {
+        auto* dst = meshletInstances.data() + firstMeshletInstance + i * meshletCount;
+        for (size_t j = 0; j < meshletCount; j++)
+        {
+          dst[j] = {uint32_t(baseMeshletIndex + j), uint32_t(baseInstanceIndex + i)};
+        }
+      });
 
-    std::memcpy(uploadBuffer.GetMappedMemory(), meshletInstances.data(), meshletInstances.size() * sizeof(Render::MeshletInstance));
+    const auto meshletInstancesAlloc = meshletInstancesBuffer.Allocate(meshletCount * instanceCount * sizeof(Render::MeshletInstance));
+    meshletInstancesUploads.emplace_back(firstMeshletInstance * sizeof(Render::MeshletInstance), meshletInstancesAlloc.offset, meshletInstancesAlloc.size);
+    meshInstancesAlloc.meshletInstancesAlloc = meshletInstancesAlloc;
 
-    for (auto [srcOffset, dstOffset, size] : meshletInstancesUploads)
+    if (Fvog::GetDevice().supportsRayTracing)
     {
-      ctx.CopyBuffer(uploadBuffer, meshletInstancesBuffer.GetBuffer(), {
-        .srcOffset = srcOffset,
-        .dstOffset = dstOffset,
-        .size = size,
-      });
+      const auto blasAddress = meshGeometryAllocs.blas.value().GetAddress();
+      meshInstancesAlloc.tlasInstances.resize(instanceCount);
+      for (uint32_t i = 0; i < instanceCount; i++)
+      {
+        meshInstancesAlloc.tlasInstances[i] = Fvog::TlasInstance{
+          .transform                = {},
+          .instanceCustomIndex      = uint32_t(baseInstanceIndex + i),
+          .mask                     = 0xFF,
+          .shaderBindingTableOffset = 0,
+          .flags                    = {},
+          .blasAddress              = blasAddress,
+        };
+      }
     }
   }
+  
+  // Every write below is batched and applied by one scatter dispatch, so its cost scales with the number of bytes changed
+  auto uploads = ScatterUploadBatch();
 
-  // Spawn lights
-  for (const auto& [id, gpuLight] : spawnedLights)
+  // Upload meshlet instances of spawned meshes
+  for (auto [srcOffset, dstOffset, size] : meshletInstancesUploads)
   {
-    const auto lightAlloc = lightsBuffer.Allocate(sizeof(GpuLight));
-    lightAllocations.emplace(id, LightAlloc{.lightAlloc = lightAlloc});
-    ctx.TeenyBufferUpdate(lightsBuffer.GetBuffer(), gpuLight, lightAlloc.offset);
+    uploads.Add(meshletInstancesBuffer.GetBuffer(), dstOffset, reinterpret_cast<const std::byte*>(meshletInstances.data()) + srcOffset, size);
   }
 
-  // Delete lights
+  // Delete lights. Lights spawned this frame have no allocation yet.
   for (auto id : deletedLights)
   {
-    auto it = lightAllocations.find(id);
-    lightsBuffer.Free(it->second.lightAlloc, commandBuffer);
-    lightAllocations.erase(it);
+    if (const auto& lightAlloc = lightAllocations.at(id).lightAlloc)
+    {
+      lightsBuffer.Free(*lightAlloc);
+    }
+    lightAllocations.Erase(id);
   }
 
-  ctx.Barrier();
+  if (const auto relocations = lightsBuffer.Compact(commandBuffer); !relocations.empty())
+  {
+    for (auto& light : lightAllocations.Values())
+    {
+      if (auto& alloc = light.lightAlloc)
+      {
+        alloc->offset = Fvog::ContiguousManagedBuffer::GetRelocatedOffset(relocations, alloc->offset);
+      }
+    }
+  }
+
+  // Spawn lights. Their initial data is uploaded like an update made before any other this frame.
+  for (const auto& [id, gpuLight] : spawnedLights)
+  {
+    if (lightAllocations.Contains(id))
+    {
+      lightAllocations.at(id).lightAlloc = lightsBuffer.Allocate(sizeof(GpuLight));
+    }
+  }
+  modifiedLights.insert(modifiedLights.begin(), spawnedLights.begin(), spawnedLights.end());
+  RemoveStaleUpdates(modifiedLights, lightAllocations);
 
   // Update mesh uniforms
   for (const auto& [id, uniforms] : modifiedMeshUniforms)
   {
     const auto offset = meshAllocations.at(id).instanceAlloc.value().GetOffset();
     assert(offset % sizeof(uniforms) == 0);
-    ctx.TeenyBufferUpdate(geometryBuffer.GetBuffer(), uniforms, offset);
+    uploads.Add(geometryBuffer.GetBuffer(), offset, uniforms);
 
     if (Fvog::GetDevice().supportsRayTracing)
     {
@@ -2045,28 +2411,110 @@ void FrogRenderer2::FlushUpdatedSceneData(VkCommandBuffer commandBuffer)
     }
   }
 
+  // Update mesh instance uniforms
+  for (const auto& [id, uniforms] : modifiedMeshInstancesUniforms)
+  {
+    auto& meshInstancesAlloc = meshInstancesAllocations.at(id);
+    uploads.Add(geometryBuffer.GetBuffer(), meshInstancesAlloc.uniformsAlloc.GetOffset(), uniforms.data(), uniforms.size() * sizeof(Render::ObjectUniforms));
+
+    if (Fvog::GetDevice().supportsRayTracing)
+    {
+      std::transform(std::execution::par,
+        uniforms.begin(),
+        uniforms.end(),
+        meshInstancesAlloc.tlasInstances.begin(),
+        meshInstancesAlloc.tlasInstances.begin(),
+        [](const Render::ObjectUniforms& instanceUniforms, Fvog::TlasInstance tlasInstance)
+        {
+          auto transformAffine = glm::transpose(glm::mat4x3(instanceUniforms.modelCurrent));
+          std::memcpy(&tlasInstance.transform, &transformAffine, sizeof(VkTransformMatrixKHR));
+          return tlasInstance;
+        });
+    }
+  }
+
+  // Keep the TLAS instances in sync. Adding or removing instances changes their order, so everything is uploaded again for a
+  // rebuild. Otherwise, only instances that moved are uploaded, and the TLAS is refit.
+  if (Fvog::GetDevice().supportsRayTracing)
+  {
+    if (!tlasInstancesBuffer || !spawnedMeshes.empty() || !deletedMeshes.empty() || !spawnedMeshInstances.empty() || !deletedMeshInstances.empty())
+    {
+      ZoneScopedN("Gather TLAS instances");
+      auto instances = std::vector<Fvog::TlasInstance>();
+      instances.reserve(tlasInstanceCount);
+      for (auto& meshAlloc : meshAllocations.Values())
+      {
+        meshAlloc.tlasInstanceIndex = uint32_t(instances.size());
+        instances.push_back(meshAlloc.tlasInstance.value());
+      }
+      for (auto& meshInstancesAlloc : meshInstancesAllocations.Values())
+      {
+        meshInstancesAlloc.firstTlasInstanceIndex = uint32_t(instances.size());
+        instances.insert(instances.end(), meshInstancesAlloc.tlasInstances.begin(), meshInstancesAlloc.tlasInstances.end());
+      }
+
+      tlasInstanceCount = uint32_t(instances.size());
+      if (!tlasInstancesBuffer || tlasInstancesBuffer->Size() < tlasInstanceCount)
+      {
+        // Leave room to grow, so spawning a few objects at a time doesn't reallocate every time
+        tlasInstancesBuffer = Fvog::TypedBuffer<Fvog::TlasInstance>({.count = std::max(tlasInstanceCount + tlasInstanceCount / 2, 1u)}, "TLAS Instances Buffer");
+      }
+
+      if (!instances.empty())
+      {
+        uploads.Add(*tlasInstancesBuffer, 0, instances.data(), instances.size() * sizeof(Fvog::TlasInstance));
+      }
+      tlasNeedsRebuild = true;
+    }
+    else
+    {
+      for (const auto& [id, uniforms] : modifiedMeshUniforms)
+      {
+        const auto& meshAlloc = meshAllocations.at(id);
+        uploads.Add(*tlasInstancesBuffer, meshAlloc.tlasInstanceIndex * sizeof(Fvog::TlasInstance), meshAlloc.tlasInstance.value());
+      }
+      for (const auto& [id, uniforms] : modifiedMeshInstancesUniforms)
+      {
+        const auto& meshInstancesAlloc = meshInstancesAllocations.at(id);
+        uploads.Add(*tlasInstancesBuffer,
+          meshInstancesAlloc.firstTlasInstanceIndex * sizeof(Fvog::TlasInstance),
+          meshInstancesAlloc.tlasInstances.data(),
+          meshInstancesAlloc.tlasInstances.size() * sizeof(Fvog::TlasInstance));
+      }
+      tlasNeedsRefit = tlasNeedsRefit || !modifiedMeshUniforms.empty() || !modifiedMeshInstancesUniforms.empty();
+    }
+  }
+
   // Update lights
   for (const auto& [id, light] : modifiedLights)
   {
-    const auto offset = lightAllocations.at(id).lightAlloc.offset;
+    const auto offset = lightAllocations.at(id).lightAlloc.value().offset;
     assert(offset % sizeof(light) == 0);
-    ctx.TeenyBufferUpdate(lightsBuffer.GetBuffer(), light, offset);
+    uploads.Add(lightsBuffer.GetBuffer(), offset, light);
   }
 
   // Update materials
+  RemoveStaleUpdates(modifiedMaterials, materialAllocations);
   for (const auto& [id, material] : modifiedMaterials)
   {
     const auto offset = materialAllocations.at(id).materialAlloc.GetOffset();
     assert(offset % sizeof(material) == 0);
-    ctx.TeenyBufferUpdate(geometryBuffer.GetBuffer(), material, offset);
+    uploads.Add(geometryBuffer.GetBuffer(), offset, material);
   }
 
+  // Wait for the copies made when compacting contiguous buffers
+  ctx.Barrier();
+  uploads.Dispatch(ctx, scatterUploadPipeline.GetPipeline(), scatterUploadBuffers[Fvog::GetDevice().frameNumber % Fvog::Device::frameOverlap]);
+
   ctx.Barrier();
   modifiedMeshUniforms.clear();
+  modifiedMeshInstancesUniforms.clear();
   modifiedLights.clear();
   modifiedMaterials.clear();
   deletedMeshes.clear();
   spawnedMeshes.clear();
+  deletedMeshInstances.clear();
+  spawnedMeshInstances.clear();
   deletedLights.clear();
   spawnedLights.clear();
 }
@@ -9,6 +9,7 @@
 #include "debug/ForwardRenderer.h"
 #include "techniques/ao/RayTracedAO.h"
 #include "PipelineManager.h"
+#include "SlotMap.h"
 
 #ifdef FROGRENDER_FSR2_ENABLE
   #include "src/ffx-fsr2-api/ffx_fsr2.h"
@@ -154,10 +155,13 @@ public:
   struct MeshGeometryInfo
   {
     std::pmr::vector<Render::Meshlet> meshlets;
-    std::pmr::vector<Render::Vertex> vertices;
+    std::pmr::vector<Render::QuantizedPosition> positions;
+    std::pmr::vector<Render::VertexAttributes> attributes;
+    std::pmr::vector<glm::vec2> texcoords; // Empty unless the texcoords couldn't be quantized
     std::pmr::vector<Render::index_t> remappedIndices;
     std::pmr::vector<Render::primitive_t> primitives;
     std::pmr::vector<Render::index_t> originalIndices;
+    Render::VertexDequantization dequantization;
   };
 
   // Life and death
@@ -167,6 +171,11 @@ public:
   [[nodiscard]] Render::MeshID SpawnMesh(Render::MeshGeometryID meshGeometry);
   void DeleteMesh(Render::MeshID mesh);
 
+  // Spawns many instances of one mesh at once. Their object uniforms and meshlet instances are each allocated as one range,
+  // which is far cheaper than calling SpawnMesh() for every instance.
+  [[nodiscard]] Render::MeshInstancesID SpawnMeshInstances(Render::MeshGeometryID meshGeometry, uint32_t instanceCount);
+  void DeleteMeshInstances(Render::MeshInstancesID meshInstances);
+
   [[nodiscard]] Render::LightID SpawnLight(const GpuLight& lightData);
   void DeleteLight(Render::LightID light);
 
@@ -174,7 +183,15 @@ public:
   void UnregisterMaterial(Render::MaterialID material);
 
   // Updating
+  // The dequantization transform of the mesh's geometry is applied to the model matrices
   void UpdateMesh(Render::MeshID mesh, const Render::ObjectUniforms& uniforms);
+  // Same as calling UpdateMesh for each mesh, but the model matrices are dequantized in parallel
+  void UpdateMeshes(std::span<const Render::MeshID> meshes, std::span<const Render::ObjectUniforms> uniforms);
+  // Sets the transform of instance i to parentTransform * instanceTransforms[i]. Transforms are computed in parallel.
+  void UpdateMeshInstances(Render::MeshInstancesID meshInstances,
+    Render::MaterialID material,
+    const glm::mat4& parentTransform,
+    std::span<const glm::mat4> instanceTransforms);
   void UpdateLight(Render::LightID light, const GpuLight& lightData);
   void UpdateMaterial(Render::MaterialID material, const Render::GpuMaterial& materialData);
 
@@ -183,8 +200,9 @@ public:
   Render::Material& GetMaterial(Render::MaterialID material);
 
   // Hacky functions, need better interface for this
+  VkDeviceAddress GetPositionBufferPointerFromMesh(Render::MeshID meshId);
   VkDeviceAddress GetVertexBufferPointerFromMesh(Render::MeshID meshId);
-  VkDeviceAddress GetOriginalIndexBufferPointerFromMesh(Render::MeshID meshId);
+  uint32_t GetMeshletOffsetFromMesh(Render::MeshID meshId);
 
 private:
   struct ViewParams;
@@ -226,6 +244,8 @@ private:
     CULL_PRIMITIVE_SMALL    = 1 << 4,
     CULL_PRIMITIVE_VSM      = 1 << 5,
     USE_HASHED_TRANSPARENCY = 1 << 6,
+    USE_MESHLET_LOD         = 1 << 7,
+    CULL_MESHLET_BACKFACE   = 1 << 8,
   };
 
   struct GlobalUniforms
@@ -242,15 +262,19 @@ private:
     float bindlessSamplerLodBias;
     uint32_t flags = 
       (uint32_t)GlobalFlags::CULL_MESHLET_FRUSTUM |
-      (uint32_t)GlobalFlags::CULL_MESHLET_HIZ /*|
+      (uint32_t)GlobalFlags::CULL_MESHLET_HIZ |
+      (uint32_t)GlobalFlags::CULL_MESHLET_BACKFACE /*|
       (uint32_t)GlobalFlags::CULL_PRIMITIVE_BACKFACE |
       (uint32_t)GlobalFlags::CULL_PRIMITIVE_FRUSTUM |
       (uint32_t)GlobalFlags::CULL_PRIMITIVE_SMALL |
       (uint32_t)GlobalFlags::CULL_PRIMITIVE_VSM*/
     | (uint32_t)GlobalFlags::USE_HASHED_TRANSPARENCY
+    | (uint32_t)GlobalFlags::USE_MESHLET_LOD
       ;
     float alphaHashScale = 1.0;
-    uint32_t _padding[3];
+    float lodErrorThreshold = 1.0; // In pixels
+    float lodProjectionScale; // Converts view-space error/distance to pixels
+    uint32_t _padding[1];
   };
 
   enum class ViewType : uint32_t
@@ -384,17 +408,27 @@ private:
   struct MeshGeometryAllocs
   {
     Fvog::ManagedBuffer::Alloc meshletsAlloc;
-    Fvog::ManagedBuffer::Alloc verticesAlloc;
+    Fvog::ManagedBuffer::Alloc positionsAlloc;
+    Fvog::ManagedBuffer::Alloc attributesAlloc;
+    std::optional<Fvog::ManagedBuffer::Alloc> texcoordsAlloc; // Only for geometry with full-precision texcoords
     Fvog::ManagedBuffer::Alloc indicesAlloc;
     Fvog::ManagedBuffer::Alloc primitivesAlloc;
-    Fvog::ManagedBuffer::Alloc originalIndicesAlloc;
+    std::optional<Fvog::ManagedBuffer::Alloc> originalIndicesAlloc; // Only resident if keepOriginalIndices was set when the geometry was registered
+    size_t originalIndexCount;
+    uint32_t baseMeshletCount; // The full-detail meshlets come first and cover every original triangle exactly once
+    std::optional<Fvog::ManagedBuffer::Alloc> blasMeshletStartsAlloc; // BLAS primitive index of each full-detail meshlet's first triangle
     std::optional<Fvog::Blas> blas;
+    Render::VertexDequantization dequantization;
   };
 
+  // Fills in the parts of the object uniforms that describe where its geometry lives
+  void SetGeometryUniforms(const MeshGeometryAllocs& meshGeometryAllocs, Render::ObjectUniforms& uniforms);
+
   size_t totalMeshlets = 0;
   size_t totalVertices = 0;
   size_t totalRemappedIndices = 0;
   size_t totalOriginalIndices = 0;
+  size_t droppedOriginalIndexBytes = 0; // Geometry buffer memory saved by not keeping original indices resident
   size_t totalPrimitives = 0;
   size_t totalBlasMemory = 0;
 
@@ -404,11 +438,22 @@ private:
     std::optional<Fvog::ContiguousManagedBuffer::Alloc> meshletInstancesAlloc;
     std::optional<Fvog::ManagedBuffer::Alloc> instanceAlloc;
     std::optional<Fvog::TlasInstance> tlasInstance;
+    uint32_t tlasInstanceIndex = 0; // Position of tlasInstance in tlasInstancesBuffer
+  };
+
+  struct MeshInstancesAllocs
+  {
+    Render::MeshGeometryID geometryId;
+    uint32_t instanceCount;
+    Fvog::ManagedBuffer::Alloc uniformsAlloc; // instanceCount ObjectUniforms
+    std::optional<Fvog::ContiguousManagedBuffer::Alloc> meshletInstancesAlloc;
+    std::vector<Fvog::TlasInstance> tlasInstances;
+    uint32_t firstTlasInstanceIndex = 0;
   };
 
   struct LightAlloc
   {
-    Fvog::ContiguousManagedBuffer::Alloc lightAlloc;
+    std::optional<Fvog::ContiguousManagedBuffer::Alloc> lightAlloc; // Allocated when the spawned light is flushed
   };
 
   struct MaterialAlloc
@@ -423,6 +468,16 @@ private:
   Fvog::ContiguousManagedBuffer lightsBuffer;
   std::optional<Fvog::Tlas> tlas;
 
+  // Instances of every mesh and mesh instance group, in the same order as their allocations.
+  // Only instances that moved are uploaded, in which case the TLAS is refit. It is rebuilt when instances are added or removed.
+  std::optional<Fvog::TypedBuffer<Fvog::TlasInstance>> tlasInstancesBuffer;
+  uint32_t tlasInstanceCount    = 0;
+  bool tlasNeedsRebuild         = true;
+  bool tlasNeedsRefit           = false;
+  uint32_t tlasRefitsSinceBuild = 0;
+  // Refits make the TLAS slower to trace as instances move away from where it was built, so it is rebuilt after this many
+  uint32_t tlasMaxRefits = 60;
+
   uint32_t NumMeshletInstances() const noexcept
   {
     return (uint32_t)meshletInstancesBuffer.GetCurrentSize() / sizeof(Render::MeshletInstance);
@@ -433,12 +488,12 @@ private:
     return (uint32_t)lightsBuffer.GetCurrentSize() / sizeof(GpuLight);
   }
 
-  uint64_t nextId = 1; // 0 is reserved for "null" IDs
-  std::unordered_map<uint64_t, MeshGeometryAllocs> meshGeometryAllocations;
-
-  std::unordered_map<uint64_t, MeshAllocs> meshAllocations;
-  std::unordered_map<uint64_t, LightAlloc> lightAllocations;
-  std::unordered_map<uint64_t, MaterialAlloc> materialAllocations;
+  // Render IDs are keys into these
+  Utility::SlotMap<MeshGeometryAllocs> meshGeometryAllocations;
+  Utility::SlotMap<MeshAllocs> meshAllocations;
+  Utility::SlotMap<MeshInstancesAllocs> meshInstancesAllocations;
+  Utility::SlotMap<LightAlloc> lightAllocations;
+  Utility::SlotMap<MaterialAlloc> materialAllocations;
 
   // Will be batch uploaded
   struct SpawnedMesh
@@ -447,11 +502,15 @@ private:
     Render::MeshGeometryID meshGeometryId;
   };
 
-  std::unordered_map<uint64_t, Render::ObjectUniforms> modifiedMeshUniforms;
-  std::unordered_map<uint64_t, GpuLight> modifiedLights;
-  std::unordered_map<uint64_t, Render::GpuMaterial> modifiedMaterials;
+  // Updates are appended in the order they were made, so later updates of the same ID win when they are flushed
+  std::vector<std::pair<uint64_t, Render::ObjectUniforms>> modifiedMeshUniforms;
+  std::vector<std::pair<uint64_t, GpuLight>> modifiedLights;
+  std::vector<std::pair<uint64_t, Render::GpuMaterial>> modifiedMaterials;
   std::vector<SpawnedMesh> spawnedMeshes;
   std::vector<uint64_t> deletedMeshes;
+  std::vector<std::pair<uint64_t, std::vector<Render::ObjectUniforms>>> modifiedMeshInstancesUniforms;
+  std::vector<uint64_t> spawnedMeshInstances;
+  std::vector<uint64_t> deletedMeshInstances;
   std::vector<std::pair<uint64_t, GpuLight>> spawnedLights;
   std::vector<uint64_t> deletedLights;
 
@@ -471,10 +530,14 @@ private:
   std::optional<Fvog::TypedBuffer<uint32_t>> persistentVisibleMeshletIds; // For when the data needs to be retrieved later (i.e. it is stored in the visbuffer)
   std::optional<Fvog::TypedBuffer<uint32_t>> transientVisibleMeshletIds;  // For shadows or forward passes
 
+  // Scene updates are packed into these each frame, one per frame in flight so the GPU never reads one that's being written
+  std::optional<Fvog::Buffer> scatterUploadBuffers[Fvog::Device::frameOverlap];
+
   PipelineManager::ComputePipelineKey cullMeshletsPipeline;
   PipelineManager::ComputePipelineKey cullTrianglesPipeline;
   PipelineManager::ComputePipelineKey hzbCopyPipeline;
   PipelineManager::ComputePipelineKey hzbReducePipeline;
+  PipelineManager::ComputePipelineKey scatterUploadPipeline;
   PipelineManager::GraphicsPipelineKey visbufferPipeline;
   PipelineManager::GraphicsPipelineKey visbufferResolvePipeline;
   PipelineManager::GraphicsPipelineKey shadingPipeline;
@@ -492,6 +555,8 @@ private:
 
   // Debug
   bool debugDrawForwardRender_   = false;
+  // Keeps the original index buffer of geometry registered from then on resident, which the debug forward renderer needs
+  bool keepOriginalIndices       = false;
   bool showPerfWindow            = true;
   bool showHdrWindow             = true;
   bool showComponentEditorWindow = true;
@@ -512,6 +577,12 @@ private:
   // Scene
   Scene::SceneMeshlet scene;
 
+  // Limits how much of a streamed-in model is imported each frame, to keep frame times reasonable while loading
+  Scene::ImportJob::Budget importBudget = {
+    .time  = std::chrono::duration<double, std::milli>(4),
+    .bytes = 64'000'000,
+  };
+
   enum DisplayMap
   {
     AgX,
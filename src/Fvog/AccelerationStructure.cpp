@@ -3,6 +3,8 @@
 
 #include <volk.h>
 
+#include <algorithm>
+#include <cassert>
 #include <utility>
 
 namespace Fvog
@@ -20,6 +22,21 @@ namespace Fvog
         GetDevice().ImmediateSubmit(fn);
       }
     }
+
+    VkAccelerationStructureGeometryKHR MakeTlasGeometryInfo(const TlasCreateInfo& createInfo)
+    {
+      return {
+        .sType        = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
+        .geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR,
+        .geometry     = {.instances =
+                           {
+                             .sType           = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR,
+                             .arrayOfPointers = false,
+                             .data            = createInfo.instanceBuffer->GetDeviceAddress(),
+                       }},
+        .flags        = static_cast<VkGeometryFlagsKHR>(createInfo.geoemtryFlags),
+      };
+    }
   } // namespace
 
   Blas::Blas(const BlasCreateInfo& createInfo, std::string name) : createInfo_(createInfo)
@@ -260,19 +277,11 @@ namespace Fvog
 
   Tlas::Tlas(const TlasCreateInfo& createInfo, std::string name) : createInfo_(createInfo)
   {
-    const VkAccelerationStructureGeometryKHR geometryInfo = {
-      .sType        = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
-      .geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR,
-      .geometry     = {.instances =
-                         {
-                           .sType           = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR,
-                           .arrayOfPointers = false,
-                           .data            = createInfo.instanceBuffer->GetDeviceAddress(),
-                     }},
-      .flags        = static_cast<VkGeometryFlagsKHR>(createInfo.geoemtryFlags),
-    };
+    const auto geometryInfo = MakeTlasGeometryInfo(createInfo);
 
-    const uint32_t instanceCount = uint32_t(createInfo.instanceBuffer->SizeBytes() / sizeof(TlasInstance));
+    const uint32_t instanceCount = createInfo.instanceCount.value_or(uint32_t(createInfo.instanceBuffer->SizeBytes() / sizeof(TlasInstance)));
+    assert(instanceCount * sizeof(TlasInstance) <= createInfo.instanceBuffer->SizeBytes());
+    instanceCount_ = instanceCount;
 
     VkAccelerationStructureBuildGeometryInfoKHR buildInfo = {
       .sType         = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
@@ -311,6 +320,16 @@ namespace Fvog
         .flag = BufferFlagThingy::NO_DESCRIPTOR,
       },
       name + " TLAS Scratch Buffer");
+
+    if (createInfo.buildFlags & AccelerationStructureBuildFlag::ALLOW_UPDATE)
+    {
+      updateScratchBuffer_.emplace(
+        BufferCreateInfo{
+          .size = std::max<VkDeviceSize>(buildSizeInfo.updateScratchSize, 1),
+          .flag = BufferFlagThingy::NO_DESCRIPTOR,
+        },
+        name + " TLAS Update Scratch Buffer");
+    }
     
     RecordOrImmediateSubmit(createInfo.commandBuffer,
       [&](VkCommandBuffer commandBuffer)
@@ -473,6 +492,8 @@ namespace Fvog
       buffer_(std::move(other.buffer_)),
       address_(std::exchange(other.address_, {})),
       descriptorInfo_(std::move(other.descriptorInfo_)),
+      instanceCount_(std::exchange(other.instanceCount_, 0)),
+      updateScratchBuffer_(std::move(other.updateScratchBuffer_)),
       createInfo_(std::exchange(other.createInfo_, {}))
   {
   }
@@ -486,4 +507,51 @@ namespace Fvog
     this->~Tlas();
     return *new (this) Tlas(std::move(other));
   }
+
+  void Tlas::Update(VkCommandBuffer commandBuffer)
+  {
+    assert(updateScratchBuffer_ && "TLAS was not built with ALLOW_UPDATE");
+
+    const auto geometryInfo = MakeTlasGeometryInfo(createInfo_);
+
+    const VkAccelerationStructureBuildGeometryInfoKHR buildInfo = {
+      .sType                    = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+      .type                     = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
+      .flags                    = static_cast<VkBuildAccelerationStructureFlagsKHR>(createInfo_.buildFlags),
+      .mode                     = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR,
+      .srcAccelerationStructure = handle_,
+      .dstAccelerationStructure = handle_,
+      .geometryCount            = 1,
+      .pGeometries              = &geometryInfo,
+      .scratchData              = {updateScratchBuffer_->GetDeviceAddress()},
+    };
+
+    // Unlike a build into a new TLAS, previously recorded traces and updates of this one must finish first
+    vkCmdPipelineBarrier2(commandBuffer,
+      detail::Address(VkDependencyInfo{
+        .sType              = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers    = detail::Address(VkMemoryBarrier2{
+             .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+             .srcStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+             .srcAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+             .dstStageMask  = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+             .dstAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+        }),
+      }));
+    VkAccelerationStructureBuildRangeInfoKHR buildRangeInfo = {.primitiveCount = instanceCount_};
+    vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &buildInfo, detail::Address(&buildRangeInfo));
+    vkCmdPipelineBarrier2(commandBuffer,
+      detail::Address(VkDependencyInfo{
+        .sType              = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers    = detail::Address(VkMemoryBarrier2{
+             .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+             .srcStageMask  = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+             .srcAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+             .dstStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+             .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+        }),
+      }));
+  }
 } // namespace Fvog
@@ -116,6 +116,8 @@ namespace Fvog
     AccelerationStructureBuildFlags buildFlags       = {};
 
     const Buffer* instanceBuffer = nullptr;
+    // Defaults to every instance that fits in instanceBuffer
+    std::optional<uint32_t> instanceCount = {};
   };
 
   class Tlas
@@ -129,6 +131,10 @@ namespace Fvog
     Tlas(Tlas&& other) noexcept;
     Tlas& operator=(Tlas&& other) noexcept;
 
+    // Refits the TLAS in place to the current contents of the instance buffer, which must hold the same instances it was built with.
+    // Requires AccelerationStructureBuildFlag::ALLOW_UPDATE.
+    void Update(VkCommandBuffer commandBuffer);
+
     VkAccelerationStructureKHR Handle() const noexcept
     {
       return handle_;
@@ -161,6 +167,9 @@ namespace Fvog
     // Address of the acceleration structure
     VkDeviceSize address_;
     std::optional<Device::DescriptorInfo> descriptorInfo_;
+    uint32_t instanceCount_;
+    // Only exists if the TLAS allows updates
+    std::optional<Buffer> updateScratchBuffer_;
 
     TlasCreateInfo createInfo_;
   };
@@ -9,8 +9,10 @@
 
 #include <tracy/Tracy.hpp>
 
+#include <algorithm>
 #include <bit>
 #include <cstddef>
+#include <iterator>
 #include <utility>
 
 namespace Fvog
@@ -301,6 +303,7 @@ namespace Fvog
 
   ContiguousManagedBuffer::Alloc ContiguousManagedBuffer::Allocate(size_t size)
   {
+    assert(pendingFrees_.empty());
     assert(currentSize_ + size <= buffer_.SizeBytes());
     assert(size > 0);
     const auto alloc = Alloc{currentSize_, size};
@@ -309,17 +312,86 @@ namespace Fvog
     return alloc;
   }
 
-  void ContiguousManagedBuffer::Free(Alloc allocation, VkCommandBuffer commandBuffer)
+  void ContiguousManagedBuffer::Free(Alloc allocation)
   {
-    // Copy allocation.size bytes from the end of buffer_ to freed allocation, then pop.
-    auto ctx = Context(commandBuffer);
-    ctx.Barrier();
-    ctx.CopyBuffer(buffer_, buffer_, {
-      .srcOffset = currentSize_ - allocation.size,
-      .dstOffset = allocation.offset,
-      .size = allocation.size,
-    });
-
-    currentSize_ -= allocation.size;
+    assert(allocation.offset + allocation.size <= currentSize_);
+    pendingFrees_.push_back(allocation);
+  }
+
+  std::vector<ContiguousManagedBuffer::Relocation> ContiguousManagedBuffer::Compact(VkCommandBuffer commandBuffer)
+  {
+    ZoneScoped;
+    if (pendingFrees_.empty())
+    {
+      return {};
+    }
+
+    ZoneTextF("Frees: %zu", pendingFrees_.size());
+
+    std::ranges::sort(pendingFrees_, {}, &Alloc::offset);
+
+    // Each live range between two holes moves down by the total size of the holes before it
+    const auto firstHole = pendingFrees_.front().offset;
+    auto relocations     = std::vector<Relocation>();
+    auto freedBytes      = size_t(0);
+    for (size_t i = 0; i < pendingFrees_.size(); i++)
+    {
+      const auto& freed = pendingFrees_[i];
+      assert(i == 0 || pendingFrees_[i - 1].offset + pendingFrees_[i - 1].size <= freed.offset);
+      freedBytes += freed.size;
+
+      const auto liveBegin = freed.offset + freed.size;
+      const auto liveEnd   = i + 1 < pendingFrees_.size() ? pendingFrees_[i + 1].offset : currentSize_;
+      if (liveEnd > liveBegin)
+      {
+        relocations.push_back({.oldOffset = liveBegin, .newOffset = liveBegin - freedBytes, .size = liveEnd - liveBegin});
+      }
+    }
+
+    // Live ranges are gathered into a scratch buffer and copied back in one piece, since moving them in place would overlap
+    if (!relocations.empty())
+    {
+      auto gatherCopies = std::vector<CopyBufferInfo>();
+      gatherCopies.reserve(relocations.size());
+      for (const auto& relocation : relocations)
+      {
+        gatherCopies.push_back({
+          .srcOffset = relocation.oldOffset,
+          .dstOffset = relocation.newOffset - firstHole,
+          .size      = relocation.size,
+        });
+      }
+
+      const auto movedBytes = currentSize_ - freedBytes - firstHole;
+      auto scratch          = Buffer({.size = movedBytes, .flag = BufferFlagThingy::NO_DESCRIPTOR}, "Compaction Scratch Buffer");
+
+      auto ctx = Context(commandBuffer);
+      ctx.Barrier();
+      ctx.CopyBuffer(buffer_, scratch, gatherCopies);
+      ctx.Barrier();
+      ctx.CopyBuffer(scratch, buffer_, {
+        .srcOffset = 0,
+        .dstOffset = firstHole,
+        .size      = movedBytes,
+      });
+    }
+
+    currentSize_ -= freedBytes;
+    pendingFrees_.clear();
+    return relocations;
+  }
+
+  size_t ContiguousManagedBuffer::GetRelocatedOffset(std::span<const Relocation> relocations, size_t oldOffset)
+  {
+    // Offsets before the first moved range were not moved
+    const auto it = std::ranges::upper_bound(relocations, oldOffset, {}, &Relocation::oldOffset);
+    if (it == relocations.begin())
+    {
+      return oldOffset;
+    }
+
+    const auto& relocation = *std::prev(it);
+    assert(oldOffset < relocation.oldOffset + relocation.size);
+    return relocation.newOffset + (oldOffset - relocation.oldOffset);
   }
 } // namespace Fvog
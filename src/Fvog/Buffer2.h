@@ -10,6 +10,8 @@
 #include <string_view>
 #include <optional>
 #include <cstddef>
+#include <span>
+#include <vector>
 
 namespace Fvog
 {
@@ -276,8 +278,8 @@ namespace Fvog
     VmaVirtualBlock allocator{};
   };
 
-  // Stores data contiguously, but without stable order, in a tightly packed array.
-  // Ranges are deleted with a variant of the copy-pop pattern.
+  // Stores data contiguously, in allocation order, in a tightly packed array.
+  // Freed ranges are removed in batches by Compact, which shifts the remaining data down to close the holes.
   class ContiguousManagedBuffer
   {
   public:
@@ -288,10 +290,27 @@ namespace Fvog
       size_t size;
     };
 
+    // A range of live data that was moved by Compact. Allocations within it move by the same amount.
+    struct Relocation
+    {
+      size_t oldOffset;
+      size_t newOffset;
+      size_t size;
+    };
+
     explicit ContiguousManagedBuffer(size_t bufferSize, std::string name = {});
 
+    // Must not be called while frees are pending, since the returned allocation would be moved by the next Compact
     [[nodiscard]] Alloc Allocate(size_t size);
-    void Free(Alloc allocation, VkCommandBuffer commandBuffer);
+
+    // The allocation's data stays in place until the next Compact
+    void Free(Alloc allocation);
+
+    // Removes every freed allocation with two copies, regardless of how many there are.
+    // Returns the moved ranges sorted by old offset. Use GetRelocatedOffset to update allocations made before this call.
+    [[nodiscard]] std::vector<Relocation> Compact(VkCommandBuffer commandBuffer);
+
+    [[nodiscard]] static size_t GetRelocatedOffset(std::span<const Relocation> relocations, size_t oldOffset);
 
     [[nodiscard]] Buffer& GetBuffer() noexcept
     {
@@ -311,5 +330,6 @@ namespace Fvog
   private:
     Buffer buffer_;
     size_t currentSize_ = 0;
+    std::vector<Alloc> pendingFrees_;
   };
 }
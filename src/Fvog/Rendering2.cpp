@@ -321,6 +321,35 @@ namespace Fvog
     }));
   }
 
+  void Context::CopyBuffer(const Buffer& src, Buffer& dst, std::span<const CopyBufferInfo> copyInfos)
+  {
+    ZoneScoped;
+    if (copyInfos.empty())
+    {
+      return;
+    }
+
+    auto regions = std::vector<VkBufferCopy2>();
+    regions.reserve(copyInfos.size());
+    for (const auto& copyInfo : copyInfos)
+    {
+      regions.push_back({
+        .sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2,
+        .srcOffset = copyInfo.srcOffset,
+        .dstOffset = copyInfo.dstOffset,
+        .size = copyInfo.size,
+      });
+    }
+
+    vkCmdCopyBuffer2(commandBuffer_, Address(VkCopyBufferInfo2{
+      .sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2,
+      .srcBuffer = src.Handle(),
+      .dstBuffer = dst.Handle(),
+      .regionCount = static_cast<uint32_t>(regions.size()),
+      .pRegions = regions.data(),
+    }));
+  }
+
   void Context::TeenyBufferUpdate(Buffer& buffer, TriviallyCopyableByteSpan data, size_t offset) const
   {
     ZoneScoped;
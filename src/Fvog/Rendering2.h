@@ -178,6 +178,8 @@ namespace Fvog
     // Texture layout must be TRANSFER_DST_OPTIMAL or GENERAL
     void CopyBufferToTexture(const Buffer& src, Texture& dst, const TextureUpdateInfo& info);
     void CopyBuffer(const Buffer& src, Buffer& dst, const CopyBufferInfo& copyInfo);
+    // Copies every region with one command. Regions must not overlap in dst, or in memory if src and dst are the same buffer.
+    void CopyBuffer(const Buffer& src, Buffer& dst, std::span<const CopyBufferInfo> copyInfos);
 
     template<typename T>
       requires std::is_trivially_copyable_v<T>
@@ -928,12 +928,28 @@ void FrogRenderer2::GuiDrawDebugWindow(VkCommandBuffer)
     Gui::BeginProperties();
     Gui::FlagCheckbox("Meshlet: Frustum", &globalUniforms.flags, (uint32_t)GlobalFlags::CULL_MESHLET_FRUSTUM);
     Gui::FlagCheckbox("Meshlet: Hi-z", &globalUniforms.flags, (uint32_t)GlobalFlags::CULL_MESHLET_HIZ);
+    Gui::FlagCheckbox("Meshlet: Back-facing", &globalUniforms.flags, (uint32_t)GlobalFlags::CULL_MESHLET_BACKFACE, "Uses normal cones. Meshlets of double-sided materials are never culled");
     Gui::FlagCheckbox("Primitive: Back-facing", &globalUniforms.flags, (uint32_t)GlobalFlags::CULL_PRIMITIVE_BACKFACE);
     Gui::FlagCheckbox("Primitive: Frustum", &globalUniforms.flags, (uint32_t)GlobalFlags::CULL_PRIMITIVE_FRUSTUM);
     Gui::FlagCheckbox("Primitive: Small", &globalUniforms.flags, (uint32_t)GlobalFlags::CULL_PRIMITIVE_SMALL);
     Gui::FlagCheckbox("Primitive: VSM", &globalUniforms.flags, (uint32_t)GlobalFlags::CULL_PRIMITIVE_VSM);
     Gui::EndProperties();
 
+    ImGui::SeparatorText("Level of Detail");
+    Gui::BeginProperties();
+    Gui::FlagCheckbox("Meshlet LOD", &globalUniforms.flags, (uint32_t)GlobalFlags::USE_MESHLET_LOD, "If disabled, only meshlets without simplification error are drawn");
+    Gui::SliderFloat("Error Threshold", &globalUniforms.lodErrorThreshold, 0.1f, 16.0f, "Largest tolerated geometric error of a meshlet, in pixels", "%.1f px", ImGuiSliderFlags_Logarithmic);
+    Gui::EndProperties();
+
+    ImGui::SeparatorText("Ray Tracing");
+    ImGui::BeginDisabled(!Fvog::GetDevice().supportsRayTracing);
+    Gui::BeginProperties();
+    constexpr uint32_t minRefits = 0;
+    constexpr uint32_t maxRefits = 1000;
+    Gui::SliderScalar("TLAS Refits", ImGuiDataType_U32, &tlasMaxRefits, &minRefits, &maxRefits, "Moving objects refits the TLAS, which gets slower to trace the further they move. It is rebuilt after this many refits", "%u");
+    Gui::EndProperties();
+    ImGui::EndDisabled();
+
     ImGui::SeparatorText("Virtual Shadow Maps");
     ImGui_FlagCheckbox("Show Clipmap ID", &shadingUniforms.debugFlags, VSM_SHOW_CLIPMAP_ID);
     ImGui_FlagCheckbox("Show Page Address", &shadingUniforms.debugFlags, VSM_SHOW_PAGE_ADDRESS);
@@ -1454,6 +1470,20 @@ void FrogRenderer2::GuiDrawSceneGraph(VkCommandBuffer)
 
   if (ImGui::Begin("Scene Graph##scene_graph_window", &showSceneGraphWindow, ImGuiWindowFlags_NoFocusOnAppearing))
   {
+    for (const auto& job : scene.importJobs)
+    {
+      const char* stage = "";
+      switch (job.GetStage())
+      {
+      case Scene::ImportJob::Stage::LOADING: stage = "Loading"; break;
+      case Scene::ImportJob::Stage::UPLOADING_IMAGES: stage = "Uploading images"; break;
+      case Scene::ImportJob::Stage::WAITING_FOR_IMAGES: stage = "Waiting for images"; break;
+      case Scene::ImportJob::Stage::REGISTERING_GEOMETRY: stage = "Registering geometry"; break;
+      case Scene::ImportJob::Stage::DONE: stage = "Done"; break;
+      }
+      ImGui::ProgressBar(job.GetProgress(), ImVec2(-FLT_MIN, 0), (job.GetName() + ": " + stage).c_str());
+    }
+
     ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2{});
     ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2{});
     ImGui::BeginTable("scene hierarchy", 1, ImGuiTableFlags_RowBg | ImGuiTableFlags_NoBordersInBody);
@@ -1667,16 +1697,19 @@ void FrogRenderer2::GuiDrawComponentEditor(VkCommandBuffer commandBuffer)
     if (auto* p = std::get_if<Scene::Node*>(&selectedThingy))
     {
       auto node = *p;
+      auto& translation = scene.transforms.translations[node->transformIndex];
+      auto& rotation    = scene.transforms.rotations[node->transformIndex];
+      auto& scale       = scene.transforms.scales[node->transformIndex];
       
       Gui::BeginProperties(ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingFixedFit);
-      bool modified = Gui::DragFloat3("Position", glm::value_ptr(node->translation), 0.0625f);
-      auto euler = glm::eulerAngles(node->rotation);
+      bool modified = Gui::DragFloat3("Position", glm::value_ptr(translation), 0.0625f);
+      auto euler = glm::eulerAngles(rotation);
       if (Gui::DragFloat3("Rotation", glm::value_ptr(euler), 1.0f / 64))
       {
-        node->rotation = glm::quat(euler);
+        rotation = glm::quat(euler);
         modified = true;
       }
-      modified |= Gui::DragFloat3("Scale", glm::value_ptr(node->scale), 1.0f / 64, 1.0f / 32, 10000, "%.3f", ImGuiSliderFlags_NoRoundToFormat);
+      modified |= Gui::DragFloat3("Scale", glm::value_ptr(scale), 1.0f / 64, 1.0f / 32, 10000, "%.3f", ImGuiSliderFlags_NoRoundToFormat);
       Gui::EndProperties();
 
       if (node->lightId)
@@ -1686,7 +1719,7 @@ void FrogRenderer2::GuiDrawComponentEditor(VkCommandBuffer commandBuffer)
 
       if (modified)
       {
-        node->MarkDirty();
+        scene.MarkDirty(*node);
       }
     }
     
@@ -1865,6 +1898,13 @@ void FrogRenderer2::GuiDrawGeometryInspector(VkCommandBuffer)
     vmaGetVirtualBlockStatistics(geometryBuffer.GetVirtualBlock(), &statistics);
     Gui::Text("Total size", "%llu", "Number of bytes in the geometry buffer.", geometryBuffer.GetBuffer().SizeBytes());
     Gui::Text("Bytes used", "%llu", "The number of bytes consumed by geometry.", statistics.allocationBytes);
+    auto [droppedSuffix, droppedDivisor] = Math::BytesToSuffixAndDivisor(droppedOriginalIndexBytes);
+    Gui::Text("Original indices dropped",
+      "%.2f %s",
+      "Geometry buffer memory saved by not keeping the original index buffers of meshes resident.",
+      droppedOriginalIndexBytes / droppedDivisor,
+      droppedSuffix);
+    Gui::Checkbox("Keep original indices", &keepOriginalIndices, "Keep the original index buffers of meshes that are loaded from now on, so the geometry inspector can show them.");
     Gui::EndProperties();
 
     if (ImGui::Button("Download Geometry"))
@@ -1962,31 +2002,44 @@ void FrogRenderer2::GuiDrawGeometryInspector(VkCommandBuffer)
               ImGui::TableSetupColumn("UV");
               ImGui::TableHeadersRow();
 
-              const size_t start   = allocs.verticesAlloc.GetOffset() / sizeof(Render::Vertex);
-              const size_t end     = (allocs.verticesAlloc.GetOffset() + allocs.verticesAlloc.GetDataSize()) / sizeof(Render::Vertex);
-              const auto* vertices = reinterpret_cast<const Render::Vertex*>(geometryBufferData_.get());
-              for (size_t i = start; i < end; i++)
+              // Both streams have the same number of elements
+              const size_t positionStart  = allocs.positionsAlloc.GetOffset() / sizeof(Render::QuantizedPosition);
+              const size_t attributeStart = allocs.attributesAlloc.GetOffset() / sizeof(Render::VertexAttributes);
+              const size_t count          = allocs.positionsAlloc.GetDataSize() / sizeof(Render::QuantizedPosition);
+              const auto* positions       = reinterpret_cast<const Render::QuantizedPosition*>(geometryBufferData_.get());
+              const auto* attributes      = reinterpret_cast<const Render::VertexAttributes*>(geometryBufferData_.get());
+              const auto& dequantization  = allocs.dequantization;
+              for (size_t i = 0; i < count; i++)
               {
+                const auto& quantized = positions[positionStart + i];
+                const auto& attribute = attributes[attributeStart + i];
+
                 ImGui::TableNextRow();
 
                 ImGui::TableNextColumn();
-                ImGui::Text("%llu", i);
+                ImGui::Text("%llu", positionStart + i);
 
                 ImGui::TableNextColumn();
-                ImGui::Text("%llu", i - start);
+                ImGui::Text("%llu", i);
 
                 ImGui::TableNextColumn();
-                ImGui::Text("(%.2f, %.2f, %.2f)", vertices[i].position.x, vertices[i].position.y, vertices[i].position.z);
+                const auto position = dequantization.positionOffset + glm::vec3(quantized.x, quantized.y, quantized.z) / 32767.0f * dequantization.positionScale;
+                ImGui::Text("(%.2f, %.2f, %.2f)", position.x, position.y, position.z);
 
                 ImGui::TableNextColumn();
-                ImGui::Text("%u", vertices[i].normal);
+                ImGui::Text("%u", attribute.normal);
 
                 ImGui::TableNextColumn();
-                auto norm = Math::OctToVec3(vertices[i].normal);
+                auto norm = Math::OctToVec3(attribute.normal);
                 ImGui::Text("(%.2f, %.2f, %.2f)", norm.x, norm.y, norm.z);
 
                 ImGui::TableNextColumn();
-                ImGui::Text("(%.2f, %.2f)", vertices[i].texcoord.x, vertices[i].texcoord.y);
+                auto texcoord = dequantization.texcoordOffset + glm::unpackUnorm2x16(attribute.texcoord) * dequantization.texcoordScale;
+                if (allocs.texcoordsAlloc)
+                {
+                  std::memcpy(&texcoord, geometryBufferData_.get() + allocs.texcoordsAlloc->GetOffset() + i * sizeof(glm::vec2), sizeof(glm::vec2));
+                }
+                ImGui::Text("(%.2f, %.2f)", texcoord.x, texcoord.y);
               }
 
               ImGui::EndTable();
@@ -2054,7 +2107,7 @@ void FrogRenderer2::GuiDrawGeometryInspector(VkCommandBuffer)
             }
             
             if (forceTree) { ImGui::SetNextItemOpen(forceTree == 1); }
-            if (ImGui::TreeNode("Original Indices"))
+            if (allocs.originalIndicesAlloc && ImGui::TreeNode("Original Indices"))
             {
               ImGui::BeginTable("original indices table", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit);
               ImGui::TableSetupColumn("Index");
@@ -2062,8 +2115,8 @@ void FrogRenderer2::GuiDrawGeometryInspector(VkCommandBuffer)
               ImGui::TableSetupColumn("Original vertex index");
               ImGui::TableHeadersRow();
 
-              const size_t start          = allocs.originalIndicesAlloc.GetOffset() / sizeof(Render::index_t);
-              const size_t end            = (allocs.originalIndicesAlloc.GetOffset() + allocs.originalIndicesAlloc.GetDataSize()) / sizeof(Render::index_t);
+              const size_t start          = allocs.originalIndicesAlloc->GetOffset() / sizeof(Render::index_t);
+              const size_t end            = (allocs.originalIndicesAlloc->GetOffset() + allocs.originalIndicesAlloc->GetDataSize()) / sizeof(Render::index_t);
               const auto* originalIndices = reinterpret_cast<const Render::primitive_t*>(geometryBufferData_.get());
               for (size_t i = start; i < end; i++)
               {
@@ -2387,14 +2440,19 @@ void FrogRenderer2::OnGui([[maybe_unused]] double dt, VkCommandBuffer commandBuf
         for (const auto& [meshId, materialId] : node->meshes)
         {
           const auto& meshGeometryAllocs = meshGeometryAllocations.at(meshAllocations.at(meshId.id).geometryId->id);
-
           forwardRenderer_.PushDraw({
-            .vertexBufferAddress = geometryBuffer.GetBuffer().GetDeviceAddress() + meshGeometryAllocs.verticesAlloc.GetOffset(),
-            .indexBuffer         = &geometryBuffer.GetBuffer(),
-            .indexBufferOffset   = meshGeometryAllocs.originalIndicesAlloc.GetOffset(),
-            .indexCount          = uint32_t(meshGeometryAllocs.originalIndicesAlloc.GetDataSize() / sizeof(Render::index_t)),
-            .worldFromObject     = node->globalTransform,
-            .materialId          = GetMaterialGpuIndex(materialId),
+            .positionBufferAddress = geometryBuffer.GetBuffer().GetDeviceAddress() + meshGeometryAllocs.positionsAlloc.GetOffset(),
+            .vertexBufferAddress   = geometryBuffer.GetBuffer().GetDeviceAddress() + meshGeometryAllocs.attributesAlloc.GetOffset(),
+            .texcoordBufferAddress = meshGeometryAllocs.texcoordsAlloc
+                                       ? std::optional(geometryBuffer.GetBuffer().GetDeviceAddress() + meshGeometryAllocs.texcoordsAlloc->GetOffset())
+                                       : std::nullopt,
+            .geometryBuffer        = &geometryBuffer.GetBuffer(),
+            .meshletOffset         = uint32_t(meshGeometryAllocs.meshletsAlloc.GetOffset() / sizeof(Render::Meshlet)),
+            .meshletCount          = meshGeometryAllocs.baseMeshletCount,
+            .worldFromObject       = scene.transforms.globalTransforms[node->transformIndex] * meshGeometryAllocs.dequantization.GetPositionTransform(),
+            .uvOffset              = meshGeometryAllocs.dequantization.texcoordOffset,
+            .uvScale               = meshGeometryAllocs.dequantization.texcoordScale,
+            .materialId            = GetMaterialGpuIndex(materialId),
           });
         }
       }
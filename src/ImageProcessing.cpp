@@ -0,0 +1,591 @@
+#include "ImageProcessing.h"
+
+#include <tracy/Tracy.hpp>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/matrix.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <execution>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace Utility::ImageProcessing
+{
+  namespace
+  {
+    constexpr size_t texelSize = 4;
+
+    const auto srgbToLinear = []
+    {
+      auto table = std::array<float, 256>();
+      for (size_t i = 0; i < table.size(); i++)
+      {
+        const auto c = static_cast<float>(i) / 255.0f;
+        table[i]     = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+      }
+      return table;
+    }();
+
+    // Dense enough that every 8-bit sRGB value is reachable
+    constexpr size_t linearToSrgbSize = 4096;
+    const auto linearToSrgb = []
+    {
+      auto table = std::array<uint8_t, linearToSrgbSize>();
+      for (size_t i = 0; i < table.size(); i++)
+      {
+        const auto c = static_cast<float>(i) / static_cast<float>(linearToSrgbSize - 1);
+        const auto s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+        table[i]     = static_cast<uint8_t>(std::lround(std::clamp(s, 0.0f, 1.0f) * 255.0f));
+      }
+      return table;
+    }();
+
+    uint8_t EncodeUnorm8(float f)
+    {
+      return static_cast<uint8_t>(std::lround(std::clamp(f, 0.0f, 1.0f) * 255.0f));
+    }
+
+    uint8_t EncodeSrgb8(float f)
+    {
+      return linearToSrgb[static_cast<size_t>(std::lround(std::clamp(f, 0.0f, 1.0f) * (linearToSrgbSize - 1)))];
+    }
+
+    // The source texels and weights that contribute to one destination texel along an axis.
+    // For odd source sizes, the three-tap weights make an exact box filter of width srcSize / dstSize.
+    struct Taps
+    {
+      uint32_t first;
+      uint32_t count;
+      std::array<float, 3> weights;
+    };
+
+    std::vector<Taps> MakeTaps(uint32_t srcSize, uint32_t dstSize)
+    {
+      auto taps = std::vector<Taps>(dstSize);
+      for (uint32_t i = 0; i < dstSize; i++)
+      {
+        if (srcSize == 1)
+        {
+          taps[i] = {0, 1, {1, 0, 0}};
+        }
+        else if (srcSize % 2 == 0)
+        {
+          taps[i] = {2 * i, 2, {0.5f, 0.5f, 0}};
+        }
+        else
+        {
+          const auto n = static_cast<float>(srcSize);
+          const auto m = static_cast<float>(dstSize);
+          const auto f = static_cast<float>(i);
+          taps[i]      = {2 * i, 3, {(m - f) / n, m / n, (f + 1) / n}};
+        }
+      }
+      return taps;
+    }
+
+    glm::vec4 DecodeTexel(const uint8_t* texel, Rgba8Encoding encoding)
+    {
+      const auto alpha = static_cast<float>(texel[3]) / 255.0f;
+      switch (encoding)
+      {
+      case Rgba8Encoding::SRGB: return {srgbToLinear[texel[0]], srgbToLinear[texel[1]], srgbToLinear[texel[2]], alpha};
+      case Rgba8Encoding::NORMAL_MAP:
+        return {static_cast<float>(texel[0]) / 127.5f - 1.0f, static_cast<float>(texel[1]) / 127.5f - 1.0f, static_cast<float>(texel[2]) / 127.5f - 1.0f, alpha};
+      case Rgba8Encoding::LINEAR: [[fallthrough]];
+      default: return {static_cast<float>(texel[0]) / 255.0f, static_cast<float>(texel[1]) / 255.0f, static_cast<float>(texel[2]) / 255.0f, alpha};
+      }
+    }
+
+    void EncodeTexel(glm::vec4 color, uint8_t* texel, Rgba8Encoding encoding)
+    {
+      switch (encoding)
+      {
+      case Rgba8Encoding::SRGB:
+        texel[0] = EncodeSrgb8(color.r);
+        texel[1] = EncodeSrgb8(color.g);
+        texel[2] = EncodeSrgb8(color.b);
+        break;
+      case Rgba8Encoding::NORMAL_MAP:
+      {
+        // Filtering shortens normals, so put them back on the unit sphere
+        const auto length = glm::length(glm::vec3(color));
+        const auto normal = length > 1e-6f ? glm::vec3(color) / length : glm::vec3(0, 0, 1);
+        texel[0]          = EncodeUnorm8(normal.x * 0.5f + 0.5f);
+        texel[1]          = EncodeUnorm8(normal.y * 0.5f + 0.5f);
+        texel[2]          = EncodeUnorm8(normal.z * 0.5f + 0.5f);
+        break;
+      }
+      case Rgba8Encoding::LINEAR: [[fallthrough]];
+      default:
+        texel[0] = EncodeUnorm8(color.r);
+        texel[1] = EncodeUnorm8(color.g);
+        texel[2] = EncodeUnorm8(color.b);
+        break;
+      }
+      texel[3] = EncodeUnorm8(color.a);
+    }
+
+    void DownsampleRgba8(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight, Rgba8Encoding encoding)
+    {
+      ZoneScoped;
+      ZoneTextF("(%u, %u) -> (%u, %u)", srcWidth, srcHeight, dstWidth, dstHeight);
+      const auto xTaps = MakeTaps(srcWidth, dstWidth);
+      const auto yTaps = MakeTaps(srcHeight, dstHeight);
+
+      auto rows = std::vector<uint32_t>(dstHeight);
+      std::iota(rows.begin(), rows.end(), 0u);
+
+      // Rows are independent, which lets big levels use every core
+      std::for_each(std::execution::par_unseq,
+        rows.begin(),
+        rows.end(),
+        [&](uint32_t y)
+        {
+          const auto& yTap = yTaps[y];
+          for (uint32_t x = 0; x < dstWidth; x++)
+          {
+            const auto& xTap = xTaps[x];
+            auto sum         = glm::vec4(0);
+            for (uint32_t j = 0; j < yTap.count; j++)
+            {
+              const auto* srcRow = src + size_t(yTap.first + j) * srcWidth * texelSize;
+              for (uint32_t i = 0; i < xTap.count; i++)
+              {
+                sum += DecodeTexel(srcRow + size_t(xTap.first + i) * texelSize, encoding) * (xTap.weights[i] * yTap.weights[j]);
+              }
+            }
+            EncodeTexel(sum, dst + (size_t(y) * dstWidth + x) * texelSize, encoding);
+          }
+        });
+    }
+
+    // Block compression. Every encoder works on 4x4 blocks of texels in [0, 255].
+    using BlockTexels = std::array<glm::vec4, 16>;
+
+    BlockTexels LoadBlock(const uint8_t* src, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY)
+    {
+      auto texels = BlockTexels();
+      for (uint32_t i = 0; i < 16; i++)
+      {
+        const auto x      = std::min(blockX * 4 + i % 4, width - 1);
+        const auto y      = std::min(blockY * 4 + i / 4, height - 1);
+        const auto* texel = src + (size_t(y) * width + x) * texelSize;
+        texels[i]         = glm::vec4(texel[0], texel[1], texel[2], texel[3]);
+      }
+      return texels;
+    }
+
+    float Distance2(glm::vec4 a, glm::vec4 b)
+    {
+      const auto d = a - b;
+      return glm::dot(d, d);
+    }
+
+    // Finds the direction of greatest variance with power iteration
+    glm::vec4 PrincipalAxis(const BlockTexels& texels, glm::vec4 mean)
+    {
+      auto covariance = glm::mat4(0);
+      for (const auto& texel : texels)
+      {
+        covariance += glm::outerProduct(texel - mean, texel - mean);
+      }
+
+      // Start from the column with the most variance so the initial guess is never orthogonal to the answer
+      glm::length_t start = 0;
+      for (glm::length_t i = 1; i < 4; i++)
+      {
+        if (covariance[i][i] > covariance[start][start])
+        {
+          start = i;
+        }
+      }
+
+      auto axis = covariance[start];
+      for (int i = 0; i < 8; i++)
+      {
+        const auto length = glm::length(axis);
+        if (length < 1e-6f)
+        {
+          return glm::vec4(0);
+        }
+        axis = covariance * (axis / length);
+      }
+      return glm::length(axis) < 1e-6f ? glm::vec4(0) : glm::normalize(axis);
+    }
+
+    // Places the endpoints at the extremes of the texels projected onto their principal axis
+    std::pair<glm::vec4, glm::vec4> FitEndpoints(const BlockTexels& texels)
+    {
+      auto mean = glm::vec4(0);
+      for (const auto& texel : texels)
+      {
+        mean += texel;
+      }
+      mean /= 16.0f;
+
+      const auto axis = PrincipalAxis(texels, mean);
+      auto tMin       = 0.0f;
+      auto tMax       = 0.0f;
+      for (const auto& texel : texels)
+      {
+        const auto t = glm::dot(texel - mean, axis);
+        tMin         = std::min(tMin, t);
+        tMax         = std::max(tMax, t);
+      }
+
+      return {glm::clamp(mean + axis * tMin, 0.0f, 255.0f), glm::clamp(mean + axis * tMax, 0.0f, 255.0f)};
+    }
+
+    class BitWriter
+    {
+    public:
+      BitWriter(uint8_t* dst, size_t size) : dst_(dst)
+      {
+        std::fill_n(dst, size, uint8_t(0));
+      }
+
+      void Write(uint32_t value, uint32_t bitCount)
+      {
+        for (uint32_t i = 0; i < bitCount; i++, offset_++)
+        {
+          if ((value >> i) & 1u)
+          {
+            dst_[offset_ / 8] = static_cast<uint8_t>(dst_[offset_ / 8] | (1u << (offset_ % 8)));
+          }
+        }
+      }
+
+    private:
+      uint8_t* dst_;
+      uint32_t offset_ = 0;
+    };
+
+    // BC1: two RGB565 endpoints and 2-bit indices
+    uint16_t PackRgb565(glm::vec4 color)
+    {
+      const auto r = static_cast<uint32_t>(std::lround(color.r * 31.0f / 255.0f));
+      const auto g = static_cast<uint32_t>(std::lround(color.g * 63.0f / 255.0f));
+      const auto b = static_cast<uint32_t>(std::lround(color.b * 31.0f / 255.0f));
+      return static_cast<uint16_t>(r << 11 | g << 5 | b);
+    }
+
+    glm::vec4 UnpackRgb565(uint16_t color)
+    {
+      const auto r = (uint32_t(color) >> 11) & 31u;
+      const auto g = (uint32_t(color) >> 5) & 63u;
+      const auto b = uint32_t(color) & 31u;
+      return glm::vec4((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 0);
+    }
+
+    struct Bc1Block
+    {
+      uint16_t color0;
+      uint16_t color1;
+      uint32_t indices;
+      float error;
+    };
+
+    Bc1Block MakeBc1Block(const BlockTexels& texels, glm::vec4 endpoint0, glm::vec4 endpoint1)
+    {
+      auto block = Bc1Block{.color0 = PackRgb565(endpoint0), .color1 = PackRgb565(endpoint1), .indices = 0, .error = 0};
+
+      // color0 > color1 selects the four-color mode
+      if (block.color0 < block.color1)
+      {
+        std::swap(block.color0, block.color1);
+      }
+
+      const auto c0            = UnpackRgb565(block.color0);
+      const auto c1            = UnpackRgb565(block.color1);
+      const glm::vec4 palette[] = {c0, c1, (2.0f * c0 + c1) / 3.0f, (c0 + 2.0f * c1) / 3.0f};
+
+      for (uint32_t i = 0; i < 16; i++)
+      {
+        // Equal endpoints select the three-color mode, whose fourth entry is black, so only the first entry is safe
+        uint32_t best   = 0;
+        float bestError = Distance2(texels[i], palette[0]);
+        for (uint32_t j = 1; j < 4 && block.color0 != block.color1; j++)
+        {
+          if (const auto error = Distance2(texels[i], palette[j]); error < bestError)
+          {
+            best      = j;
+            bestError = error;
+          }
+        }
+        block.indices |= best << (2 * i);
+        block.error += bestError;
+      }
+
+      return block;
+    }
+
+    // Least-squares fit of the endpoints to the indices that were chosen for them
+    std::optional<std::pair<glm::vec4, glm::vec4>> RefitBc1Endpoints(const BlockTexels& texels, uint32_t indices)
+    {
+      constexpr float weights[] = {1, 0, 2.0f / 3.0f, 1.0f / 3.0f};
+      float aa = 0, ab = 0, bb = 0;
+      auto ax = glm::vec4(0), bx = glm::vec4(0);
+      for (uint32_t i = 0; i < 16; i++)
+      {
+        const auto a = weights[(indices >> (2 * i)) & 3u];
+        const auto b = 1 - a;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        ax += a * texels[i];
+        bx += b * texels[i];
+      }
+
+      const auto determinant = aa * bb - ab * ab;
+      if (std::abs(determinant) < 1e-6f)
+      {
+        return std::nullopt;
+      }
+
+      return std::pair{glm::clamp((ax * bb - bx * ab) / determinant, 0.0f, 255.0f), glm::clamp((bx * aa - ax * ab) / determinant, 0.0f, 255.0f)};
+    }
+
+    void EncodeBc1Block(BlockTexels texels, uint8_t* dst)
+    {
+      for (auto& texel : texels)
+      {
+        texel.a = 0;
+      }
+
+      const auto [endpoint0, endpoint1] = FitEndpoints(texels);
+      auto block                        = MakeBc1Block(texels, endpoint0, endpoint1);
+      if (const auto refit = RefitBc1Endpoints(texels, block.indices))
+      {
+        if (const auto refined = MakeBc1Block(texels, refit->first, refit->second); refined.error < block.error)
+        {
+          block = refined;
+        }
+      }
+
+      auto writer = BitWriter(dst, 8);
+      writer.Write(block.color0, 16);
+      writer.Write(block.color1, 16);
+      writer.Write(block.indices, 32);
+    }
+
+    // BC4: two 8-bit endpoints and 3-bit indices. Only the eight-value mode is used.
+    void EncodeBc4Block(const BlockTexels& texels, glm::length_t channel, uint8_t* dst)
+    {
+      auto lo = 255.0f;
+      auto hi = 0.0f;
+      for (const auto& texel : texels)
+      {
+        lo = std::min(lo, texel[channel]);
+        hi = std::max(hi, texel[channel]);
+      }
+
+      const auto alpha0 = static_cast<uint32_t>(std::lround(hi));
+      const auto alpha1 = static_cast<uint32_t>(std::lround(lo));
+
+      float palette[8] = {static_cast<float>(alpha0), static_cast<float>(alpha1)};
+      for (uint32_t i = 2; i < 8; i++)
+      {
+        palette[i] = static_cast<float>((8 - i) * alpha0 + (i - 1) * alpha1) / 7.0f;
+      }
+
+      auto writer = BitWriter(dst, 8);
+      writer.Write(alpha0, 8);
+      writer.Write(alpha1, 8);
+      for (const auto& texel : texels)
+      {
+        uint32_t best   = 0;
+        float bestError = std::abs(texel[channel] - palette[0]);
+        for (uint32_t j = 1; j < 8 && alpha0 != alpha1; j++)
+        {
+          if (const auto error = std::abs(texel[channel] - palette[j]); error < bestError)
+          {
+            best      = j;
+            bestError = error;
+          }
+        }
+        writer.Write(best, 3);
+      }
+    }
+
+    // BC7 mode 6: one subset with RGBA 7.7.7.7 endpoints, a p-bit per endpoint, and 4-bit indices.
+    // Picks the p-bit (the shared LSB of every channel) that best reproduces the endpoint.
+    glm::vec4 QuantizeBc7Mode6Endpoint(glm::vec4 endpoint, glm::uvec4& quantized, uint32_t& pBit)
+    {
+      auto bestError = std::numeric_limits<float>::max();
+      auto best      = glm::vec4();
+      for (uint32_t p = 0; p < 2; p++)
+      {
+        auto q     = glm::uvec4();
+        auto value = glm::vec4();
+        for (glm::length_t c = 0; c < 4; c++)
+        {
+          q[c]     = static_cast<uint32_t>(std::clamp(std::lround((endpoint[c] - static_cast<float>(p)) / 2.0f), 0l, 127l));
+          value[c] = static_cast<float>(q[c] << 1 | p);
+        }
+
+        if (const auto error = Distance2(value, endpoint); error < bestError)
+        {
+          bestError = error;
+          best      = value;
+          quantized = q;
+          pBit      = p;
+        }
+      }
+      return best;
+    }
+
+    void EncodeBc7Block(const BlockTexels& texels, uint8_t* dst)
+    {
+      const auto [lo, hi] = FitEndpoints(texels);
+      glm::uvec4 quantized[2];
+      uint32_t pBits[2];
+      const auto endpoint0 = QuantizeBc7Mode6Endpoint(lo, quantized[0], pBits[0]);
+      const auto endpoint1 = QuantizeBc7Mode6Endpoint(hi, quantized[1], pBits[1]);
+
+      constexpr uint32_t weights[] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+      glm::vec4 palette[16];
+      for (uint32_t i = 0; i < 16; i++)
+      {
+        palette[i] = glm::floor((endpoint0 * static_cast<float>(64 - weights[i]) + endpoint1 * static_cast<float>(weights[i]) + 32.0f) / 64.0f);
+      }
+
+      uint32_t indices[16];
+      for (uint32_t i = 0; i < 16; i++)
+      {
+        indices[i]      = 0;
+        float bestError = Distance2(texels[i], palette[0]);
+        for (uint32_t j = 1; j < 16; j++)
+        {
+          if (const auto error = Distance2(texels[i], palette[j]); error < bestError)
+          {
+            indices[i] = j;
+            bestError  = error;
+          }
+        }
+      }
+
+      // The MSB of the first index is implied to be zero, so flip the endpoints if it isn't
+      if (indices[0] >= 8)
+      {
+        std::swap(quantized[0], quantized[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (auto& index : indices)
+        {
+          index = 15 - index;
+        }
+      }
+
+      auto writer = BitWriter(dst, 16);
+      writer.Write(1u << 6, 7);
+      for (glm::length_t c = 0; c < 4; c++)
+      {
+        writer.Write(quantized[0][c], 7);
+        writer.Write(quantized[1][c], 7);
+      }
+      writer.Write(pBits[0], 1);
+      writer.Write(pBits[1], 1);
+      writer.Write(indices[0], 3);
+      for (uint32_t i = 1; i < 16; i++)
+      {
+        writer.Write(indices[i], 4);
+      }
+    }
+  } // namespace
+
+  uint32_t GetMipLevelCount(uint32_t width, uint32_t height)
+  {
+    return static_cast<uint32_t>(std::bit_width(std::max(width, height)));
+  }
+
+  size_t GetRgba8MipChainSize(uint32_t width, uint32_t height)
+  {
+    size_t size = 0;
+    for (uint32_t level = 0; level < GetMipLevelCount(width, height); level++)
+    {
+      size += size_t(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * texelSize;
+    }
+    return size;
+  }
+
+  void GenerateRgba8Mips(std::span<std::byte> chain, uint32_t width, uint32_t height, Rgba8Encoding encoding)
+  {
+    ZoneScoped;
+    assert(chain.size() >= GetRgba8MipChainSize(width, height));
+
+    auto* src = reinterpret_cast<uint8_t*>(chain.data());
+    for (uint32_t level = 1; level < GetMipLevelCount(width, height); level++)
+    {
+      const auto srcWidth  = std::max(width >> (level - 1), 1u);
+      const auto srcHeight = std::max(height >> (level - 1), 1u);
+      auto* dst            = src + size_t(srcWidth) * srcHeight * texelSize;
+      DownsampleRgba8(src, srcWidth, srcHeight, dst, std::max(width >> level, 1u), std::max(height >> level, 1u), encoding);
+      src = dst;
+    }
+  }
+
+  void MoveGbToRg(std::span<std::byte> rgba8)
+  {
+    ZoneScoped;
+    assert(rgba8.size() % texelSize == 0);
+    for (size_t i = 0; i < rgba8.size(); i += texelSize)
+    {
+      rgba8[i + 0] = rgba8[i + 1];
+      rgba8[i + 1] = rgba8[i + 2];
+    }
+  }
+
+  size_t GetBlockCompressedSize(BlockFormat format, uint32_t width, uint32_t height)
+  {
+    const size_t blockSize = format == BlockFormat::BC1_RGB || format == BlockFormat::BC4_R ? 8 : 16;
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+  }
+
+  void EncodeBlockCompressed(BlockFormat format, std::span<const std::byte> rgba8, uint32_t width, uint32_t height, std::span<std::byte> dst)
+  {
+    ZoneScoped;
+    ZoneTextF("(%u, %u)", width, height);
+    assert(rgba8.size() >= size_t(width) * height * texelSize);
+    assert(dst.size() == GetBlockCompressedSize(format, width, height));
+
+    const auto* src      = reinterpret_cast<const uint8_t*>(rgba8.data());
+    const auto blocksX   = (width + 3) / 4;
+    const auto blockSize = GetBlockCompressedSize(format, 1, 1);
+
+    auto blockRows = std::vector<uint32_t>((height + 3) / 4);
+    std::iota(blockRows.begin(), blockRows.end(), 0u);
+
+    std::for_each(std::execution::par,
+      blockRows.begin(),
+      blockRows.end(),
+      [&](uint32_t blockY)
+      {
+        for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+        {
+          const auto texels = LoadBlock(src, width, height, blockX, blockY);
+          auto* block       = reinterpret_cast<uint8_t*>(dst.data()) + (size_t(blockY) * blocksX + blockX) * blockSize;
+          switch (format)
+          {
+          case BlockFormat::BC1_RGB: EncodeBc1Block(texels, block); break;
+          case BlockFormat::BC4_R: EncodeBc4Block(texels, 0, block); break;
+          case BlockFormat::BC5_RG:
+            EncodeBc4Block(texels, 0, block);
+            EncodeBc4Block(texels, 1, block + 8);
+            break;
+          case BlockFormat::BC7_RGBA: EncodeBc7Block(texels, block); break;
+          }
+        }
+      });
+  }
+} // namespace Utility::ImageProcessing
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// CPU-side processing of decoded images before they are uploaded
+namespace Utility::ImageProcessing
+{
+  // Determines how the texels of an RGBA8 image are filtered
+  enum class Rgba8Encoding
+  {
+    LINEAR,     // All channels are linear
+    SRGB,       // RGB is sRGB-encoded, alpha is linear
+    NORMAL_MAP, // RGB is a unit vector remapped to [0, 1], alpha is linear
+  };
+
+  [[nodiscard]] uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+  [[nodiscard]] size_t GetRgba8MipChainSize(uint32_t width, uint32_t height);
+
+  // Generates every mip level of an RGBA8 image whose levels are stored contiguously in chain, largest first.
+  // The first level must already be filled in. Each level is box-filtered from the previous one, including odd sizes.
+  void GenerateRgba8Mips(std::span<std::byte> chain, uint32_t width, uint32_t height, Rgba8Encoding encoding);
+
+  // Moves the G and B channels of every texel into R and G, so that images which only use G and B fit in a two-channel format
+  void MoveGbToRg(std::span<std::byte> rgba8);
+
+  // Block-compressed formats that RGBA8 images can be encoded to. Channels not listed in the name are discarded.
+  enum class BlockFormat
+  {
+    BC1_RGB,
+    BC4_R,
+    BC5_RG,
+    BC7_RGBA,
+  };
+
+  [[nodiscard]] size_t GetBlockCompressedSize(BlockFormat format, uint32_t width, uint32_t height);
+
+  // Encodes one level of an RGBA8 image. dst must be exactly GetBlockCompressedSize() bytes.
+  // Blocks that hang off the right or bottom edge are padded by repeating the last column and row.
+  void EncodeBlockCompressed(BlockFormat format, std::span<const std::byte> rgba8, uint32_t width, uint32_t height, std::span<std::byte> dst);
+} // namespace Utility::ImageProcessing
@@ -0,0 +1,14 @@
+#pragma once
+#include <filesystem>
+
+// Kept apart from Application.h so that code which only needs to find files on disk does not depend on the device or windowing code.
+
+// The nearest "data" directory in the working directory or one of its parents. Throws if there is none.
+std::filesystem::path GetAssetDirectory();
+std::filesystem::path GetShaderDirectory();
+std::filesystem::path GetTextureDirectory();
+std::filesystem::path GetConfigDirectory();
+std::filesystem::path GetCacheDirectory();
+
+// Makes GetCacheDirectory() return path instead of the one in the asset directory
+void SetCacheDirectory(std::filesystem::path path);
@@ -1,19 +1,20 @@
 #pragma once
 
 #include "Fvog/detail/Flags.h"
-#include "Fvog/Texture2.h"
 
 #include "shaders/Resources.h.glsl"
 
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
 #include <glm/vec3.hpp>
+#include <glm/vec2.hpp>
 
+#include <limits>
 #include <optional>
 
 namespace Render
 {
-  // TODO: split this into separate streams
+  // Full-precision vertex used while building meshes on the CPU
   struct Vertex
   {
     glm::vec3 position;
@@ -21,6 +22,39 @@ namespace Render
     glm::vec2 texcoord;
   };
 
+  // On the GPU, vertices are split into two streams so that passes which only need positions (culling, shadows) don't fetch anything else.
+  // Position components are snorm16 relative to the bounds of the mesh. Each mesh is quantized on its own grid, so the same point on
+  // the seam between two meshes may land up to half a step (the mesh's largest half-extent / 32767) apart, which can open hairline cracks.
+  struct QuantizedPosition
+  {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+    int16_t _padding;
+  };
+
+  struct VertexAttributes
+  {
+    uint32_t normal;   // Octahedral, snorm16x2
+    uint32_t texcoord; // unorm16x2 relative to the texcoord range of the mesh. Unused if the mesh has full-precision texcoords.
+  };
+
+  // Maps quantized vertex data back to its original range
+  struct VertexDequantization
+  {
+    glm::vec3 positionOffset{};
+    float positionScale = 1; // Uniform so that normals are unaffected
+    glm::vec2 texcoordOffset{};
+    glm::vec2 texcoordScale{1};
+
+    [[nodiscard]] glm::mat4 GetPositionTransform() const noexcept
+    {
+      auto transform = glm::mat4(positionScale);
+      transform[3]   = glm::vec4(positionOffset, 1);
+      return transform;
+    }
+  };
+
   using index_t = uint32_t;
   using primitive_t = uint8_t;
 
@@ -30,14 +64,6 @@ namespace Render
     glm::vec3 max;
   };
 
-  struct CombinedTextureSampler
-  {
-    // Fwog::TextureView texture;
-    // Fwog::SamplerState sampler;
-
-    Fvog::TextureView texture;
-  };
-
   enum class MaterialFlagBit
   {
     HAS_BASE_COLOR_TEXTURE         = 1 << 0,
@@ -45,6 +71,8 @@ namespace Render
     HAS_NORMAL_TEXTURE             = 1 << 2,
     HAS_OCCLUSION_TEXTURE          = 1 << 3,
     HAS_EMISSION_TEXTURE           = 1 << 4,
+    IS_DOUBLE_SIDED                = 1 << 5,
+    METALLIC_ROUGHNESS_IN_RG       = 1 << 6, // See Utility::ImageData::metallicRoughnessInRg
   };
   FVOG_DECLARE_FLAG_TYPE(MaterialFlags, MaterialFlagBit, uint32_t)
 
@@ -68,30 +96,27 @@ namespace Render
     FVOG_UINT32 _padding[2];
   };
 
-  struct Material
-  {
-    bool operator==(const Material& other) const noexcept
-    {
-      return gpuMaterial == other.gpuMaterial;
-    }
-
-    GpuMaterial gpuMaterial{};
-    std::optional<CombinedTextureSampler> albedoTextureSampler;
-    std::optional<CombinedTextureSampler> metallicRoughnessTextureSampler;
-    std::optional<CombinedTextureSampler> normalTextureSampler;
-    std::optional<CombinedTextureSampler> occlusionTextureSampler;
-    std::optional<CombinedTextureSampler> emissiveTextureSampler;
-  };
-
   struct Meshlet
   {
     uint32_t vertexOffset    = 0;
+    uint32_t attributeOffset = 0;
     uint32_t indexOffset     = 0;
     uint32_t primitiveOffset = 0;
     uint32_t indexCount      = 0;
     uint32_t primitiveCount  = 0;
     float aabbMin[3]         = {};
     float aabbMax[3]         = {};
+
+    // Meshlets form a hierarchy of simplified levels of detail. A meshlet is drawn when its own error is imperceptible, but its parent's is not.
+    // Bounds (xyz: center, w: radius) and errors are in the same space as the vertices.
+    float lodBounds[4]       = {};
+    float lodError           = 0;
+    float parentLodBounds[4] = {};
+    float parentLodError     = std::numeric_limits<float>::max();
+
+    // Normal cone (axis xyz, cutoff w) encoded as snorm8x4. Every triangle faces away from viewers inside the cone.
+    // The default is a cone that never culls anything.
+    uint32_t coneAxisCutoff = 0;
   };
 
   struct MeshletInstance
@@ -105,11 +130,20 @@ namespace Render
     bool operator==(const ObjectUniforms&) const noexcept = default;
     glm::mat4 modelPrevious;
     glm::mat4 modelCurrent;
+    glm::mat4 objectFromWorld; // Inverse of modelCurrent. Filled in by the renderer.
     // TODO: Mesh geometry info should go in its own array
-    VkDeviceAddress vertexBuffer{};
-    VkDeviceAddress indexBuffer{};
+    // Buffer device addresses. Plain integers so that the CPU stage of the loader can use this header without Vulkan.
+    uint64_t positionBuffer{};
+    uint64_t vertexBuffer{};
+    uint64_t texcoordBuffer{}; // Only valid if fullPrecisionTexcoords is set. Filled in by the renderer.
+    uint32_t meshletOffset   = 0; // Of the geometry's first meshlet in the geometry buffer. Ray tracing finds hit triangles through meshlets.
+    uint32_t attributeOffset = 0; // Of the geometry's first vertex attributes in the geometry buffer. Filled in by the renderer.
     uint32_t materialId = 0;
-    uint32_t _padding[3];
+    uint32_t fullPrecisionTexcoords = 0; // If set, texcoords are read from texcoordBuffer instead of being dequantized. Filled in by the renderer.
+    glm::vec2 uvOffset{};
+    glm::vec2 uvScale{1};
+    uint32_t baseMeshletCount        = 0; // Full-detail meshlets, which the BLAS is built from. Filled in by the renderer.
+    uint32_t blasMeshletStartsOffset = 0; // In uints. See FrogRenderer2::MeshGeometryAllocs::blasMeshletStartsAlloc. Filled in by the renderer.
   };
 
   // The ID structs below this line mainly exist in this file as a hack to prevent
@@ -141,6 +175,16 @@ namespace Render
     uint64_t id{};
   };
 
+  // A group of instances of one mesh that were spawned together
+  struct MeshInstancesID
+  {
+    explicit operator bool() const noexcept
+    {
+      return id != 0;
+    }
+    uint64_t id{};
+  };
+
   struct LightID
   {
     explicit operator bool() const noexcept
@@ -1,7 +1,8 @@
 #include "Scene.h"
 
 #include "FrogRenderer2.h"
-#include "SceneLoader.h"
+#include "SceneLoaderGpu.h"
+#include "AssetCache.h"
 
 #include <tracy/Tracy.hpp>
 
@@ -9,21 +10,268 @@
 #include <fastgltf/types.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <execution>
+#include <iterator>
+#include <numeric>
+#include <span>
+#include <stack>
+#include <unordered_set>
+
 namespace Scene
 {
-  void SceneMeshlet::Import(FrogRenderer2& renderer, Utility::LoadModelResultA loadModelResult)
+  namespace
+  {
+    // Identifies a material by its values and the contents of its images, rather than by which file they came from
+    uint64_t HashMaterial(const Utility::MaterialData& material, std::span<const Utility::ImageData> images)
+    {
+      // Texture indices are only assigned once the material is created
+      auto gpuMaterial                          = material.gpuMaterial;
+      gpuMaterial.baseColorTextureIndex         = 0;
+      gpuMaterial.metallicRoughnessTextureIndex = 0;
+      gpuMaterial.normalTextureIndex            = 0;
+      gpuMaterial.occlusionTextureIndex         = 0;
+      gpuMaterial.emissionTextureIndex          = 0;
+
+      auto hash = Utility::AssetCache::HashValue(gpuMaterial);
+      for (const auto* imageRef : {&material.albedoTexture,
+             &material.metallicRoughnessTexture,
+             &material.normalTexture,
+             &material.occlusionTexture,
+             &material.emissiveTexture})
+      {
+        hash = Utility::AssetCache::HashValue(*imageRef ? images[(*imageRef)->imageIndex].contentHash : uint64_t(0), hash);
+      }
+      return hash;
+    }
+  } // namespace
+
+  ImportJob::ImportJob(std::filesystem::path path, glm::mat4 rootTransform)
+    : name_(path.filename().string()),
+      decodedImages_(std::make_shared<Utility::DecodedImageQueue>()),
+      loading_(std::async(std::launch::async,
+        [path = std::move(path), rootTransform, decodedImages = decodedImages_]
+        { return Utility::LoadModelFromFile(path, rootTransform, false, decodedImages.get()); }))
+  {
+  }
+
+  ImportJob::ImportJob(Utility::LoadModelResultA loadModelResult)
+    : name_(loadModelResult.rootNodes.empty() ? "Model" : loadModelResult.rootNodes.front()->name),
+      stage_(Stage::UPLOADING_IMAGES),
+      result_(std::move(loadModelResult))
+  {
+    // Every image is already decoded. Like the loader does when it publishes an image, only the pixels are moved out.
+    for (size_t i = 0; i < result_->images.size(); i++)
+    {
+      auto& image = result_->images[i];
+      pendingImages_.emplace_back(i, image);
+      image.levels.clear();
+      image.storage.reset();
+    }
+  }
+
+  float ImportJob::GetProgress() const noexcept
+  {
+    if (stage_ == Stage::DONE)
+    {
+      return 1;
+    }
+
+    if (!result_)
+    {
+      return 0;
+    }
+
+    const auto total = result_->images.size() + result_->meshGeometries.size();
+    return total == 0 ? 1 : float(importedImages_ + nextGeometry_) / float(total);
+  }
+
+  bool ImportJob::Advance(SceneMeshlet& scene, FrogRenderer2& renderer, const Budget& budget)
   {
     ZoneScoped;
-    meshGeometryIds.reserve(meshGeometryIds.size() + loadModelResult.meshGeometries.size());
+    ZoneText(name_.c_str(), name_.size());
+
+    const auto startTime = std::chrono::steady_clock::now();
+    size_t bytesUploaded = 0;
+    auto IsWithinBudget  = [&] { return bytesUploaded < budget.bytes && std::chrono::steady_clock::now() - startTime < budget.time; };
+    isWaiting_           = false;
+
+    auto SetImageIndex = [&](size_t imageIndex, size_t sceneImageIndex)
+    {
+      if (imageIndex >= imageIndices_.size())
+      {
+        imageIndices_.resize(imageIndex + 1);
+      }
+      imageIndices_[imageIndex] = sceneImageIndex;
+      importedImages_++;
+    };
+
+    // CPU pixel data is freed as soon as it has been uploaded
+    auto ImportPendingImages = [&]
+    {
+      while (!pendingImages_.empty() && IsWithinBudget())
+      {
+        // Images that are already in the scene are shared instead of uploaded again
+        if (auto it = scene.imageIndicesByHash.find(pendingImages_.front().image.contentHash); it != scene.imageIndicesByHash.end())
+        {
+          SetImageIndex(pendingImages_.front().imageIndex, it->second);
+          pendingImages_.pop_front();
+          continue;
+        }
+
+        // Upload as many new images as will fit in the remaining budget in one batch
+        auto batchHashes  = std::unordered_set<uint64_t>();
+        auto batch        = std::vector<Utility::ImageData>();
+        auto batchIndices = std::vector<size_t>();
+        do
+        {
+          auto& [imageIndex, image] = pendingImages_.front();
+          batchHashes.insert(image.contentHash);
+          bytesUploaded += image.SizeBytes();
+          batchIndices.push_back(imageIndex);
+          batch.emplace_back(std::move(image));
+          pendingImages_.pop_front();
+        } while (!pendingImages_.empty() && bytesUploaded + pendingImages_.front().image.SizeBytes() <= budget.bytes &&
+                 !batchHashes.contains(pendingImages_.front().image.contentHash) &&
+                 !scene.imageIndicesByHash.contains(pendingImages_.front().image.contentHash));
+
+        auto textures = Utility::UploadImages(scene.imageStagingRing, batch);
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+          const auto sceneImageIndex = scene.images.size();
+          scene.images.emplace_back(std::move(textures[i]));
+          scene.imageIndicesByHash.emplace(batch[i].contentHash, sceneImageIndex);
+          SetImageIndex(batchIndices[i], sceneImageIndex);
+        }
+      }
+    };
+
+    if (stage_ == Stage::LOADING)
+    {
+      std::ranges::move(decodedImages_->TakeAll(), std::back_inserter(pendingImages_));
+      ImportPendingImages();
+
+      if (loading_.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+      {
+        isWaiting_ = IsWithinBudget();
+        return false;
+      }
+
+      result_ = loading_.get();
+      if (!result_)
+      {
+        stage_ = Stage::DONE;
+        return true;
+      }
+
+      // Images that were published after the last check
+      std::ranges::move(decodedImages_->TakeAll(), std::back_inserter(pendingImages_));
+      stage_ = Stage::UPLOADING_IMAGES;
+    }
+
+    if (stage_ == Stage::UPLOADING_IMAGES)
+    {
+      ImportPendingImages();
+      if (!pendingImages_.empty())
+      {
+        return false;
+      }
+
+      assert(importedImages_ == result_->images.size());
+      imageUploadValue_ = scene.imageStagingRing.GetLastSubmitValue();
+      stage_            = Stage::WAITING_FOR_IMAGES;
+    }
+
+    if (stage_ == Stage::WAITING_FOR_IMAGES)
+    {
+      // Polled rather than waited on, so other imports can make progress in the meantime
+      if (!scene.imageStagingRing.IsComplete(imageUploadValue_))
+      {
+        isWaiting_ = true;
+        return false;
+      }
+
+      CreateMaterialsAndNodes(scene, renderer);
+      stage_ = Stage::REGISTERING_GEOMETRY;
+    }
+
+    if (stage_ == Stage::REGISTERING_GEOMETRY)
+    {
+      auto& meshGeometries = result_->meshGeometries;
+      while (nextGeometry_ < meshGeometries.size() && IsWithinBudget())
+      {
+        auto& meshGeometry  = meshGeometries[nextGeometry_];
+        auto meshGeometryId = Render::MeshGeometryID{};
+
+        // Geometry that is already in the scene only needs new instances
+        if (auto it = scene.meshGeometryIdsByHash.find(meshGeometry.contentHash); it != scene.meshGeometryIdsByHash.end())
+        {
+          meshGeometryId = it->second;
+        }
+        else
+        {
+          bytesUploaded += std::span(meshGeometry.meshlets).size_bytes() + std::span(meshGeometry.positions).size_bytes() +
+                           std::span(meshGeometry.attributes).size_bytes() + std::span(meshGeometry.texcoords).size_bytes() +
+                           std::span(meshGeometry.remappedIndices).size_bytes() + std::span(meshGeometry.primitives).size_bytes() +
+                           std::span(meshGeometry.originalIndices).size_bytes();
+
+          // TODO: move arrays in
+          auto info = FrogRenderer2::MeshGeometryInfo{
+            .meshlets        = std::move(meshGeometry.meshlets),
+            .positions       = std::move(meshGeometry.positions),
+            .attributes      = std::move(meshGeometry.attributes),
+            .texcoords       = std::move(meshGeometry.texcoords),
+            .remappedIndices = std::move(meshGeometry.remappedIndices),
+            .primitives      = std::move(meshGeometry.primitives),
+            .originalIndices = std::move(meshGeometry.originalIndices),
+            .dequantization  = meshGeometry.dequantization,
+          };
+          meshGeometryId = scene.meshGeometryIds.emplace_back(renderer.RegisterMeshGeometry(std::move(info)));
+          scene.meshGeometryIdsByHash.emplace(meshGeometry.contentHash, meshGeometryId);
+        }
+
+        // Now that its geometry exists, every instance of this mesh can be spawned
+        for (auto [node, materialId] : meshesByGeometry_[nextGeometry_])
+        {
+          if (node->instanceTransforms.empty())
+          {
+            auto meshId = scene.meshIds.emplace_back(renderer.SpawnMesh(meshGeometryId));
+            node->meshes.emplace_back(meshId, materialId);
+          }
+          else
+          {
+            auto meshInstancesId = scene.meshInstancesIds.emplace_back(renderer.SpawnMeshInstances(meshGeometryId, (uint32_t)node->instanceTransforms.size()));
+            node->instancedMeshes.emplace_back(meshInstancesId, materialId);
+          }
+          scene.MarkDirty(*node);
+        }
+        meshesByGeometry_[nextGeometry_].clear();
 
-    // Every mesh node creates a new mesh instance for now.
-    // Also, not every node necessarily holds a mesh, so this may over-reserve.
-    meshIds.reserve(meshIds.size() + loadModelResult.nodes.size());
+        nextGeometry_++;
+      }
+
+      if (nextGeometry_ < meshGeometries.size())
+      {
+        return false;
+      }
 
+      Finish();
+      stage_ = Stage::DONE;
+    }
+
+    return true;
+  }
+
+  void ImportJob::CreateMaterialsAndNodes(SceneMeshlet& scene, FrogRenderer2& renderer)
+  {
+    ZoneScoped;
     // Also assume that every node holds a light. These IDs are tiny.
-    lightIds.reserve(lightIds.size() + loadModelResult.nodes.size());
+    scene.lightIds.reserve(scene.lightIds.size() + result_->nodes.size());
 
-    if (materialIds.empty())
+    if (scene.materialIds.empty())
     {
       // First material is always default.
       constexpr auto defaultGpu = Render::GpuMaterial{
@@ -31,42 +279,51 @@ namespace Scene
         .roughnessFactor = 1,
         .baseColorFactor = {0.5f, 0.5f, 0.5f, 0.5f},
       };
-      materialIds.emplace_back(renderer.RegisterMaterial({.gpuMaterial = defaultGpu}));
+      scene.materialIds.emplace_back(renderer.RegisterMaterial({.gpuMaterial = defaultGpu}));
     }
 
-    materialIds.reserve(materialIds.size() + loadModelResult.materials.size());
+    materialIds_.reserve(result_->materials.size());
+    for (const auto& material : result_->materials)
+    {
+      const auto hash = HashMaterial(material, result_->images);
+      if (auto it = scene.materialIdsByHash.find(hash); it != scene.materialIdsByHash.end())
+      {
+        materialIds_.push_back(it->second);
+        continue;
+      }
 
-    const auto baseMeshGeometryIndex = meshGeometryIds.size();
-    const auto baseMaterialIndex = materialIds.size();
+      // Refer to images by where they ended up in the scene, since some of them may have come from an earlier import
+      auto sceneMaterial = material;
+      for (auto* imageRef : {&sceneMaterial.albedoTexture,
+             &sceneMaterial.metallicRoughnessTexture,
+             &sceneMaterial.normalTexture,
+             &sceneMaterial.occlusionTexture,
+             &sceneMaterial.emissiveTexture})
+      {
+        if (*imageRef)
+        {
+          (*imageRef)->imageIndex = imageIndices_[(*imageRef)->imageIndex];
+        }
+      }
 
-    for (const auto& meshGeometry : loadModelResult.meshGeometries)
-    {
-      // TODO: move arrays in
-      auto info = FrogRenderer2::MeshGeometryInfo{
-        .meshlets        = std::move(meshGeometry.meshlets),
-        .vertices        = std::move(meshGeometry.vertices),
-        .remappedIndices = std::move(meshGeometry.remappedIndices),
-        .primitives      = std::move(meshGeometry.primitives),
-        .originalIndices = std::move(meshGeometry.originalIndices),
-      };
-      meshGeometryIds.push_back(renderer.RegisterMeshGeometry(info));
-    }
-    
-    for (auto& material : loadModelResult.materials)
-    {
-      materialIds.push_back(renderer.RegisterMaterial(std::move(material)));
+      const auto materialId = scene.materialIds.emplace_back(renderer.RegisterMaterial(Utility::CreateMaterial(sceneMaterial, scene.images)));
+      scene.materialIdsByHash.emplace(hash, materialId);
+      materialIds_.push_back(materialId);
     }
 
+    meshesByGeometry_.resize(result_->meshGeometries.size());
+
     // Convert the Utility::LoadModelNode tree into a Scene::Node tree.
+    // Meshes are spawned later, once their geometry has been registered.
     struct StackElement
     {
-      const Utility::LoadModelNode* node;
+      Utility::LoadModelNode* node;
       bool isRootNode = false;
       Node* parent    = nullptr;
     };
     std::stack<StackElement> nodeStack;
 
-    for (auto* rootNode : loadModelResult.rootNodes)
+    for (auto* rootNode : result_->rootNodes)
     {
       nodeStack.emplace(rootNode, true, nullptr);
     }
@@ -77,16 +334,11 @@ namespace Scene
       nodeStack.pop();
 
       auto newNode = std::make_unique<Node>(Node{
-        .name              = node->name,
-        .translation       = node->translation,
-        .rotation          = node->rotation,
-        .scale             = node->scale,
-        .globalTransform   = {},
-        .parent            = parent,
-        .children          = {},
-        .isDirty           = true,
-        .isDescendantDirty = true,
+        .name               = node->name,
+        .parent             = parent,
+        .instanceTransforms = std::move(node->instanceTransforms),
       });
+      scene.transforms.Add(*newNode, parent, node->translation, node->rotation, node->scale);
 
       if (parent)
       {
@@ -95,102 +347,127 @@ namespace Scene
 
       for (auto& [meshIndex, materialIndex] : node->meshes)
       {
-        auto meshId     = meshIds.emplace_back(renderer.SpawnMesh(meshGeometryIds[baseMeshGeometryIndex + meshIndex]));
-        auto materialId = materialIds[materialIndex.has_value() ? baseMaterialIndex + *materialIndex : 0];
-        newNode->meshes.emplace_back(meshId, materialId);
+        auto materialId = materialIndex.has_value() ? materialIds_[*materialIndex] : scene.materialIds[0];
+        meshesByGeometry_[meshIndex].emplace_back(newNode.get(), materialId);
       }
 
       if (node->light)
       {
         newNode->light = node->light.value();
-        newNode->lightId = renderer.SpawnLight(newNode->light);
+        newNode->lightId = scene.lightIds.emplace_back(renderer.SpawnLight(newNode->light));
       }
 
-      for (const auto* childNode : node->children)
+      for (auto* childNode : node->children)
       {
         nodeStack.emplace(childNode, false, newNode.get());
       }
 
       if (isRootNode)
       {
-        rootNodes.emplace_back(newNode.get());
+        scene.rootNodes.emplace_back(newNode.get());
       }
-      nodes.emplace_back(std::move(newNode));
+      scene.nodes.emplace_back(std::move(newNode));
     }
 
-    std::ranges::move(loadModelResult.images, std::back_inserter(images));
+    scene.transforms.SortByDepth();
 
     {
       ZoneScopedN("Free temp nodes");
-      loadModelResult.nodes.clear();
-    }
-    {
-      ZoneScopedN("Free mesh geometries");
-      ZoneTextF("Geometries: %llu", loadModelResult.meshGeometries.size());
-      loadModelResult.meshGeometries.clear();
+      result_->rootNodes.clear();
+      result_->nodes.clear();
     }
+  }
+
+  void ImportJob::Finish()
+  {
+    ZoneScopedN("Free mesh geometries");
+    ZoneTextF("Geometries: %llu", result_->meshGeometries.size());
+    result_.reset();
+  }
+
+  void SceneMeshlet::Import(FrogRenderer2& renderer, Utility::LoadModelResultA loadModelResult)
+  {
+    ZoneScoped;
+    auto job = ImportJob(std::move(loadModelResult));
+    while (!job.Advance(*this, renderer, {}))
     {
-      ZoneScopedN("Free nodes");
-      loadModelResult.nodes.clear();
+      // With an unlimited budget, the job only stops to wait for its images
+      imageStagingRing.Wait(imageStagingRing.GetLastSubmitValue());
     }
   }
 
-  void SceneMeshlet::CalcUpdatedData(FrogRenderer2& renderer) const
+  void SceneMeshlet::ImportAsync(std::filesystem::path path, glm::mat4 rootTransform)
   {
     ZoneScoped;
+    importJobs.emplace_back(std::move(path), rootTransform);
+  }
 
-    struct StackElement
+  void SceneMeshlet::AdvanceImports(FrogRenderer2& renderer, const ImportJob::Budget& budget)
+  {
+    ZoneScoped;
+    for (auto& job : importJobs)
     {
-      Node* node;
-      glm::mat4 parentGlobalTransform;
-    };
-    std::stack<StackElement> nodeStack;
+      // Jobs that are waiting on a worker thread or the GPU don't use up the budget
+      if (!job.Advance(*this, renderer, budget) && !job.IsWaiting())
+      {
+        // The budget for this frame was used up
+        break;
+      }
+    }
+
+    std::erase_if(importJobs, [](const ImportJob& job) { return job.GetStage() == ImportJob::Stage::DONE; });
+  }
 
-    for (auto* rootNode : rootNodes)
+  void SceneMeshlet::CalcUpdatedData(FrogRenderer2& renderer)
+  {
+    ZoneScoped;
+
+    const auto updatedNodes = transforms.UpdateGlobalTransforms();
+    if (updatedNodes.empty())
     {
-      nodeStack.emplace(rootNode, rootNode->CalcLocalTransform());
+      return;
     }
+    ZoneTextF("Updated nodes: %zu", updatedNodes.size());
 
-    // Traverse the scene
-    while (!nodeStack.empty())
+    // Find where the uniforms of each node's meshes go, so they can be written in parallel
+    auto meshOffsets = std::vector<size_t>(updatedNodes.size() + 1, 0);
+    for (size_t i = 0; i < updatedNodes.size(); i++)
     {
-      auto [node, parentGlobalTransform] = nodeStack.top();
-      nodeStack.pop();
+      meshOffsets[i + 1] = meshOffsets[i] + transforms.nodes[updatedNodes[i]]->meshes.size();
+    }
 
-      const auto globalTransform = parentGlobalTransform * node->CalcLocalTransform();
-      node->globalTransform      = globalTransform;
+    auto meshIds      = std::vector<Render::MeshID>(meshOffsets.back());
+    auto meshUniforms = std::vector<Render::ObjectUniforms>(meshOffsets.back());
+    auto lights       = std::vector<GpuLight>(updatedNodes.size());
 
-      for (auto* childNode : node->children)
+    auto indices = std::vector<size_t>(updatedNodes.size());
+    std::iota(indices.begin(), indices.end(), size_t(0));
+    std::for_each(std::execution::par,
+      indices.begin(),
+      indices.end(),
+      [&](size_t i)
       {
-        // If this node is dirty, then all its children must be dirty too.
-        if (node->isDirty)
-        {
-          childNode->isDirty = true;
-        }
+        const auto& node            = *transforms.nodes[updatedNodes[i]];
+        const auto& globalTransform = transforms.globalTransforms[updatedNodes[i]];
 
-        if (childNode->isDirty || childNode->isDescendantDirty)
+        for (size_t j = 0; j < node.meshes.size(); j++)
         {
-          nodeStack.emplace(childNode, globalTransform);
-        }
-      }
-
-      if (node->isDirty)
-      {
-        for (auto [meshId, materialId] : node->meshes)
-        {
-          const auto uniforms = Render::ObjectUniforms{
+          const auto meshId           = node.meshes[j].meshId;
+          meshIds[meshOffsets[i] + j] = meshId;
+          meshUniforms[meshOffsets[i] + j] = Render::ObjectUniforms{
             .modelPrevious = globalTransform,
             .modelCurrent = globalTransform,
+            .positionBuffer = renderer.GetPositionBufferPointerFromMesh(meshId),
             .vertexBuffer = renderer.GetVertexBufferPointerFromMesh(meshId),
-            .indexBuffer = renderer.GetOriginalIndexBufferPointerFromMesh(meshId),
-            .materialId = renderer.GetMaterialGpuIndex(materialId),
+            .meshletOffset = renderer.GetMeshletOffsetFromMesh(meshId),
+            .materialId = renderer.GetMaterialGpuIndex(node.meshes[j].materialId),
           };
-          renderer.UpdateMesh(meshId, uniforms);
         }
 
-        if (node->lightId)
+        if (node.lightId)
         {
-          auto gpuLight = node->light;
+          auto& gpuLight = lights[i];
+          gpuLight       = node.light;
 
           auto globalTransformArray = fastgltf::math::fmat4x4{};
           std::copy_n(&globalTransform[0][0], 16, globalTransformArray.data());
@@ -204,39 +481,198 @@ namespace Scene
           // We rotate (0, 0, -1) because that is the default, un-rotated direction of spot and directional lights according to the glTF spec
           gpuLight.direction = glm::normalize(rotation) * glm::vec3(0, 0, -1);
           gpuLight.position  = translation;
-
-          renderer.UpdateLight(node->lightId, gpuLight);
         }
+      });
+
+    renderer.UpdateMeshes(meshIds, meshUniforms);
+
+    // Instance groups already update their instances in parallel
+    for (size_t i = 0; i < updatedNodes.size(); i++)
+    {
+      const auto& node = *transforms.nodes[updatedNodes[i]];
+      for (auto [meshInstancesId, materialId] : node.instancedMeshes)
+      {
+        renderer.UpdateMeshInstances(meshInstancesId, materialId, transforms.globalTransforms[updatedNodes[i]], node.instanceTransforms);
       }
 
-      node->isDirty = false;
-      node->isDescendantDirty = false;
+      if (node.lightId)
+      {
+        renderer.UpdateLight(node.lightId, lights[i]);
+      }
     }
   }
 
-  glm::mat4 Node::CalcLocalTransform() const noexcept
+  void TransformHierarchy::Add(Node& node, const Node* parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
   {
-    return glm::scale(glm::translate(translation) * glm::mat4_cast(rotation), scale);
+    assert(!parent || parent->transformIndex < nodes.size());
+    node.transformIndex = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(&node);
+    parents.push_back(parent ? parent->transformIndex : noParent);
+    translations.push_back(translation);
+    rotations.push_back(rotation);
+    scales.push_back(scale);
+    globalTransforms.emplace_back(1.0f);
+    if (nodes.size() > dirtyBits.size() * 64)
+    {
+      dirtyBits.push_back(0);
+    }
+    MarkDirty(node.transformIndex);
   }
 
-  void Node::DeleteLight(FrogRenderer2& renderer)
+  void TransformHierarchy::SortByDepth()
   {
-    assert(lightId);
-    renderer.DeleteLight(lightId);
-    lightId = {0};
+    ZoneScoped;
+    const auto count = static_cast<uint32_t>(nodes.size());
+
+    // Parents come before their children, so every depth is known by the time it is needed
+    auto depths     = std::vector<uint32_t>(count);
+    auto levelCount = uint32_t(0);
+    for (uint32_t i = 0; i < count; i++)
+    {
+      depths[i]  = parents[i] == noParent ? 0 : depths[parents[i]] + 1;
+      levelCount = std::max(levelCount, depths[i] + 1);
+    }
+
+    // A counting sort keeps the order of nodes within each level, so parents still come before their children afterwards
+    levelOffsets.assign(levelCount + 1, 0);
+    for (auto depth : depths)
+    {
+      levelOffsets[depth + 1]++;
+    }
+    std::inclusive_scan(levelOffsets.begin(), levelOffsets.end(), levelOffsets.begin());
+
+    auto newIndices = std::vector<uint32_t>(count);
+    auto nextIndex  = levelOffsets;
+    for (uint32_t i = 0; i < count; i++)
+    {
+      newIndices[i] = nextIndex[depths[i]]++;
+    }
+
+    auto Permute = [&](auto& array)
+    {
+      auto sorted = std::remove_reference_t<decltype(array)>(array.size());
+      for (uint32_t i = 0; i < count; i++)
+      {
+        sorted[newIndices[i]] = std::move(array[i]);
+      }
+      array = std::move(sorted);
+    };
+
+    for (auto& parent : parents)
+    {
+      if (parent != noParent)
+      {
+        parent = newIndices[parent];
+      }
+    }
+
+    Permute(nodes);
+    Permute(parents);
+    Permute(translations);
+    Permute(rotations);
+    Permute(scales);
+    Permute(globalTransforms);
+
+    auto sortedDirtyBits = std::vector<uint64_t>(dirtyBits.size(), 0);
+    for (uint32_t i = 0; i < count; i++)
+    {
+      if ((dirtyBits[i / 64] >> (i % 64)) & 1)
+      {
+        sortedDirtyBits[newIndices[i] / 64] |= uint64_t(1) << (newIndices[i] % 64);
+      }
+    }
+    dirtyBits = std::move(sortedDirtyBits);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+      nodes[i]->transformIndex = i;
+    }
+  }
+
+  glm::mat4 TransformHierarchy::CalcLocalTransform(uint32_t index) const noexcept
+  {
+    return glm::scale(glm::translate(translations[index]) * glm::mat4_cast(rotations[index]), scales[index]);
   }
 
-  void Node::MarkDirty()
+  std::vector<uint32_t> TransformHierarchy::UpdateGlobalTransforms()
   {
-    isDirty = true;
+    ZoneScoped;
+    if (!hasDirtyNodes)
+    {
+      return {};
+    }
+    hasDirtyNodes = false;
+
+    // Each task owns a run of whole words of the dirty bitset, so only one task writes each word. The last parents of a level
+    // can share a word with the first nodes of the next level, so words are accessed atomically.
+    constexpr uint32_t wordsPerTask = 16;
+    auto IsDirty = [this](uint32_t index)
+    {
+      return (std::atomic_ref(dirtyBits[index / 64]).load(std::memory_order_relaxed) >> (index % 64)) & 1;
+    };
+
+    auto tasks = std::vector<uint32_t>();
+    for (size_t level = 0; level + 1 < levelOffsets.size(); level++)
+    {
+      ZoneScopedN("Update level");
+      const auto begin     = levelOffsets[level];
+      const auto end       = levelOffsets[level + 1];
+      const auto firstWord = begin / 64;
+      const auto endWord   = (end + 63) / 64;
+      ZoneTextF("Depth %zu: %u nodes", level, end - begin);
+
+      tasks.resize((endWord - firstWord + wordsPerTask - 1) / wordsPerTask);
+      std::iota(tasks.begin(), tasks.end(), 0u);
+      std::for_each(std::execution::par,
+        tasks.begin(),
+        tasks.end(),
+        [&](uint32_t task)
+        {
+          const auto taskFirstWord = firstWord + task * wordsPerTask;
+          const auto taskEndWord   = std::min(taskFirstWord + wordsPerTask, endWord);
+          for (auto word = taskFirstWord; word < taskEndWord; word++)
+          {
+            const auto oldBits = std::atomic_ref(dirtyBits[word]).load(std::memory_order_relaxed);
+            auto newBits       = uint64_t(0);
+            for (auto i = std::max(begin, word * 64); i < std::min(end, word * 64 + 64); i++)
+            {
+              // Children of dirty nodes are dirty too
+              const auto bit    = uint64_t(1) << (i % 64);
+              const auto parent = parents[i];
+              if (!(oldBits & bit) && (parent == noParent || !IsDirty(parent)))
+              {
+                continue;
+              }
+
+              newBits |= bit;
+              globalTransforms[i] = parent == noParent ? CalcLocalTransform(i) : globalTransforms[parent] * CalcLocalTransform(i);
+            }
+
+            if (newBits & ~oldBits)
+            {
+              std::atomic_ref(dirtyBits[word]).fetch_or(newBits, std::memory_order_relaxed);
+            }
+          }
+        });
+    }
 
-    // Tell ascendants that they have a dirty descendant
-    auto* curParent = parent;
-    while (curParent)
+    auto updatedNodes = std::vector<uint32_t>();
+    for (uint32_t word = 0; word < dirtyBits.size(); word++)
     {
-      curParent->isDescendantDirty = true;
-      curParent = curParent->parent;
+      for (auto bits = dirtyBits[word]; bits != 0; bits &= bits - 1)
+      {
+        updatedNodes.push_back(word * 64 + static_cast<uint32_t>(std::countr_zero(bits)));
+      }
+      dirtyBits[word] = 0;
     }
-    // We intentionally don't mark descendants dirty here, as that's handled in CalcUpdatedData()
+
+    return updatedNodes;
+  }
+
+  void Node::DeleteLight(FrogRenderer2& renderer)
+  {
+    assert(lightId);
+    renderer.DeleteLight(lightId);
+    lightId = {0};
   }
 } // namespace Scene
@@ -3,23 +3,28 @@
 #include "Fvog/Device.h"
 
 #include "Renderables.h"
+#include "SceneLoaderGpu.h"
 
 #include "shaders/ShadeDeferredPbr.h.glsl"
 
 #include <glm/vec2.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <limits>
+#include <memory>
 #include <vector>
 #include <string>
+#include <unordered_map>
 #include <optional>
 
 class FrogRenderer2;
 
-namespace Utility
-{
-  struct LoadModelResultA;
-}
-
 namespace Scene
 {
   struct MeshIdAndMaterialId
@@ -28,51 +33,185 @@ namespace Scene
     Render::MaterialID materialId;
   };
 
+  struct MeshInstancesIdAndMaterialId
+  {
+    Render::MeshInstancesID meshInstancesId;
+    Render::MaterialID materialId;
+  };
+
   struct Node
   {
     std::string name;
 
-    glm::vec3 translation;
-    glm::quat rotation;
-    glm::vec3 scale;
-
-    [[nodiscard]] glm::mat4 CalcLocalTransform() const noexcept;
+    // Index of the node's transforms in SceneMeshlet::transforms. Changes when nodes are added to the scene.
+    uint32_t transformIndex = 0;
 
     // Horrible interface
     void DeleteLight(FrogRenderer2& renderer);
 
-    glm::mat4 globalTransform;
-    //glm::vec3 globalAabbMin;
-    //glm::vec3 globalAabbMax;
-
     // Relationship
     Node* parent = nullptr;
     std::vector<Node*> children;
-    bool isDirty           = false; // True if transform OR light data changed
-    bool isDescendantDirty = false;
-
-    // Also tells parents that a descendant is dirty.
-    void MarkDirty();
 
     std::vector<MeshIdAndMaterialId> meshes;
+    // Nodes with instance transforms (relative to the node) spawn their meshes as instance groups instead
+    std::vector<glm::mat4> instanceTransforms;
+    std::vector<MeshInstancesIdAndMaterialId> instancedMeshes;
     Render::LightID lightId;
     GpuLight light; // Only contains valid data if lightId is not null
   };
 
+  // The transforms of every node in a scene, stored contiguously and ordered by depth so each level of the hierarchy can be updated
+  // in parallel once the level above it is done. Parents always come before their children.
+  struct TransformHierarchy
+  {
+    static constexpr uint32_t noParent = ~0u;
+
+    // Appends a node whose parent, if any, was already added. Call SortByDepth() once every new node has been added.
+    void Add(Node& node, const Node* parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+
+    // Restores depth order after nodes were added, which changes their transform indices
+    void SortByDepth();
+
+    // True if the transform OR light data changed. Descendants are marked dirty when the hierarchy is updated.
+    void MarkDirty(uint32_t index) noexcept
+    {
+      dirtyBits[index / 64] |= uint64_t(1) << (index % 64);
+      hasDirtyNodes = true;
+    }
+
+    [[nodiscard]] glm::mat4 CalcLocalTransform(uint32_t index) const noexcept;
+
+    // Updates the global transforms of dirty nodes and their descendants, then returns the indices of every node that was updated
+    std::vector<uint32_t> UpdateGlobalTransforms();
+
+    // Indexed by Node::transformIndex
+    std::vector<Node*> nodes;
+    std::vector<uint32_t> parents;
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> globalTransforms;
+    std::vector<uint64_t> dirtyBits; // One bit per node
+    bool hasDirtyNodes = false;
+
+    // Nodes at depth d are in [levelOffsets[d], levelOffsets[d + 1])
+    std::vector<uint32_t> levelOffsets;
+  };
+
+  struct SceneMeshlet;
+
+  // Moves a loaded model into a scene. The work can be spread over several calls to Advance() to avoid long stalls.
+  // Meshes are spawned as soon as their geometry is registered, so the model appears progressively.
+  class ImportJob
+  {
+  public:
+    // Loads the model on a worker thread. If the file can't be loaded, the job is done without importing anything.
+    ImportJob(std::filesystem::path path, glm::mat4 rootTransform);
+
+    // Imports an already-loaded model.
+    explicit ImportJob(Utility::LoadModelResultA loadModelResult);
+
+    struct Budget
+    {
+      std::chrono::duration<double, std::milli> time = std::chrono::duration<double, std::milli>::max();
+      size_t bytes = std::numeric_limits<size_t>::max(); // Image and geometry data uploaded per call
+    };
+
+    // Does as much work as fits in the budget. At least one item is imported per call so progress is always made.
+    // Returns true once the model has been completely imported.
+    bool Advance(SceneMeshlet& scene, FrogRenderer2& renderer, const Budget& budget);
+
+    // True if the last call to Advance() stopped to wait for a worker thread or the GPU rather than because the budget was used up
+    [[nodiscard]] bool IsWaiting() const noexcept
+    {
+      return isWaiting_;
+    }
+
+    enum class Stage
+    {
+      LOADING, // Images are uploaded as soon as they are decoded, while the rest of the model is still loading
+      UPLOADING_IMAGES,
+      WAITING_FOR_IMAGES, // Materials are only created once the GPU has finished copying their images
+      REGISTERING_GEOMETRY,
+      DONE,
+    };
+
+    [[nodiscard]] Stage GetStage() const noexcept
+    {
+      return stage_;
+    }
+
+    // In [0, 1]. Loading on the worker thread does not report progress.
+    [[nodiscard]] float GetProgress() const noexcept;
+
+    [[nodiscard]] const std::string& GetName() const noexcept
+    {
+      return name_;
+    }
+
+  private:
+    void CreateMaterialsAndNodes(SceneMeshlet& scene, FrogRenderer2& renderer);
+    void Finish();
+
+    struct PendingMesh
+    {
+      Node* node;
+      Render::MaterialID materialId;
+    };
+
+    std::string name_;
+    Stage stage_    = Stage::LOADING;
+    bool isWaiting_ = false;
+
+    std::shared_ptr<Utility::DecodedImageQueue> decodedImages_; // Shared with the worker that publishes to it
+    std::future<std::optional<Utility::LoadModelResultA>> loading_;
+    std::optional<Utility::LoadModelResultA> result_;
+
+    std::deque<Utility::DecodedImageQueue::Entry> pendingImages_; // Decoded, but not imported yet
+    size_t importedImages_     = 0;
+    size_t nextGeometry_       = 0;
+    uint64_t imageUploadValue_ = 0; // Staging ring value that signals the last image of this model was copied
+    std::vector<size_t> imageIndices_; // Where each image of the model ended up in SceneMeshlet::images. Images may finish in any order.
+    std::vector<Render::MaterialID> materialIds_;
+    std::vector<std::vector<PendingMesh>> meshesByGeometry_;
+  };
+
   struct SceneMeshlet
   {
     void Import(FrogRenderer2& renderer, Utility::LoadModelResultA loadModelResult);
 
+    // Loads a model in the background. It is imported over the following frames by AdvanceImports().
+    void ImportAsync(std::filesystem::path path, glm::mat4 rootTransform);
+    void AdvanceImports(FrogRenderer2& renderer, const ImportJob::Budget& budget);
+
     // Epic interface
-    void CalcUpdatedData(FrogRenderer2& renderer) const;
+    void CalcUpdatedData(FrogRenderer2& renderer);
+
+    void MarkDirty(const Node& node) noexcept
+    {
+      transforms.MarkDirty(node.transformIndex);
+    }
 
     std::vector<Node*> rootNodes;
     std::vector<std::unique_ptr<Node>> nodes;
+    TransformHierarchy transforms;
 
     std::vector<Fvog::Texture> images;
     std::vector<Render::MeshGeometryID> meshGeometryIds;
     std::vector<Render::MeshID> meshIds;
+    std::vector<Render::MeshInstancesID> meshInstancesIds;
     std::vector<Render::LightID> lightIds;
     std::vector<Render::MaterialID> materialIds;
+
+    // Resources are shared by content, so a prop placed by many files is only uploaded once
+    std::unordered_map<uint64_t, size_t> imageIndicesByHash; // Index into images
+    std::unordered_map<uint64_t, Render::MaterialID> materialIdsByHash;
+    std::unordered_map<uint64_t, Render::MeshGeometryID> meshGeometryIdsByHash;
+
+    std::vector<ImportJob> importJobs;
+
+    // Shared by every import, so staging memory stays bounded no matter how many models are loaded
+    Utility::StagingRing imageStagingRing;
   };
 }
@@ -1,9 +1,8 @@
 #include "SceneLoader.h"
-#include "Application.h"
+#include "AssetCache.h"
+#include "ImageProcessing.h"
 
 #include "Fvog/detail/ApiToEnum2.h"
-#include "Fvog/detail/Common.h"
-#include "Fvog/Rendering2.h"
 
 #include "Renderables.h"
 #include "MathUtilities.h"
@@ -17,13 +16,8 @@
 
 #include "ktx.h"
 
-//#include FWOG_OPENGL_HEADER
-#include <volk.h>
-
 // #include <glm/gtx/string_cast.hpp>
 
-#include "Fvog/Buffer2.h"
-
 #include <stb_image.h>
 
 #include <fastgltf/glm_element_traits.hpp>
@@ -33,10 +27,19 @@
 
 #include <meshoptimizer.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+#endif
+
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstring>
 #include <execution>
+#include <type_traits>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <numeric>
 #include <optional>
@@ -45,15 +48,6 @@
 #include <stack>
 #include <utility>
 
-#define GL_CLAMP_TO_EDGE          0x812F
-#define GL_MIRRORED_REPEAT        0x8370
-#define GL_REPEAT                 0x2901
-#define GL_LINEAR                 0x2601
-#define GL_LINEAR_MIPMAP_LINEAR   0x2703
-#define GL_LINEAR_MIPMAP_NEAREST  0x2701
-#define GL_NEAREST                0x2600
-#define GL_NEAREST_MIPMAP_LINEAR  0x2702
-#define GL_NEAREST_MIPMAP_NEAREST 0x2700
 #define GL_UNSIGNED_BYTE          0x1401
 
 namespace Utility
@@ -67,496 +61,636 @@ namespace Utility
       NORMAL,
       OCCLUSION,
       EMISSION,
+      OCCLUSION_METALLIC_ROUGHNESS, // Occlusion packed into the R channel of a metallic-roughness image
     };
 
     // Converts a Vulkan BCn VkFormat name to Fwog
 
-    // Converts a format to the sRGB version of itself, for use in a texture view
-    Fvog::Format FormatToSrgb(Fvog::Format format)
+    // Application::LoadBinaryFile is not used so that the CPU stage can be built without the windowing code
+    std::pair<std::unique_ptr<std::byte[]>, std::size_t> LoadBinaryFile(const std::filesystem::path& path)
+    {
+      const auto size = std::filesystem::file_size(path);
+      auto memory     = std::make_unique<std::byte[]>(size);
+      auto file       = std::ifstream(path, std::ifstream::binary);
+      file.read(reinterpret_cast<char*>(memory.get()), static_cast<std::streamsize>(size));
+      return {std::move(memory), size};
+    }
+
+    // Scratch memory for the temporaries of one loader task, which is released when the task ends.
+    // Within a load, each thread keeps its buffer between tasks and grows it to fit the largest task it has run, so once warm,
+    // temporaries are bump-allocated from memory that is already paged in and no locks are taken.
+    // Arenas may be nested, e.g. by a parallel algorithm running a subtask on the thread that is waiting for it.
+    // Only the outermost arena on a thread uses the thread's buffer.
+    class ScratchArena
+    {
+    public:
+      ScratchArena()
+      {
+        auto& buffer = GetThreadBuffer();
+        if (!buffer.inUse)
+        {
+          // A load finished since this buffer last grew. Drop back to the initial size rather than holding on to the largest task of that load.
+          if (const auto generation = retainGeneration_.load(std::memory_order_relaxed); buffer.generation != generation)
+          {
+            if (buffer.size > initialSize)
+            {
+              buffer.data = std::make_unique_for_overwrite<std::byte[]>(initialSize);
+              buffer.size = initialSize;
+            }
+            buffer.generation = generation;
+          }
+
+          buffer.inUse = true;
+          ownsBuffer_  = true;
+          resource_.emplace(buffer.data.get(), buffer.size, &overflow_);
+        }
+        else
+        {
+          resource_.emplace(&overflow_);
+        }
+      }
+
+      ScratchArena(const ScratchArena&)            = delete;
+      ScratchArena& operator=(const ScratchArena&) = delete;
+
+      ~ScratchArena()
+      {
+        resource_.reset();
+        if (!ownsBuffer_)
+        {
+          return;
+        }
+
+        auto& buffer = GetThreadBuffer();
+        if (const auto size = std::min(buffer.size + overflow_.bytes, maxRetainedSize);
+            size > buffer.size && buffer.generation == retainGeneration_.load(std::memory_order_relaxed))
+        {
+          buffer.data = std::make_unique_for_overwrite<std::byte[]>(size);
+          buffer.size = size;
+        }
+        buffer.inUse = false;
+      }
+
+      [[nodiscard]] std::pmr::memory_resource* Get() noexcept
+      {
+        return &*resource_;
+      }
+
+      // Called when a load finishes. Buffers that grew during it are shrunk the next time their thread creates an arena.
+      static void ReleaseRetainedBuffers() noexcept
+      {
+        retainGeneration_.fetch_add(1, std::memory_order_relaxed);
+      }
+
+    private:
+      static constexpr size_t initialSize     = size_t(4) << 20;
+      static constexpr size_t maxRetainedSize = size_t(64) << 20;
+
+      static inline std::atomic_uint32_t retainGeneration_ = 0;
+
+      struct ThreadBuffer
+      {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+        bool inUse;
+        uint32_t generation;
+      };
+
+      static ThreadBuffer& GetThreadBuffer()
+      {
+        thread_local auto buffer = ThreadBuffer{
+          std::make_unique_for_overwrite<std::byte[]>(initialSize),
+          initialSize,
+          false,
+          retainGeneration_.load(std::memory_order_relaxed),
+        };
+        return buffer;
+      }
+
+      // Counts what the task needed beyond the thread's buffer
+      class OverflowCounter final : public std::pmr::memory_resource
+      {
+      public:
+        size_t bytes = 0;
+
+      private:
+        void* do_allocate(size_t size, size_t alignment) override
+        {
+          bytes += size;
+          return std::pmr::new_delete_resource()->allocate(size, alignment);
+        }
+
+        void do_deallocate(void* p, size_t size, size_t alignment) override
+        {
+          std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+          return this == &other;
+        }
+      };
+
+      bool ownsBuffer_ = false;
+      OverflowCounter overflow_;
+      std::optional<std::pmr::monotonic_buffer_resource> resource_;
+    };
+
+    // Calls f(i) for every i in [0, count), on every core if parallel is set
+    template<typename F>
+    void ForEachIndex(size_t count, bool parallel, std::pmr::memory_resource* scratch, F&& f)
+    {
+      auto indices = std::pmr::vector<size_t>(count, scratch);
+      std::iota(indices.begin(), indices.end(), size_t(0));
+      if (parallel)
+      {
+        std::for_each(std::execution::par, indices.begin(), indices.end(), f);
+      }
+      else
+      {
+        std::for_each(indices.begin(), indices.end(), f);
+      }
+    }
+
+    uint64_t ImageToBufferSize(Fvog::Format format, Fvog::Extent3D extent)
     {
-      switch (format)
+      if (Fvog::detail::FormatIsBlockCompressed(format))
       {
-      case Fvog::Format::BC1_RGBA_UNORM: return Fvog::Format::BC1_RGBA_SRGB;
-      case Fvog::Format::BC1_RGB_UNORM:  return Fvog::Format::BC1_RGB_SRGB;
-      case Fvog::Format::BC2_RGBA_UNORM: return Fvog::Format::BC2_RGBA_SRGB;
-      case Fvog::Format::BC3_RGBA_UNORM: return Fvog::Format::BC3_RGBA_SRGB;
-      case Fvog::Format::BC7_RGBA_UNORM: return Fvog::Format::BC7_RGBA_SRGB;
-      case Fvog::Format::R8G8B8A8_UNORM: return Fvog::Format::R8G8B8A8_SRGB;
-      default: return format;
+        return Fvog::detail::BlockCompressedImageSize(format, extent.width, extent.height, extent.depth);
       }
+
+      return extent.width * extent.height * extent.depth * Fvog::detail::FormatStorageSize(format);
     }
 
-    auto ConvertGlAddressMode(uint32_t wrap)
+    // The block-compressed format that JPEG and PNG images are encoded to on import, based on how they're sampled.
+    // Also used for KTX images that libktx can't transcode to the format we want.
+    struct ImageCompression
+    {
+      ImageProcessing::Rgba8Encoding encoding;
+      ImageProcessing::BlockFormat blockFormat;
+      Fvog::Format format;
+      bool moveGbToRg = false; // See ImageData::metallicRoughnessInRg
+    };
+
+    ImageCompression GetImageCompression(ImageUsage usage)
     {
-      switch (wrap)
+      switch (usage)
       {
-      case GL_CLAMP_TO_EDGE: return VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-      case GL_MIRRORED_REPEAT: return VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT;
-      case GL_REPEAT: return VK_SAMPLER_ADDRESS_MODE_REPEAT;
-      default: assert(false); return VK_SAMPLER_ADDRESS_MODE_REPEAT;
+      case ImageUsage::BASE_COLOR: return {ImageProcessing::Rgba8Encoding::SRGB, ImageProcessing::BlockFormat::BC7_RGBA, Fvog::Format::BC7_RGBA_UNORM};
+      // Only G and B are used, so they are moved into the two channels that BC5 keeps
+      case ImageUsage::METALLIC_ROUGHNESS: return {ImageProcessing::Rgba8Encoding::LINEAR, ImageProcessing::BlockFormat::BC5_RG, Fvog::Format::BC5_RG_UNORM, true};
+      // Z is reconstructed when sampling
+      case ImageUsage::NORMAL: return {ImageProcessing::Rgba8Encoding::NORMAL_MAP, ImageProcessing::BlockFormat::BC5_RG, Fvog::Format::BC5_RG_UNORM};
+      case ImageUsage::OCCLUSION: return {ImageProcessing::Rgba8Encoding::LINEAR, ImageProcessing::BlockFormat::BC4_R, Fvog::Format::BC4_R_UNORM};
+      case ImageUsage::EMISSION: return {ImageProcessing::Rgba8Encoding::SRGB, ImageProcessing::BlockFormat::BC1_RGB, Fvog::Format::BC1_RGB_UNORM};
+      // All three channels are needed. One BC7 image is still smaller than a BC4 and a BC5 image holding the same channels.
+      case ImageUsage::OCCLUSION_METALLIC_ROUGHNESS: return {ImageProcessing::Rgba8Encoding::LINEAR, ImageProcessing::BlockFormat::BC7_RGBA, Fvog::Format::BC7_RGBA_UNORM};
       }
+
+      assert(false);
+      return {};
+    }
+
+    // Bump this whenever mip generation or block compression changes.
+    constexpr uint32_t imageCacheVersion = 2;
+    constexpr uint32_t imageCacheMagic   = 0x474D4946; // "FIMG"
+    constexpr std::string_view imageCacheCategory = "images";
+
+    struct ImageCacheHeader
+    {
+      uint32_t magic;
+      uint32_t version;
+      Fvog::Format format;
+      uint32_t width;
+      uint32_t height;
+      uint64_t dataSize;
+    };
+
+    uint64_t MakeImageCacheKey(std::span<const std::byte> encodedPixelData, ImageUsage usage)
+    {
+      ZoneScoped;
+      struct BuildParameters
+      {
+        uint32_t version;
+        ImageUsage usage;
+      };
+
+      return AssetCache::Hash(encodedPixelData, AssetCache::HashValue(BuildParameters{.version = imageCacheVersion, .usage = usage}));
     }
 
-    auto ConvertGlFilterMode(uint32_t filter)
+    // Size of a full mip chain stored contiguously
+    uint64_t GetImageChainSize(Fvog::Format format, uint32_t width, uint32_t height)
     {
-      switch (filter)
+      uint64_t size = 0;
+      for (uint32_t level = 0; level < ImageProcessing::GetMipLevelCount(width, height); level++)
       {
-      case GL_LINEAR_MIPMAP_LINEAR:  //[[fallthrough]]
-      case GL_LINEAR_MIPMAP_NEAREST: //[[fallthrough]]
-      case GL_LINEAR: return VK_FILTER_LINEAR;
-      case GL_NEAREST_MIPMAP_LINEAR:  //[[fallthrough]]
-      case GL_NEAREST_MIPMAP_NEAREST: //[[fallthrough]]
-      case GL_NEAREST: return VK_FILTER_NEAREST;
-      default: assert(false); return VK_FILTER_LINEAR;
+        size += ImageToBufferSize(format, Fvog::Extent3D{std::max(width >> level, 1u), std::max(height >> level, 1u), 1});
       }
+
+      return size;
     }
 
-    auto GetGlMipmapFilter(uint32_t minFilter)
+    // Fills in the levels of a full mip chain that is stored contiguously in storage
+    void SetImageLevels(ImageData& imageData, std::shared_ptr<std::byte[]> storage, uint32_t width, uint32_t height)
     {
-      switch (minFilter)
+      size_t offset = 0;
+      for (uint32_t level = 0; level < ImageProcessing::GetMipLevelCount(width, height); level++)
       {
-      case GL_LINEAR_MIPMAP_LINEAR: [[fallthrough]];
-      case GL_NEAREST_MIPMAP_LINEAR: return VK_SAMPLER_MIPMAP_MODE_LINEAR;
-      case GL_LINEAR_MIPMAP_NEAREST: [[fallthrough]];
-      case GL_NEAREST_MIPMAP_NEAREST: return VK_SAMPLER_MIPMAP_MODE_NEAREST;
-      case GL_LINEAR: [[fallthrough]];
-      case GL_NEAREST: [[fallthrough]];
-      default: assert(false); return VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        const auto extent = Fvog::Extent3D{std::max(width >> level, 1u), std::max(height >> level, 1u), 1};
+        const auto size   = ImageToBufferSize(imageData.format, extent);
+        imageData.levels.emplace_back(extent, std::span<const std::byte>(storage.get() + offset, size));
+        offset += size;
       }
+
+      imageData.storage = std::move(storage);
     }
 
-    uint64_t ImageToBufferSize(Fvog::Format format, Fvog::Extent3D extent)
+    bool LoadCachedImage(uint64_t key, ImageData& imageData)
     {
-      if (Fvog::detail::FormatIsBlockCompressed(format))
+      ZoneScoped;
+      auto reader = AssetCache::EntryReader(imageCacheCategory, key);
+      if (!reader.IsOpen())
       {
-        return Fvog::detail::BlockCompressedImageSize(format, extent.width, extent.height, extent.depth);
+        return false;
       }
 
-      return extent.width * extent.height * extent.depth * Fvog::detail::FormatStorageSize(format);
+      auto header = ImageCacheHeader{};
+      if (!reader.ReadSection(std::span<ImageCacheHeader>(&header, 1)) || header.magic != imageCacheMagic || header.version != imageCacheVersion ||
+          header.format != imageData.format || header.width == 0 || header.height == 0 || header.dataSize > reader.RemainingBytes() ||
+          header.dataSize != GetImageChainSize(header.format, header.width, header.height))
+      {
+        reader.Discard();
+        return false;
+      }
+
+      auto storage = std::shared_ptr<std::byte[]>(new std::byte[header.dataSize]);
+      if (!reader.ReadSection(std::span(storage.get(), header.dataSize)) || !reader.AtEnd())
+      {
+        reader.Discard();
+        return false;
+      }
+
+      SetImageLevels(imageData, std::move(storage), header.width, header.height);
+      return true;
+    }
+
+    void StoreCachedImage(uint64_t key, const ImageData& imageData)
+    {
+      ZoneScoped;
+      const auto& extent = imageData.levels.front().extent;
+
+      // Levels are contiguous, so the whole chain can be written as one section
+      const auto data   = std::span(imageData.levels.front().data.data(), imageData.SizeBytes());
+      const auto header = ImageCacheHeader{
+        .magic    = imageCacheMagic,
+        .version  = imageCacheVersion,
+        .format   = imageData.format,
+        .width    = extent.width,
+        .height   = extent.height,
+        .dataSize = data.size(),
+      };
+
+      const std::span<const std::byte> sections[] = {
+        std::as_bytes(std::span(&header, 1)),
+        data,
+      };
+
+      AssetCache::WriteEntry(imageCacheCategory, key, sections);
+    }
+
+    // Generates the mip chain of an RGBA8 image and block-compresses every level
+    void CompressImage(std::span<const std::byte> rgba8, uint32_t width, uint32_t height, const ImageCompression& compression, ImageData& imageData)
+    {
+      ZoneScoped;
+      // The image becomes the first level of a buffer that holds the whole mip chain
+      const auto chainSize = ImageProcessing::GetRgba8MipChainSize(width, height);
+      auto chain           = std::make_unique<std::byte[]>(chainSize);
+      std::memcpy(chain.get(), rgba8.data(), size_t(width) * height * 4);
+
+      // Swizzling first lets the mips be filtered like any other linear image
+      if (compression.moveGbToRg)
+      {
+        ImageProcessing::MoveGbToRg(std::span(chain.get(), size_t(width) * height * 4));
+      }
+
+      // Filter color in linear space and keep normals unit-length, otherwise distant surfaces get darker and flatter
+      ImageProcessing::GenerateRgba8Mips(std::span(chain.get(), chainSize), width, height, compression.encoding);
+
+      const auto levelCount = ImageProcessing::GetMipLevelCount(width, height);
+      size_t compressedSize = 0;
+      for (uint32_t level = 0; level < levelCount; level++)
+      {
+        compressedSize += ImageProcessing::GetBlockCompressedSize(compression.blockFormat, std::max(width >> level, 1u), std::max(height >> level, 1u));
+      }
+
+      auto compressed = std::shared_ptr<std::byte[]>(new std::byte[compressedSize]);
+      size_t srcOffset = 0;
+      size_t dstOffset = 0;
+      for (uint32_t level = 0; level < levelCount; level++)
+      {
+        const auto levelWidth  = std::max(width >> level, 1u);
+        const auto levelHeight = std::max(height >> level, 1u);
+        const auto srcSize     = size_t(levelWidth) * levelHeight * 4;
+        const auto dstSize     = ImageProcessing::GetBlockCompressedSize(compression.blockFormat, levelWidth, levelHeight);
+        ImageProcessing::EncodeBlockCompressed(compression.blockFormat,
+          std::span(chain.get() + srcOffset, srcSize),
+          levelWidth,
+          levelHeight,
+          std::span(compressed.get() + dstOffset, dstSize));
+        srcOffset += srcSize;
+        dstOffset += dstSize;
+      }
+
+      SetImageLevels(imageData, std::move(compressed), width, height);
+    }
+
+    // Decodes a JPEG or PNG, generates its mip chain, and block-compresses every level
+    void DecodeAndCompressImage(std::span<const std::byte> encodedPixelData, const ImageCompression& compression, ImageData& imageData)
+    {
+      ZoneScoped;
+      int x, y, comp;
+      auto* pixels = stbi_load_from_memory(reinterpret_cast<const unsigned char*>(encodedPixelData.data()),
+                                           static_cast<int>(encodedPixelData.size()),
+                                           &x,
+                                           &y,
+                                           &comp,
+                                           4);
+
+      assert(pixels != nullptr);
+
+      const auto width  = static_cast<uint32_t>(x);
+      const auto height = static_cast<uint32_t>(y);
+      CompressImage(std::as_bytes(std::span(pixels, size_t(width) * height * 4)), width, height, compression, imageData);
+      stbi_image_free(pixels);
     }
 
-    std::vector<Fvog::Texture> LoadImages(const fastgltf::Asset& asset)
+    // Determines how each image is used so it can be transcoded or compressed to the proper format
+    std::vector<ImageUsage> GetImageUsages(const fastgltf::Asset& asset)
     {
       ZoneScoped;
 
       auto imageUsages = std::vector<ImageUsage>(asset.images.size(), ImageUsage::BASE_COLOR);
 
-      // Determine how each image is used so we can transcode to the proper format.
-      // Assumption: each image has exactly one usage, or is used for both metallic-roughness AND occlusion (which is handled in LoadImages()).
+      // Assumption: each image has exactly one usage, or is used for both metallic-roughness AND occlusion (possibly by different materials).
+      // Occlusion and metallic-roughness are tracked separately so a shared image is detected no matter which is seen first.
+      auto usedForOcclusion         = std::vector<bool>(asset.images.size(), false);
+      auto usedForMetallicRoughness = std::vector<bool>(asset.images.size(), false);
+
+      // Matches the image that LoadMaterials picks for each texture
+      auto GetImageIndex = [&](const auto& textureInfo)
+      {
+        const auto& texture = asset.textures[textureInfo->textureIndex];
+        return texture.imageIndex ? texture.imageIndex : texture.basisuImageIndex;
+      };
+
+      for (const auto& material : asset.materials)
       {
-        ZoneScopedN("Determine Image Uses");
-        for (const auto& material : asset.materials)
+        if (material.pbrData.baseColorTexture && GetImageIndex(material.pbrData.baseColorTexture))
         {
-          if (material.pbrData.baseColorTexture && asset.textures[material.pbrData.baseColorTexture->textureIndex].imageIndex)
-          {
-            imageUsages[*asset.textures[material.pbrData.baseColorTexture->textureIndex].imageIndex] = ImageUsage::BASE_COLOR;
-          }
-          if (material.normalTexture && asset.textures[material.normalTexture->textureIndex].imageIndex)
-          {
-            imageUsages[*asset.textures[material.normalTexture->textureIndex].imageIndex] = ImageUsage::NORMAL;
-          }
-          if (material.pbrData.metallicRoughnessTexture && asset.textures[material.pbrData.metallicRoughnessTexture->textureIndex].imageIndex)
-          {
-            imageUsages[*asset.textures[material.pbrData.metallicRoughnessTexture->textureIndex].imageIndex] = ImageUsage::METALLIC_ROUGHNESS;
-          }
-          if (material.occlusionTexture && asset.textures[material.occlusionTexture->textureIndex].imageIndex)
-          {
-            imageUsages[*asset.textures[material.occlusionTexture->textureIndex].imageIndex] = ImageUsage::OCCLUSION;
-          }
-          if (material.emissiveTexture && asset.textures[material.emissiveTexture->textureIndex].imageIndex)
-          {
-            imageUsages[*asset.textures[material.emissiveTexture->textureIndex].imageIndex] = ImageUsage::EMISSION;
-          }
+          imageUsages[*GetImageIndex(material.pbrData.baseColorTexture)] = ImageUsage::BASE_COLOR;
+        }
+        if (material.normalTexture && GetImageIndex(material.normalTexture))
+        {
+          imageUsages[*GetImageIndex(material.normalTexture)] = ImageUsage::NORMAL;
+        }
+        if (material.pbrData.metallicRoughnessTexture && GetImageIndex(material.pbrData.metallicRoughnessTexture))
+        {
+          usedForMetallicRoughness[*GetImageIndex(material.pbrData.metallicRoughnessTexture)] = true;
+        }
+        if (material.occlusionTexture && GetImageIndex(material.occlusionTexture))
+        {
+          usedForOcclusion[*GetImageIndex(material.occlusionTexture)] = true;
+        }
+        if (material.emissiveTexture && GetImageIndex(material.emissiveTexture))
+        {
+          imageUsages[*GetImageIndex(material.emissiveTexture)] = ImageUsage::EMISSION;
+        }
+      }
+
+      // A shared image must keep all three channels, but separate ones can drop the channels that aren't sampled
+      for (size_t i = 0; i < imageUsages.size(); i++)
+      {
+        if (usedForOcclusion[i] && usedForMetallicRoughness[i])
+        {
+          imageUsages[i] = ImageUsage::OCCLUSION_METALLIC_ROUGHNESS;
+        }
+        else if (usedForMetallicRoughness[i])
+        {
+          imageUsages[i] = ImageUsage::METALLIC_ROUGHNESS;
+        }
+        else if (usedForOcclusion[i])
+        {
+          imageUsages[i] = ImageUsage::OCCLUSION;
         }
       }
 
+      return imageUsages;
+    }
+
+    ImageData DecodeImage(const fastgltf::Asset& asset, size_t index, ImageUsage usage)
+    {
+      ZoneScoped;
       struct RawImageData
       {
-        // Used for ktx and non-ktx images alike
-        std::unique_ptr<std::byte[]> encodedPixelData = {};
-        std::size_t encodedPixelSize = 0;
+        // Used for ktx and non-ktx images alike.
+        // Refers to memory owned by the asset, or by fileData if the image was loaded from a separate file.
+        std::span<const std::byte> encodedPixelData = {};
+        std::unique_ptr<std::byte[]> fileData = {};
 
         bool isKtx = false;
-        Fvog::Format formatIfKtx;
-        int width = 0;
-        int height = 0;
-        int pixel_type = GL_UNSIGNED_BYTE;
-        int bits = 8;
-        int components = 0;
         std::string name;
-
-        // Non-ktx. Raw decoded pixel data
-        std::unique_ptr<unsigned char[], decltype([](unsigned char* p) { stbi_image_free(p); })> data = {};
-
-        // ktx
-        std::unique_ptr<ktxTexture2, decltype([](ktxTexture2* p) { ktxTexture_Destroy(ktxTexture(p)); })> ktx = {};
       };
       
-      auto MakeRawImageData = [](const void* data, std::size_t dataSize, fastgltf::MimeType mimeType, std::string_view name) -> RawImageData
+      auto MakeRawImageData = [](std::span<const std::byte> data, fastgltf::MimeType mimeType, std::string_view name) -> RawImageData
       {
         assert(mimeType == fastgltf::MimeType::JPEG || 
                mimeType == fastgltf::MimeType::PNG ||
                mimeType == fastgltf::MimeType::KTX2 ||
                mimeType == fastgltf::MimeType::GltfBuffer);
-        auto dataCopy = std::make_unique<std::byte[]>(dataSize);
-        std::copy_n(static_cast<const std::byte*>(data), dataSize, dataCopy.get());
 
         return RawImageData{
-          .encodedPixelData = std::move(dataCopy),
-          .encodedPixelSize = dataSize,
+          .encodedPixelData = data,
           .isKtx = mimeType == fastgltf::MimeType::KTX2,
           .name = std::string(name),
         };
       };
 
-      const auto indices = std::ranges::iota_view((size_t)0, asset.images.size());
-
-      // Load and decode image data locally, in parallel
-      auto rawImageData = std::vector<RawImageData>(asset.images.size());
+      const fastgltf::Image& image = asset.images[index];
+      if (image.name.empty())
+      {
+        constexpr std::string_view unnamed = "Unnamed image";
+        ZoneName(unnamed.data(), unnamed.size());
+      }
+      else
+      {
+        ZoneName(image.name.c_str(), image.name.size());
+      }
 
-      std::transform(
-        std::execution::par,
-        indices.begin(),
-        indices.end(),
-        rawImageData.begin(),
-        [&](size_t index)
+      auto rawImage = [&]
+      {
+        if (const auto* filePath = std::get_if<fastgltf::sources::URI>(&image.data))
         {
-          ZoneScopedN("Load Image");
-          const fastgltf::Image& image = asset.images[index];
-          if (image.name.empty())
-          {
-            constexpr std::string_view unnamed = "Unnamed image";
-            ZoneName(unnamed.data(), unnamed.size());
-          }
-          else
+          assert(filePath->fileByteOffset == 0); // We don't support file offsets
+          assert(filePath->uri.isLocalPath());   // We're only capable of loading local files
+    
+          auto [fileData, fileSize] = LoadBinaryFile(filePath->uri.path());
+    
+          auto rawImageData     = MakeRawImageData(std::span(fileData.get(), fileSize), filePath->mimeType, image.name);
+          rawImageData.fileData = std::move(fileData);
+          return rawImageData;
+        }
+        if (const auto* array = std::get_if<fastgltf::sources::Array>(&image.data))
+        {
+          return MakeRawImageData(std::span(array->bytes.data(), array->bytes.size()), array->mimeType, image.name);
+        }
+        if (const auto* view = std::get_if<fastgltf::sources::BufferView>(&image.data))
+        {
+          auto& bufferView = asset.bufferViews[view->bufferViewIndex];
+          auto& buffer = asset.buffers[bufferView.bufferIndex];
+          if (const auto* array = std::get_if<fastgltf::sources::Array>(&buffer.data))
           {
-            ZoneName(image.name.c_str(), image.name.size());
+            return MakeRawImageData(std::span(array->bytes.data() + bufferView.byteOffset, bufferView.byteLength), view->mimeType, image.name);
           }
-
-          auto rawImage = [&]
-          {
-            if (const auto* filePath = std::get_if<fastgltf::sources::URI>(&image.data))
-            {
-              assert(filePath->fileByteOffset == 0); // We don't support file offsets
-              assert(filePath->uri.isLocalPath());   // We're only capable of loading local files
-        
-              auto fileData = Application::LoadBinaryFile(filePath->uri.path());
+        }
         
-              return MakeRawImageData(fileData.first.get(), fileData.second, filePath->mimeType, image.name);
-            }
-            if (const auto* array = std::get_if<fastgltf::sources::Array>(&image.data))
-            {
-              return MakeRawImageData(array->bytes.data(), array->bytes.size(), array->mimeType, image.name);
-            }
-            if (const auto* view = std::get_if<fastgltf::sources::BufferView>(&image.data))
-            {
-              auto& bufferView = asset.bufferViews[view->bufferViewIndex];
-              auto& buffer = asset.buffers[bufferView.bufferIndex];
-              if (const auto* array = std::get_if<fastgltf::sources::Array>(&buffer.data))
-              {
-                return MakeRawImageData(array->bytes.data() + bufferView.byteOffset, bufferView.byteLength, view->mimeType, image.name);
-              }
-            }
-            
-            assert(0);
-            return RawImageData{};
-          }();
+        assert(0);
+        return RawImageData{};
+      }();
+
+      // Also keys the compressed image cache
+      auto imageData = ImageData{
+        .name        = rawImage.name.empty() ? "Loaded Material" : rawImage.name,
+        .contentHash = MakeImageCacheKey(rawImage.encodedPixelData, usage),
+      };
+    
+      if (rawImage.isKtx)
+      {
+        ZoneScopedN("Decode KTX 2");
+        ktxTexture2* ktx{};
+        if (auto result = ktxTexture2_CreateFromMemory(reinterpret_cast<const ktx_uint8_t*>(rawImage.encodedPixelData.data()),
+                                                       rawImage.encodedPixelData.size(),
+                                                       KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
+                                                       &ktx);
+            result != KTX_SUCCESS)
+        {
+          assert(false);
+        }
+
+        auto ktxStorage = std::shared_ptr<const void>(ktx, [](const void* p) { ktxTexture_Destroy(ktxTexture(static_cast<ktxTexture2*>(const_cast<void*>(p)))); });
         
-          if (rawImage.isKtx)
-          {
-            ZoneScopedN("Decode KTX 2");
-            ktxTexture2* ktx{};
-            if (auto result = ktxTexture2_CreateFromMemory(reinterpret_cast<const ktx_uint8_t*>(rawImage.encodedPixelData.get()),
-                                                           rawImage.encodedPixelSize,
-                                                           KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
-                                                           &ktx);
-                result != KTX_SUCCESS)
-            {
-              assert(false);
-            }
-            
-            ktx_transcode_fmt_e ktxTranscodeFormat{};
-            
-            switch (imageUsages[index])
-            {
-            case ImageUsage::BASE_COLOR:
-              rawImage.formatIfKtx = Fvog::Format::BC7_RGBA_UNORM;
-              ktxTranscodeFormat = KTX_TTF_BC7_RGBA;
-              break;
-            // Occlusion and metallicRoughness _may_ be encoded within the same image, so we have to use at least an RGB format here.
-            // In the event where these textures are guaranteed to be separate, we can use BC4 and BC5 for better quality.
-            case ImageUsage::OCCLUSION: [[fallthrough]];
-            case ImageUsage::METALLIC_ROUGHNESS:
-              rawImage.formatIfKtx = Fvog::Format::BC7_RGBA_UNORM;
-              ktxTranscodeFormat = KTX_TTF_BC7_RGBA;
-              break;
-            // The glTF spec states that normal textures must be encoded with three channels, even though the third could be trivially reconstructed.
-            // libktx is incapable of decoding XYZ normal maps to BC5 as their alpha channel is mapped to BC5's G channel, so we are stuck with this.
-            case ImageUsage::NORMAL:
-              rawImage.formatIfKtx = Fvog::Format::BC7_RGBA_UNORM;
-              ktxTranscodeFormat = KTX_TTF_BC7_RGBA;
-              break;
-            // TODO: evaluate whether BC7 is necessary here.
-            case ImageUsage::EMISSION:
-              rawImage.formatIfKtx = Fvog::Format::BC7_RGBA_UNORM;
-              ktxTranscodeFormat = KTX_TTF_BC7_RGBA;
-              break;
-            }
+        ktx_transcode_fmt_e ktxTranscodeFormat{};
 
-            // If the image needs is in a supercompressed encoding, transcode it to a desired format
-            if (ktxTexture2_NeedsTranscoding(ktx))
-            {
-              ZoneScopedN("Transcode KTX 2 Texture");
-              if (auto result = ktxTexture2_TranscodeBasis(ktx, ktxTranscodeFormat, KTX_TF_HIGH_QUALITY); result != KTX_SUCCESS)
-              {
-                assert(false);
-              }
-            }
-            else
-            {
-              // Use the format that the image is already in
-              rawImage.formatIfKtx = Fvog::detail::VkToFormat(static_cast<VkFormat>(ktx->vkFormat));
-            }
+        // Set when libktx can't transcode the image to the format we want, in which case it is transcoded to RGBA8 and compressed like a JPEG or PNG
+        auto compressAfterTranscode = false;
         
-            rawImage.width = ktx->baseWidth;
-            rawImage.height = ktx->baseHeight;
-            rawImage.components = ktxTexture2_GetNumComponents(ktx);
-            rawImage.ktx.reset(ktx);
+        switch (usage)
+        {
+        case ImageUsage::BASE_COLOR:
+          imageData.format = Fvog::Format::BC7_RGBA_UNORM;
+          ktxTranscodeFormat = KTX_TTF_BC7_RGBA;
+          break;
+        case ImageUsage::OCCLUSION:
+          imageData.format = Fvog::Format::BC4_R_UNORM;
+          ktxTranscodeFormat = KTX_TTF_BC4_R;
+          break;
+        // libktx can't move metallic (B) and roughness (G) into BC5's channels
+        case ImageUsage::METALLIC_ROUGHNESS:
+          compressAfterTranscode = true;
+          break;
+        case ImageUsage::OCCLUSION_METALLIC_ROUGHNESS:
+          imageData.format = Fvog::Format::BC7_RGBA_UNORM;
+          ktxTranscodeFormat = KTX_TTF_BC7_RGBA;
+          break;
+        // The glTF spec states that normal textures must be encoded with three channels, even though the third could be trivially reconstructed.
+        // libktx maps the alpha channel to BC5's G channel, which only works for normal maps that were encoded with two components (Y in alpha).
+        case ImageUsage::NORMAL:
+          if (ktxTexture2_GetNumComponents(ktx) == 2)
+          {
+            imageData.format   = Fvog::Format::BC5_RG_UNORM;
+            ktxTranscodeFormat = KTX_TTF_BC5_RG;
           }
           else
           {
-            ZoneScopedN("Decode JPEG/PNG");
-            int x, y, comp;
-            auto* pixels = stbi_load_from_memory(reinterpret_cast<const unsigned char*>(rawImage.encodedPixelData.get()),
-                                                 static_cast<int>(rawImage.encodedPixelSize),
-                                                 &x,
-                                                 &y,
-                                                 &comp,
-                                                 4);
-        
-            assert(pixels != nullptr);
-        
-            rawImage.width = x;
-            rawImage.height = y;
-            // rawImage.components = comp;
-            rawImage.components = 4; // If forced 4 components
-            rawImage.data.reset(pixels);
+            compressAfterTranscode = true;
           }
-
-          ZoneTextF("Dimensions: (%d, %d)", rawImage.height, rawImage.width);
-          return rawImage;
-        });
-
-      struct ImageUploadInfo
-      {
-        size_t imageIndex;
-        uint32_t level;
-        Fvog::Extent3D extent;
-        const void* data;
-        size_t bufferOffset;
-        size_t size;
-      };
-      size_t currentBufferOffset = 0;
-
-      auto imageUploadInfos = std::vector<ImageUploadInfo>();
-      imageUploadInfos.reserve(rawImageData.size());
-
-      // Upload image data to GPU
-      auto loadedImages = std::vector<Fvog::Texture>();
-      loadedImages.reserve(rawImageData.size()); // This .reserve() is critical for iterator stability
-
-      auto imagesToBarrier = std::vector<Fvog::Texture*>();
-      imagesToBarrier.reserve(rawImageData.size());
-
-      constexpr size_t BATCH_SIZE = 1'000'000'000;
-      auto stagingBuffer = Fvog::Buffer({.size = BATCH_SIZE, .flag = Fvog::BufferFlagThingy::MAP_SEQUENTIAL_WRITE}, "Scene Loader Staging Buffer");
-
-      auto flushImageUploads = [&] {
-        ZoneScopedN("Flush Image Uploads");
-
-        // Recreate staging buffer if it's too small
-        if (currentBufferOffset + imageUploadInfos.back().size > stagingBuffer.SizeBytes())
-        {
-          stagingBuffer = Fvog::Buffer(
-            {.size = VkDeviceSize((currentBufferOffset + imageUploadInfos.back().size) * 1.5), .flag = Fvog::BufferFlagThingy::MAP_SEQUENTIAL_WRITE},
-            "Scene Loader Staging Buffer");
+          break;
+        // TODO: evaluate whether BC7 is necessary here.
+        case ImageUsage::EMISSION:
+          imageData.format = Fvog::Format::BC7_RGBA_UNORM;
+          ktxTranscodeFormat = KTX_TTF_BC7_RGBA;
+          break;
         }
 
-        // Fire off copies in one batch
-        Fvog::GetDevice().ImmediateSubmit([&](VkCommandBuffer commandBuffer)
+        // If the image needs is in a supercompressed encoding, transcode it to a desired format
+        if (ktxTexture2_NeedsTranscoding(ktx) && compressAfterTranscode)
         {
-          auto ctx = Fvog::Context(commandBuffer);
-          for (auto* loadedImage : imagesToBarrier)
+          const auto compression          = GetImageCompression(usage);
+          imageData.format                = compression.format;
+          imageData.metallicRoughnessInRg = compression.moveGbToRg;
+
+          // The compressed mip chain replaces the one in the file, so there's no need to keep the KTX around
+          if (!LoadCachedImage(imageData.contentHash, imageData))
           {
-            ctx.ImageBarrierDiscard(*loadedImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-          }
+            ZoneScopedN("Transcode KTX 2 Texture");
+            if (auto result = ktxTexture2_TranscodeBasis(ktx, KTX_TTF_RGBA32, KTX_TF_HIGH_QUALITY); result != KTX_SUCCESS)
+            {
+              assert(false);
+            }
 
+            size_t offset{};
+            ktxTexture_GetImageOffset(ktxTexture(ktx), 0, 0, 0, &offset);
+            const auto rgba8 = std::span(reinterpret_cast<const std::byte*>(ktx->pData) + offset, size_t(ktx->baseWidth) * ktx->baseHeight * 4);
+            CompressImage(rgba8, ktx->baseWidth, ktx->baseHeight, compression, imageData);
+            StoreCachedImage(imageData.contentHash, imageData);
+          }
+        }
+        else
+        {
+          if (ktxTexture2_NeedsTranscoding(ktx))
           {
-            ZoneScopedN("Memcpy to buffer");
-            std::for_each(std::execution::par,
-              imageUploadInfos.begin(),
-              imageUploadInfos.end(),
-              [&](const ImageUploadInfo& imageUpload)
-              { std::memcpy(static_cast<std::byte*>(stagingBuffer.GetMappedMemory()) + imageUpload.bufferOffset, imageUpload.data, imageUpload.size); });
+            ZoneScopedN("Transcode KTX 2 Texture");
+            if (auto result = ktxTexture2_TranscodeBasis(ktx, ktxTranscodeFormat, KTX_TF_HIGH_QUALITY); result != KTX_SUCCESS)
+            {
+              assert(false);
+            }
           }
-          
-          for (const auto& imageUpload : imageUploadInfos)
+          else
           {
-            vkCmdCopyBufferToImage2(commandBuffer, Fvog::detail::Address(VkCopyBufferToImageInfo2{
-              .sType = VK_STRUCTURE_TYPE_COPY_BUFFER_TO_IMAGE_INFO_2,
-              .srcBuffer = stagingBuffer.Handle(),
-              .dstImage = loadedImages[imageUpload.imageIndex].Image(),
-              .dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-              .regionCount = 1,
-              .pRegions = Fvog::detail::Address(VkBufferImageCopy2{
-                .sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2,
-                .bufferOffset = imageUpload.bufferOffset,
-                .bufferRowLength = 0,
-                .bufferImageHeight = 0,
-                .imageSubresource = VkImageSubresourceLayers{
-                  .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                  .mipLevel = imageUpload.level,
-                  .layerCount = 1,
-                },
-                .imageExtent = {imageUpload.extent.width, imageUpload.extent.height, imageUpload.extent.depth},
-              }),
-            }));
+            // Use the format that the image is already in
+            imageData.format = Fvog::detail::VkToFormat(static_cast<VkFormat>(ktx->vkFormat));
           }
-        });
-      };
-
-      // Create image objects
-      for (const auto& image : rawImageData)
-      {
-        VkExtent2D dims = {static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height)};
-        auto name = image.name.empty() ? "Loaded Material" : image.name;
-        constexpr auto usage = Fvog::TextureUsage::READ_ONLY;
-
-        // Upload KTX2 compressed image
-        if (image.isKtx)
-        {
-          ZoneScopedN("Upload BCn Image");
-          auto* ktx = image.ktx.get();
-
-          auto textureData = Fvog::CreateTexture2DMip(dims, image.formatIfKtx, ktx->numLevels, usage, name);
 
           for (uint32_t level = 0; level < ktx->numLevels; level++)
           {
             size_t offset{};
             ktxTexture_GetImageOffset(ktxTexture(ktx), level, 0, 0, &offset);
 
-            uint32_t width = std::max(dims.width >> level, 1u);
-            uint32_t height = std::max(dims.height >> level, 1u);
-
-            // Update compressed image
-            const auto size = ImageToBufferSize(textureData.GetCreateInfo().format, textureData.GetCreateInfo().extent);
-
-            imageUploadInfos.emplace_back(ImageUploadInfo {
-              .imageIndex   = loadedImages.size(),
-              .level        = level,
-              .extent       = {width, height, 1},
-              .data         = ktx->pData + offset,
-              .bufferOffset = currentBufferOffset,
-              .size         = size,
-            });
-
-            currentBufferOffset += size;
+            const auto extent = Fvog::Extent3D{std::max(ktx->baseWidth >> level, 1u), std::max(ktx->baseHeight >> level, 1u), 1};
+            const auto size   = ImageToBufferSize(imageData.format, extent);
+            imageData.levels.emplace_back(extent, std::span(reinterpret_cast<const std::byte*>(ktx->pData) + offset, size));
           }
 
-          loadedImages.emplace_back(std::move(textureData));
+          imageData.storage = std::move(ktxStorage);
         }
-        else // Upload raw image data and generate mipmap
-        {
-          ZoneScopedN("Upload 8-BPP Image");
-          assert(image.components == 4);
-          assert(image.pixel_type == GL_UNSIGNED_BYTE);
-          assert(image.bits == 8);
-
-          // TODO: use R8G8_UNORM for normal maps
-          auto textureData = Fvog::CreateTexture2DMip(dims,
-                                                      Fvog::Format::R8G8B8A8_UNORM,
-                                                      //uint32_t(1 + floor(log2(glm::max(dims.width, dims.height)))),
-                                                      1,
-                                                      usage,
-                                                      name);
-
-          // Update uncompressed image
-          // TODO: generate mipmaps
-          //textureData.GenMipmaps();
-
-          const auto size = ImageToBufferSize(textureData.GetCreateInfo().format, textureData.GetCreateInfo().extent);
-
-          imageUploadInfos.emplace_back(ImageUploadInfo{
-            .imageIndex   = loadedImages.size(),
-            .level        = 0,
-            .extent       = {dims.width, dims.height, 1},
-            .data         = image.data.get(),
-            .bufferOffset = currentBufferOffset,
-            .size         = size,
-          });
-
-          currentBufferOffset += size;
+      }
+      else
+      {
+        ZoneScopedN("Decode JPEG/PNG");
+        const auto compression          = GetImageCompression(usage);
+        imageData.format                = compression.format;
+        imageData.metallicRoughnessInRg = compression.moveGbToRg;
 
-          loadedImages.emplace_back(std::move(textureData));
+        // Compressing is far slower than decoding, so the result is cached on disk
+        if (!LoadCachedImage(imageData.contentHash, imageData))
+        {
+          DecodeAndCompressImage(rawImage.encodedPixelData, compression, imageData);
+          StoreCachedImage(imageData.contentHash, imageData);
         }
+      }
 
-        // The most recently-created image needs a barrier.
-        imagesToBarrier.emplace_back(&loadedImages.back());
-
-        // Flush upload after batch size is exceeded
-        if (currentBufferOffset >= BATCH_SIZE)
-        {
-          flushImageUploads();
-
-          imageUploadInfos.clear();
-
-          // Reset offset for next batch.
-          currentBufferOffset = 0;
-        }
-      }
-
-      if (!imageUploadInfos.empty())
-      {
-        flushImageUploads();
-      }
-
-      // Transition every loaded image to READ_ONLY
-      Fvog::GetDevice().ImmediateSubmit(
-        [&](VkCommandBuffer commandBuffer)
-        {
-          auto ctx = Fvog::Context(commandBuffer);
-          for (auto& loadedImage : loadedImages)
-          {
-            ctx.ImageBarrier(loadedImage, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL);
-          }
-        });
-
-      // Free CPU pixel data in parallel for better performance. Omitting this block will only affect perf.
-      {
-        ZoneScopedN("Free CPU pixel data");
-        ZoneTextF("Count: %llu", rawImageData.size());
-        std::for_each(std::execution::par,
-         rawImageData.begin(),
-         rawImageData.end(),
-          [](RawImageData& rawImage)
-          {
-            ZoneScopedN("Free image data");
-            if (!rawImage.name.empty())
-            {
-              ZoneTextF("Name: %s", rawImage.name.c_str());
-            }
-            else
-            {
-              ZoneTextF("%s", "Unnamed");
-            }
-            rawImage.data.reset();
-            rawImage.ktx.reset();
-            rawImage.encodedPixelData.reset();
-          });
-      }
-
-      return loadedImages;
-    }
+      ZoneTextF("Dimensions: (%u, %u)", imageData.levels.front().extent.width, imageData.levels.front().extent.height);
+      return imageData;
+    }
 
     glm::mat4 NodeToMat4(const fastgltf::Node& node)
     {
@@ -583,6 +717,68 @@ namespace Utility
       return transform;
     }
 
+    // Reads the per-instance transforms of a node that uses EXT_mesh_gpu_instancing.
+    // Returns an empty vector if the node is not instanced.
+    std::vector<glm::mat4> LoadInstanceTransforms(const fastgltf::Asset& asset, const fastgltf::Node& node)
+    {
+      ZoneScoped;
+      if (node.instancingAttributes.empty())
+      {
+        return {};
+      }
+
+      const auto translationIt = node.findInstancingAttribute("TRANSLATION");
+      const auto rotationIt    = node.findInstancingAttribute("ROTATION");
+      const auto scaleIt       = node.findInstancingAttribute("SCALE");
+      const auto end           = node.instancingAttributes.end();
+
+      // The spec requires every attribute to have the same count
+      const auto instanceCount = asset.accessors[node.instancingAttributes.front().accessorIndex].count;
+      ZoneTextF("Instances: %zu", instanceCount);
+
+      auto translations = std::vector<glm::vec3>(instanceCount, glm::vec3(0));
+      auto rotations    = std::vector<glm::quat>(instanceCount, glm::identity<glm::quat>());
+      auto scales       = std::vector<glm::vec3>(instanceCount, glm::vec3(1));
+
+      if (translationIt != end)
+      {
+        const auto& accessor = asset.accessors[translationIt->accessorIndex];
+        assert(accessor.count == instanceCount);
+        fastgltf::iterateAccessorWithIndex<glm::vec3>(asset, accessor, [&](glm::vec3 translation, std::size_t idx) { translations[idx] = translation; });
+      }
+
+      if (rotationIt != end)
+      {
+        const auto& accessor = asset.accessors[rotationIt->accessorIndex];
+        assert(accessor.count == instanceCount);
+        // glTF stores quaternions as xyzw
+        fastgltf::iterateAccessorWithIndex<glm::vec4>(asset, accessor, [&](glm::vec4 rotation, std::size_t idx) { rotations[idx] = glm::quat{rotation.w, rotation.x, rotation.y, rotation.z}; });
+      }
+
+      if (scaleIt != end)
+      {
+        const auto& accessor = asset.accessors[scaleIt->accessorIndex];
+        assert(accessor.count == instanceCount);
+        fastgltf::iterateAccessorWithIndex<glm::vec3>(asset, accessor, [&](glm::vec3 scale, std::size_t idx) { scales[idx] = scale; });
+      }
+
+      auto instanceIndices = std::vector<size_t>(instanceCount);
+      std::iota(instanceIndices.begin(), instanceIndices.end(), size_t(0));
+
+      auto transforms = std::vector<glm::mat4>(instanceCount);
+      std::transform(std::execution::par,
+        instanceIndices.begin(),
+        instanceIndices.end(),
+        transforms.begin(),
+        [&](size_t i)
+        {
+          // T * R * S
+          return glm::scale(glm::translate(translations[i]) * glm::mat4_cast(rotations[i]), scales[i]);
+        });
+
+      return transforms;
+    }
+
     // TODO: move this hashing stuff into its own header
     template<typename T>
     struct hash;
@@ -609,198 +805,1251 @@ namespace Utility
     {
       static void apply(size_t& seed, const Tuple& tuple)
       {
-        hash_combine(seed, std::get<0>(tuple));
+        hash_combine(seed, std::get<0>(tuple));
+      }
+    };
+
+    template<typename... TT>
+    struct hash<std::tuple<TT...>>
+    {
+      size_t operator()(const std::tuple<TT...>& tt) const
+      {
+        size_t seed = 0;
+        HashValueImpl<std::tuple<TT...>>::apply(seed, tt);
+        return seed;
+      }
+    };
+
+    struct AccessorIndices
+    {
+      std::optional<std::size_t> positionsIndex;
+      std::optional<std::size_t> normalsIndex;
+      std::optional<std::size_t> texcoordsIndex;
+      std::optional<std::size_t> indicesIndex;
+
+      auto operator<=>(const AccessorIndices&) const = default;
+    };
+    
+    struct HashAccessorIndices
+    {
+      std::size_t operator()(const AccessorIndices& v) const
+      {
+        auto tup = std::make_tuple(v.positionsIndex, v.normalsIndex, v.texcoordsIndex, v.indicesIndex);
+        return hash<decltype(tup)>{}(tup);
+      }
+    };
+
+    // The bytes of an accessor's elements, for accessors that can be read in place
+    struct AccessorView
+    {
+      const std::byte* data;
+      size_t stride;
+    };
+
+    // Returns nullopt for accessors that must go through fastgltf (sparse or not resident in memory).
+    // Meshopt-compressed views have already been decoded by ParseGltf.
+    std::optional<AccessorView> GetAccessorView(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor)
+    {
+      if (accessor.sparse.has_value() || !accessor.bufferViewIndex.has_value())
+      {
+        return std::nullopt;
+      }
+
+      const auto& bufferView = asset.bufferViews[*accessor.bufferViewIndex];
+      const auto* array      = std::get_if<fastgltf::sources::Array>(&asset.buffers[bufferView.bufferIndex].data);
+      if (!array)
+      {
+        return std::nullopt;
+      }
+
+      const auto elementSize = fastgltf::getElementByteSize(accessor.type, accessor.componentType);
+      const auto stride      = bufferView.byteStride.has_value() ? *bufferView.byteStride : elementSize;
+      const auto offset      = bufferView.byteOffset + accessor.byteOffset;
+      if (accessor.count > 0 && offset + (accessor.count - 1) * stride + elementSize > array->bytes.size())
+      {
+        return std::nullopt;
+      }
+
+      return AccessorView{array->bytes.data() + offset, stride};
+    }
+
+    // Hashes the values of an accessor's elements, along with the properties needed to interpret them.
+    // Only the accessor's own elements are hashed, so the key doesn't depend on other data sharing its view, or on how the view interleaves or pads them.
+    // Returns nullopt for accessors whose data isn't directly addressable (sparse or not resident in memory).
+    std::optional<uint64_t> HashAccessor(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, uint64_t seed)
+    {
+      if (accessor.sparse.has_value() || !accessor.bufferViewIndex.has_value())
+      {
+        return std::nullopt;
+      }
+
+      const auto properties = std::array<uint64_t, 4>{
+        static_cast<uint64_t>(accessor.type),
+        static_cast<uint64_t>(accessor.componentType),
+        accessor.count,
+        accessor.normalized,
+      };
+      auto hash = AssetCache::Hash(std::as_bytes(std::span(properties)), seed);
+
+      // Meshopt streams can only be decoded as a whole, so the compressed view is hashed along with where the accessor sits in it.
+      // The view itself refers to the decoded data by now.
+      const auto& bufferView = asset.bufferViews[*accessor.bufferViewIndex];
+      if (const auto& compressed = bufferView.meshoptCompression)
+      {
+        const auto* array = std::get_if<fastgltf::sources::Array>(&asset.buffers[compressed->bufferIndex].data);
+        if (!array || compressed->byteOffset + compressed->byteLength > array->bytes.size())
+        {
+          return std::nullopt;
+        }
+        const auto compression = std::array<uint64_t, 6>{
+          static_cast<uint64_t>(compressed->mode),
+          static_cast<uint64_t>(compressed->filter),
+          compressed->byteStride,
+          compressed->count,
+          accessor.byteOffset,
+          bufferView.byteStride.has_value() ? *bufferView.byteStride : 0,
+        };
+        return AssetCache::Hash(std::span(array->bytes.data() + compressed->byteOffset, compressed->byteLength),
+          AssetCache::Hash(std::as_bytes(std::span(compression)), hash));
+      }
+
+      const auto view = GetAccessorView(asset, accessor);
+      if (!view)
+      {
+        return std::nullopt;
+      }
+
+      // Elements are hashed in fixed-size chunks so that tightly packed and strided accessors with the same values get the same hash.
+      // Tightly packed chunks are hashed in place, and strided ones are gathered first.
+      const auto elementSize      = fastgltf::getElementByteSize(accessor.type, accessor.componentType);
+      const auto elementsPerChunk = std::max<size_t>(size_t(64) * 1024 / elementSize, 1);
+      auto gathered               = std::vector<std::byte>(view->stride == elementSize ? 0 : std::min(accessor.count, elementsPerChunk) * elementSize);
+      for (size_t first = 0; first < accessor.count; first += elementsPerChunk)
+      {
+        const auto count = std::min(elementsPerChunk, accessor.count - first);
+        if (view->stride == elementSize)
+        {
+          hash = AssetCache::Hash(std::span(view->data + first * elementSize, count * elementSize), hash);
+          continue;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+          std::memcpy(gathered.data() + i * elementSize, view->data + (first + i) * view->stride, elementSize);
+        }
+        hash = AssetCache::Hash(std::span(gathered.data(), count * elementSize), hash);
+      }
+
+      return hash;
+    }
+
+    // Bump this whenever the contents or layout of MeshGeometry (or the way it's built) changes.
+    constexpr uint32_t meshGeometryCacheVersion = 7;
+    constexpr uint32_t meshGeometryCacheMagic   = 0x48534D46; // "FMSH"
+    constexpr std::string_view meshGeometryCacheCategory = "meshlets";
+
+    struct MeshGeometryCacheHeader
+    {
+      uint32_t magic;
+      uint32_t version;
+      uint64_t meshletCount;
+      uint64_t vertexCount;
+      uint64_t texcoordCount;
+      uint64_t remappedIndexCount;
+      uint64_t primitiveCount;
+      uint64_t originalIndexCount;
+      Render::VertexDequantization dequantization;
+    };
+
+    // The key covers the source vertex and index data as well as every parameter that affects meshlet generation.
+    std::optional<uint64_t> MakeMeshGeometryCacheKey(const fastgltf::Asset& asset, const AccessorIndices& accessorIndices, bool optimizeVertexOrder)
+    {
+      ZoneScoped;
+      struct BuildParameters
+      {
+        uint32_t version;
+        uint32_t maxIndices;
+        uint32_t maxPrimitives;
+        float coneWeight;
+        uint32_t hasTexcoords;
+        uint32_t lodGroupSize;
+        uint32_t maxLodLevels;
+        uint32_t optimizeVertexOrder;
+      };
+
+      const auto parameters = BuildParameters{
+        .version             = meshGeometryCacheVersion,
+        .maxIndices          = maxMeshletIndices,
+        .maxPrimitives       = maxMeshletPrimitives,
+        .coneWeight          = meshletConeWeight,
+        .hasTexcoords        = accessorIndices.texcoordsIndex.has_value(),
+        .lodGroupSize        = meshletLodGroupSize,
+        .maxLodLevels        = maxMeshletLodLevels,
+        .optimizeVertexOrder = optimizeVertexOrder,
+      };
+
+      std::optional<uint64_t> key = AssetCache::HashValue(parameters);
+      for (auto accessorIndex : {accessorIndices.positionsIndex, accessorIndices.normalsIndex, accessorIndices.texcoordsIndex, accessorIndices.indicesIndex})
+      {
+        if (key && accessorIndex)
+        {
+          key = HashAccessor(asset, asset.accessors[*accessorIndex], *key);
+        }
+      }
+
+      return key;
+    }
+
+    // All arrays of the returned geometry allocate from memory
+    MeshGeometry MakeMeshGeometry(std::pmr::memory_resource* memory)
+    {
+      return MeshGeometry{
+        .meshlets        = std::pmr::vector<Render::Meshlet>(memory),
+        .positions       = std::pmr::vector<Render::QuantizedPosition>(memory),
+        .attributes      = std::pmr::vector<Render::VertexAttributes>(memory),
+        .texcoords       = std::pmr::vector<glm::vec2>(memory),
+        .remappedIndices = std::pmr::vector<Render::index_t>(memory),
+        .primitives      = std::pmr::vector<Render::primitive_t>(memory),
+        .originalIndices = std::pmr::vector<Render::index_t>(memory),
+        .dequantization  = {},
+      };
+    }
+
+    std::optional<MeshGeometry> LoadCachedMeshGeometry(uint64_t key, std::pmr::memory_resource* memory)
+    {
+      ZoneScoped;
+      auto reader = AssetCache::EntryReader(meshGeometryCacheCategory, key);
+      if (!reader.IsOpen())
+      {
+        return std::nullopt;
+      }
+
+      auto header = MeshGeometryCacheHeader{};
+      if (!reader.ReadSection(std::span<MeshGeometryCacheHeader>(&header, 1)) || header.magic != meshGeometryCacheMagic ||
+          header.version != meshGeometryCacheVersion)
+      {
+        reader.Discard();
+        return std::nullopt;
+      }
+
+      // The counts come from disk, so make sure the arrays they describe actually fit in the entry before allocating them.
+      // Each count is checked on its own first so that the sum can't overflow.
+      const auto remainingBytes = reader.RemainingBytes();
+      const auto fits           = [remainingBytes](uint64_t count, uint64_t elementSize) { return count <= remainingBytes / elementSize; };
+      if (!fits(header.meshletCount, sizeof(Render::Meshlet)) ||
+          !fits(header.vertexCount, sizeof(Render::QuantizedPosition) + sizeof(Render::VertexAttributes)) ||
+          !fits(header.texcoordCount, sizeof(glm::vec2)) || (header.texcoordCount != 0 && header.texcoordCount != header.vertexCount) ||
+          !fits(header.remappedIndexCount, sizeof(Render::index_t)) ||
+          !fits(header.primitiveCount, sizeof(Render::primitive_t)) ||
+          !fits(header.originalIndexCount, sizeof(Render::index_t)) ||
+          header.meshletCount * sizeof(Render::Meshlet) + header.vertexCount * (sizeof(Render::QuantizedPosition) + sizeof(Render::VertexAttributes)) +
+              header.texcoordCount * sizeof(glm::vec2) +
+              header.remappedIndexCount * sizeof(Render::index_t) + header.primitiveCount * sizeof(Render::primitive_t) +
+              header.originalIndexCount * sizeof(Render::index_t) > remainingBytes)
+      {
+        reader.Discard();
+        return std::nullopt;
+      }
+
+      // Read straight into the final arrays
+      auto geometry = MakeMeshGeometry(memory);
+      geometry.contentHash    = key;
+      geometry.dequantization = header.dequantization;
+      geometry.meshlets.resize(header.meshletCount);
+      geometry.positions.resize(header.vertexCount);
+      geometry.attributes.resize(header.vertexCount);
+      geometry.texcoords.resize(header.texcoordCount);
+      geometry.remappedIndices.resize(header.remappedIndexCount);
+      geometry.primitives.resize(header.primitiveCount);
+      geometry.originalIndices.resize(header.originalIndexCount);
+
+      if (!reader.ReadSection(std::span(geometry.meshlets)) ||
+          !reader.ReadSection(std::span(geometry.positions)) ||
+          !reader.ReadSection(std::span(geometry.attributes)) ||
+          !reader.ReadSection(std::span(geometry.texcoords)) ||
+          !reader.ReadSection(std::span(geometry.remappedIndices)) ||
+          !reader.ReadSection(std::span(geometry.primitives)) ||
+          !reader.ReadSection(std::span(geometry.originalIndices)) ||
+          !reader.AtEnd())
+      {
+        reader.Discard();
+        return std::nullopt;
+      }
+
+      return geometry;
+    }
+
+    // Used to identify geometry whose source data couldn't be hashed
+    uint64_t HashMeshGeometry(const MeshGeometry& geometry)
+    {
+      ZoneScoped;
+      auto hash = AssetCache::HashValue(geometry.dequantization);
+      hash      = AssetCache::Hash(std::as_bytes(std::span(geometry.meshlets)), hash);
+      hash      = AssetCache::Hash(std::as_bytes(std::span(geometry.positions)), hash);
+      hash      = AssetCache::Hash(std::as_bytes(std::span(geometry.attributes)), hash);
+      hash      = AssetCache::Hash(std::as_bytes(std::span(geometry.texcoords)), hash);
+      hash      = AssetCache::Hash(std::as_bytes(std::span(geometry.remappedIndices)), hash);
+      hash      = AssetCache::Hash(std::as_bytes(std::span(geometry.primitives)), hash);
+      return AssetCache::Hash(std::as_bytes(std::span(geometry.originalIndices)), hash);
+    }
+
+    void StoreCachedMeshGeometry(uint64_t key, const MeshGeometry& geometry)
+    {
+      ZoneScoped;
+      const auto header = MeshGeometryCacheHeader{
+        .magic              = meshGeometryCacheMagic,
+        .version            = meshGeometryCacheVersion,
+        .meshletCount       = geometry.meshlets.size(),
+        .vertexCount        = geometry.positions.size(),
+        .texcoordCount      = geometry.texcoords.size(),
+        .remappedIndexCount = geometry.remappedIndices.size(),
+        .primitiveCount     = geometry.primitives.size(),
+        .originalIndexCount = geometry.originalIndices.size(),
+        .dequantization     = geometry.dequantization,
+      };
+
+      const std::span<const std::byte> sections[] = {
+        std::as_bytes(std::span(&header, 1)),
+        std::as_bytes(std::span(geometry.meshlets)),
+        std::as_bytes(std::span(geometry.positions)),
+        std::as_bytes(std::span(geometry.attributes)),
+        std::as_bytes(std::span(geometry.texcoords)),
+        std::as_bytes(std::span(geometry.remappedIndices)),
+        std::as_bytes(std::span(geometry.primitives)),
+        std::as_bytes(std::span(geometry.originalIndices)),
+      };
+
+      AssetCache::WriteEntry(meshGeometryCacheCategory, key, sections);
+    }
+
+    // Texcoords spanning more than this many texture repeats are kept at full precision, since unorm16 steps over the range would
+    // become coarser than a quarter texel of a 1024x1024 texture and tiled textures would visibly swim.
+    constexpr float maxQuantizedTexcoordExtent = 16.0f;
+
+    // Positions are quantized relative to the bounds of the mesh, and texcoords relative to their range.
+    // Positions use a uniform scale so that the dequantization transform can be folded into the model matrix without affecting normals.
+    // Every mesh gets its own grid, so meshes that share a seam can end up with slightly different positions along it (see Render::QuantizedPosition).
+    void QuantizeVertices(std::span<const Render::Vertex> vertices, MeshGeometry& geometry)
+    {
+      ZoneScoped;
+      auto positionMin = glm::vec3(std::numeric_limits<float>::max());
+      auto positionMax = glm::vec3(std::numeric_limits<float>::lowest());
+      auto texcoordMin = glm::vec2(std::numeric_limits<float>::max());
+      auto texcoordMax = glm::vec2(std::numeric_limits<float>::lowest());
+      for (const auto& vertex : vertices)
+      {
+        positionMin = glm::min(positionMin, vertex.position);
+        positionMax = glm::max(positionMax, vertex.position);
+        texcoordMin = glm::min(texcoordMin, vertex.texcoord);
+        texcoordMax = glm::max(texcoordMax, vertex.texcoord);
+      }
+
+      auto& dequantization = geometry.dequantization;
+      if (!vertices.empty())
+      {
+        const auto halfExtent = (positionMax - positionMin) / 2.0f;
+        const auto maxExtent  = std::max({halfExtent.x, halfExtent.y, halfExtent.z});
+        const auto texcoordExtent = texcoordMax - texcoordMin;
+
+        // Degenerate ranges keep a scale of one so that the dequantization transform stays invertible
+        dequantization.positionOffset = (positionMin + positionMax) / 2.0f;
+        dequantization.positionScale  = maxExtent > 0 ? maxExtent : 1.0f;
+        dequantization.texcoordOffset = texcoordMin;
+        dequantization.texcoordScale  = glm::vec2(texcoordExtent.x > 0 ? texcoordExtent.x : 1.0f, texcoordExtent.y > 0 ? texcoordExtent.y : 1.0f);
+
+        if (std::max(texcoordExtent.x, texcoordExtent.y) > maxQuantizedTexcoordExtent)
+        {
+          dequantization.texcoordOffset = {};
+          dequantization.texcoordScale  = glm::vec2(1);
+          geometry.texcoords.resize(vertices.size());
+          for (size_t i = 0; i < vertices.size(); i++)
+          {
+            geometry.texcoords[i] = vertices[i].texcoord;
+          }
+        }
+      }
+
+      const auto quantizeTexcoords = geometry.texcoords.empty();
+      geometry.positions.resize(vertices.size());
+      geometry.attributes.resize(vertices.size());
+      for (size_t i = 0; i < vertices.size(); i++)
+      {
+        const auto& vertex = vertices[i];
+        const auto position = glm::round(glm::clamp((vertex.position - dequantization.positionOffset) / dequantization.positionScale, -1.0f, 1.0f) * 32767.0f);
+        geometry.positions[i] = {int16_t(position.x), int16_t(position.y), int16_t(position.z), 0};
+        geometry.attributes[i] = {
+          .normal   = vertex.normal,
+          .texcoord = quantizeTexcoords ? glm::packUnorm2x16((vertex.texcoord - dequantization.texcoordOffset) / dequantization.texcoordScale) : 0u,
+        };
+      }
+    }
+
+    glm::vec3 DecodePosition(const Render::QuantizedPosition& position)
+    {
+      return glm::vec3(position.x, position.y, position.z) / 32767.0f;
+    }
+
+    struct MeshletLod
+    {
+      glm::vec4 bounds{}; // xyz: center, w: radius
+      float error = 0;
+      glm::vec4 parentBounds{};
+      float parentError = std::numeric_limits<float>::max();
+    };
+
+    // Returns the smallest sphere enclosing both spheres
+    glm::vec4 MergeSpheres(glm::vec4 a, glm::vec4 b)
+    {
+      const auto offset   = glm::vec3(b) - glm::vec3(a);
+      const auto distance = glm::length(offset);
+      if (distance + b.w <= a.w)
+      {
+        return a;
+      }
+      if (distance + a.w <= b.w)
+      {
+        return b;
+      }
+      const auto radius = (distance + a.w + b.w) / 2.0f;
+      return glm::vec4(glm::vec3(a) + offset * ((radius - a.w) / distance), radius);
+    }
+
+    // Interleaves the bits of a position in [0, 1]^3 with 10 bits per axis, so that sorting by the result orders positions along a Z-order curve
+    uint32_t MortonCode(glm::vec3 position)
+    {
+      auto SpreadBits = [](uint32_t x)
+      {
+        x &= 0x3FF;
+        x = (x | (x << 16)) & 0x030000FF;
+        x = (x | (x << 8)) & 0x0300F00F;
+        x = (x | (x << 4)) & 0x030C30C3;
+        x = (x | (x << 2)) & 0x09249249;
+        return x;
+      };
+
+      const auto cell = glm::uvec3(glm::clamp(position, 0.0f, 1.0f) * 1023.0f);
+      return SpreadBits(cell.x) | (SpreadBits(cell.y) << 1) | (SpreadBits(cell.z) << 2);
+    }
+
+    // Orders meshlets along a Z-order curve through their centers so that consecutive meshlets tend to be adjacent
+    void SortMeshletsSpatially(std::span<size_t> meshletIndices, std::span<const MeshletLod> lods, std::pmr::memory_resource* scratch)
+    {
+      auto min = glm::vec3(std::numeric_limits<float>::max());
+      auto max = glm::vec3(std::numeric_limits<float>::lowest());
+      for (auto index : meshletIndices)
+      {
+        min = glm::min(min, glm::vec3(lods[index].bounds));
+        max = glm::max(max, glm::vec3(lods[index].bounds));
+      }
+
+      const auto extent = glm::max(max - min, glm::vec3(std::numeric_limits<float>::min()));
+      auto keys = std::pmr::vector<std::pair<uint32_t, size_t>>(scratch);
+      keys.reserve(meshletIndices.size());
+      for (auto index : meshletIndices)
+      {
+        keys.emplace_back(MortonCode((glm::vec3(lods[index].bounds) - min) / extent), index);
+      }
+
+      std::ranges::sort(keys);
+      for (size_t i = 0; i < keys.size(); i++)
+      {
+        meshletIndices[i] = keys[i].second;
+      }
+    }
+
+    // Meshes with at least this many triangles are split into chunks of this many triangles whose meshlets are built in parallel
+    constexpr size_t meshletChunkTriangles = size_t(1) << 16;
+
+    // Levels with at least this many groups have their groups simplified in parallel
+    constexpr size_t minParallelLodGroups = 64;
+
+    // Per-meshlet work is parallelized for meshes with at least this many meshlets
+    constexpr size_t minParallelMeshlets = 1024;
+
+    // Builds meshlets out of the triangles of indices. The arrays are resized to fit exactly.
+    // Large meshes are sorted into spatially coherent chunks of triangles whose meshlets are built in parallel, then stitched together.
+    // Only the meshlets on chunk boundaries are affected, which may be slightly less full than if the mesh were built as a whole.
+    void BuildMeshlets(std::span<const Render::Vertex> vertices,
+      std::span<const Render::index_t> indices,
+      std::pmr::vector<meshopt_Meshlet>& meshlets,
+      std::pmr::vector<Render::index_t>& meshletVertices,
+      std::pmr::vector<Render::primitive_t>& meshletPrimitives,
+      std::pmr::memory_resource* scratch)
+    {
+      ZoneScopedN("Build Meshlets");
+      const auto triangleCount = indices.size() / 3;
+
+      if (triangleCount < meshletChunkTriangles * 2)
+      {
+        const auto maxMeshlets = meshopt_buildMeshletsBound(indices.size(), maxMeshletIndices, maxMeshletPrimitives);
+        meshlets.resize(maxMeshlets);
+        meshletVertices.resize(maxMeshlets * maxMeshletIndices);
+        meshletPrimitives.resize(maxMeshlets * maxMeshletPrimitives * 3);
+
+        meshlets.resize(meshopt_buildMeshlets(meshlets.data(),
+          meshletVertices.data(),
+          meshletPrimitives.data(),
+          indices.data(),
+          indices.size(),
+          reinterpret_cast<const float*>(vertices.data()),
+          vertices.size(),
+          sizeof(Render::Vertex),
+          maxMeshletIndices,
+          maxMeshletPrimitives,
+          meshletConeWeight));
+
+        // Faster, but generates less efficient meshlets. Requires OptimizeVertexOrder() to have been run.
+        //meshlets.resize(meshopt_buildMeshletsScan(meshlets.data(),
+        //  meshletVertices.data(),
+        //  meshletPrimitives.data(),
+        //  indices.data(),
+        //  indices.size(),
+        //  vertices.size(),
+        //  maxMeshletIndices,
+        //  maxMeshletPrimitives));
+
+        const auto& lastMeshlet = meshlets.back();
+        meshletVertices.resize(lastMeshlet.vertex_offset + lastMeshlet.vertex_count);
+        meshletPrimitives.resize(lastMeshlet.triangle_offset + ((lastMeshlet.triangle_count * 3 + 3) & ~3));
+        return;
+      }
+
+      // Sort triangles along a Z-order curve through their centroids. Ties keep their original order, so the vertex cache order is preserved within each cell.
+      auto keys = std::pmr::vector<std::pair<uint32_t, uint32_t>>(triangleCount, scratch);
+      {
+        ZoneScopedN("Partition triangles");
+        const auto bounds = std::transform_reduce(std::execution::par,
+          vertices.begin(),
+          vertices.end(),
+          std::pair(glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest())),
+          [](const auto& a, const auto& b) { return std::pair(glm::min(a.first, b.first), glm::max(a.second, b.second)); },
+          [](const Render::Vertex& vertex) { return std::pair(vertex.position, vertex.position); });
+        const auto min    = bounds.first;
+        const auto extent = glm::max(bounds.second - min, glm::vec3(std::numeric_limits<float>::min()));
+
+        ForEachIndex(triangleCount, true, scratch, [&](size_t triangle)
+        {
+          const auto centroid = (vertices[indices[triangle * 3 + 0]].position + vertices[indices[triangle * 3 + 1]].position + vertices[indices[triangle * 3 + 2]].position) / 3.0f;
+          keys[triangle]      = {MortonCode((centroid - min) / extent), uint32_t(triangle)};
+        });
+        std::sort(std::execution::par, keys.begin(), keys.end());
+      }
+
+      const auto chunkCount = (triangleCount + meshletChunkTriangles - 1) / meshletChunkTriangles;
+
+      // Chunks are built into their own regions, sized by the worst case, so that they can be built without synchronizing
+      struct Chunk
+      {
+        size_t firstMeshlet;
+        size_t meshletCount;
+        size_t vertexCount;
+        size_t primitiveCount;
+      };
+      auto chunks = std::pmr::vector<Chunk>(chunkCount, scratch);
+      auto maxChunkMeshlets = size_t(0);
+      for (size_t i = 0; i < chunkCount; i++)
+      {
+        const auto chunkTriangles = std::min(meshletChunkTriangles, triangleCount - i * meshletChunkTriangles);
+        chunks[i].firstMeshlet    = maxChunkMeshlets;
+        maxChunkMeshlets += meshopt_buildMeshletsBound(chunkTriangles * 3, maxMeshletIndices, maxMeshletPrimitives);
+      }
+
+      auto chunkMeshlets   = std::pmr::vector<meshopt_Meshlet>(maxChunkMeshlets, scratch);
+      auto chunkVertices   = std::pmr::vector<Render::index_t>(maxChunkMeshlets * maxMeshletIndices, scratch);
+      auto chunkPrimitives = std::pmr::vector<Render::primitive_t>(maxChunkMeshlets * maxMeshletPrimitives * 3, scratch);
+
+      ForEachIndex(chunkCount, true, scratch, [&](size_t chunkIndex)
+      {
+        ZoneScopedN("Build Meshlets For Chunk");
+        auto taskScratch = ScratchArena();
+        auto& chunk      = chunks[chunkIndex];
+
+        // Meshoptimizer's cost scales with the number of vertices it's given, so each chunk only gets the vertices it uses
+        const auto firstTriangle = chunkIndex * meshletChunkTriangles;
+        const auto chunkKeys     = std::span(keys).subspan(firstTriangle, std::min(meshletChunkTriangles, triangleCount - firstTriangle));
+        auto localIndices        = std::pmr::vector<uint32_t>(taskScratch.Get());
+        localIndices.reserve(chunkKeys.size() * 3);
+        for (const auto& chunkKey : chunkKeys)
+        {
+          const auto firstIndex = size_t(chunkKey.second) * 3;
+          localIndices.insert(localIndices.end(), indices.begin() + firstIndex, indices.begin() + firstIndex + 3);
+        }
+
+        auto localToGlobal = std::pmr::vector<uint32_t>(localIndices, taskScratch.Get());
+        std::ranges::sort(localToGlobal);
+        localToGlobal.erase(std::unique(localToGlobal.begin(), localToGlobal.end()), localToGlobal.end());
+        auto localPositions = std::pmr::vector<glm::vec3>(localToGlobal.size(), taskScratch.Get());
+        for (size_t i = 0; i < localToGlobal.size(); i++)
+        {
+          localPositions[i] = vertices[localToGlobal[i]].position;
+        }
+        for (auto& index : localIndices)
+        {
+          index = uint32_t(std::ranges::lower_bound(localToGlobal, index) - localToGlobal.begin());
+        }
+
+        auto* meshletsOut = &chunkMeshlets[chunk.firstMeshlet];
+        auto* verticesOut = &chunkVertices[chunk.firstMeshlet * maxMeshletIndices];
+        chunk.meshletCount = meshopt_buildMeshlets(meshletsOut,
+          verticesOut,
+          &chunkPrimitives[chunk.firstMeshlet * maxMeshletPrimitives * 3],
+          localIndices.data(),
+          localIndices.size(),
+          &localPositions[0].x,
+          localPositions.size(),
+          sizeof(glm::vec3),
+          maxMeshletIndices,
+          maxMeshletPrimitives,
+          meshletConeWeight);
+
+        const auto& lastMeshlet = meshletsOut[chunk.meshletCount - 1];
+        chunk.vertexCount       = lastMeshlet.vertex_offset + lastMeshlet.vertex_count;
+        chunk.primitiveCount    = lastMeshlet.triangle_offset + ((lastMeshlet.triangle_count * 3 + 3) & ~3);
+        for (size_t i = 0; i < chunk.vertexCount; i++)
+        {
+          verticesOut[i] = localToGlobal[verticesOut[i]];
+        }
+      });
+
+      // Stitch the chunks together, in order so that the result doesn't depend on scheduling
+      struct ChunkOutput
+      {
+        size_t meshletOffset;
+        size_t vertexOffset;
+        size_t primitiveOffset;
+      };
+      auto outputs = std::pmr::vector<ChunkOutput>(chunkCount, scratch);
+      auto total   = ChunkOutput{};
+      for (size_t i = 0; i < chunkCount; i++)
+      {
+        outputs[i] = total;
+        total.meshletOffset += chunks[i].meshletCount;
+        total.vertexOffset += chunks[i].vertexCount;
+        total.primitiveOffset += chunks[i].primitiveCount;
+      }
+
+      meshlets.resize(total.meshletOffset);
+      meshletVertices.resize(total.vertexOffset);
+      meshletPrimitives.resize(total.primitiveOffset);
+
+      ForEachIndex(chunkCount, true, scratch, [&](size_t chunkIndex)
+      {
+        const auto& chunk  = chunks[chunkIndex];
+        const auto& output = outputs[chunkIndex];
+        for (size_t i = 0; i < chunk.meshletCount; i++)
+        {
+          auto meshlet = chunkMeshlets[chunk.firstMeshlet + i];
+          meshlet.vertex_offset += uint32_t(output.vertexOffset);
+          meshlet.triangle_offset += uint32_t(output.primitiveOffset);
+          meshlets[output.meshletOffset + i] = meshlet;
+        }
+
+        std::copy_n(chunkVertices.begin() + chunk.firstMeshlet * maxMeshletIndices, chunk.vertexCount, meshletVertices.begin() + output.vertexOffset);
+        std::copy_n(chunkPrimitives.begin() + chunk.firstMeshlet * maxMeshletPrimitives * 3, chunk.primitiveCount, meshletPrimitives.begin() + output.primitiveOffset);
+      });
+    }
+
+    // The next level of detail made from one group of meshlets
+    struct LodGroup
+    {
+      glm::vec4 bounds{};
+      float error = 0;
+      // Empty if the group couldn't be simplified enough. Vertices of the new meshlets are indices into the mesh's vertices.
+      std::span<meshopt_Meshlet> meshlets;
+      std::span<uint32_t> vertices;
+      std::span<uint8_t> primitives;
+    };
+
+    [[nodiscard]] size_t GetLodGroupIndexCount(std::span<const size_t> group, std::span<const meshopt_Meshlet> meshlets)
+    {
+      return std::transform_reduce(group.begin(), group.end(), size_t(0), std::plus{}, [&](size_t meshletIndex) { return meshlets[meshletIndex].triangle_count * 3; });
+    }
+
+    // Merges and simplifies a group of meshlets, then splits the result into new meshlets. Temporaries are allocated from scratch.
+    // The new meshlets are written to storage, whose spans must be large enough for meshopt_buildMeshletsBound() of the group's indices.
+    // The spans of the returned group are a prefix of those in storage.
+    LodGroup SimplifyLodGroup(std::span<const Render::Vertex> vertices,
+      std::span<const size_t> group,
+      std::span<const meshopt_Meshlet> meshlets,
+      std::span<const Render::index_t> meshletVertices,
+      std::span<const Render::primitive_t> meshletPrimitives,
+      std::span<const MeshletLod> lods,
+      const LodGroup& storage,
+      std::pmr::memory_resource* scratch)
+    {
+      // Gather the triangles of the group and compact their vertices, so that meshoptimizer only has to consider the vertices in this group
+      auto indices = std::pmr::vector<uint32_t>(scratch);
+      indices.reserve(GetLodGroupIndexCount(group, meshlets));
+      for (auto meshletIndex : group)
+      {
+        const auto meshlet = meshlets[meshletIndex];
+        for (uint32_t i = 0; i < meshlet.triangle_count * 3; i++)
+        {
+          indices.emplace_back(meshletVertices[meshlet.vertex_offset + meshletPrimitives[meshlet.triangle_offset + i]]);
+        }
+      }
+
+      auto localToGlobal = std::pmr::vector<uint32_t>(indices, scratch);
+      std::ranges::sort(localToGlobal);
+      localToGlobal.erase(std::unique(localToGlobal.begin(), localToGlobal.end()), localToGlobal.end());
+      auto localPositions = std::pmr::vector<glm::vec3>(localToGlobal.size(), scratch);
+      for (size_t i = 0; i < localToGlobal.size(); i++)
+      {
+        localPositions[i] = vertices[localToGlobal[i]].position;
+      }
+      for (auto& index : indices)
+      {
+        index = uint32_t(std::ranges::lower_bound(localToGlobal, index) - localToGlobal.begin());
+      }
+
+      auto simplified    = std::pmr::vector<uint32_t>(indices.size(), scratch);
+      auto relativeError = 0.0f;
+      simplified.resize(meshopt_simplify(simplified.data(),
+        indices.data(),
+        indices.size(),
+        &localPositions[0].x,
+        localPositions.size(),
+        sizeof(glm::vec3),
+        indices.size() / 6 * 3,
+        1.0f,
+        meshopt_SimplifyLockBorder,
+        &relativeError));
+
+      // Locked boundaries can prevent meaningful simplification. Such groups are retried with different neighbors in the next level.
+      if (simplified.empty() || simplified.size() > indices.size() * 85 / 100)
+      {
+        return {};
+      }
+
+      auto result   = LodGroup{};
+      result.bounds = lods[group.front()].bounds;
+      result.error  = relativeError * meshopt_simplifyScale(&localPositions[0].x, localPositions.size(), sizeof(glm::vec3));
+      for (auto meshletIndex : group)
+      {
+        result.bounds = MergeSpheres(result.bounds, lods[meshletIndex].bounds);
+        result.error  = std::max(result.error, lods[meshletIndex].error);
+      }
+
+      // Simplification never adds indices, so this fits in storage
+      const auto maxNewMeshlets = meshopt_buildMeshletsBound(simplified.size(), maxMeshletIndices, maxMeshletPrimitives);
+      assert(storage.meshlets.size() >= maxNewMeshlets);
+      assert(storage.vertices.size() >= maxNewMeshlets * maxMeshletIndices);
+      assert(storage.primitives.size() >= maxNewMeshlets * maxMeshletPrimitives * 3);
+      result.meshlets = storage.meshlets.first(meshopt_buildMeshlets(storage.meshlets.data(),
+        storage.vertices.data(),
+        storage.primitives.data(),
+        simplified.data(),
+        simplified.size(),
+        &localPositions[0].x,
+        localPositions.size(),
+        sizeof(glm::vec3),
+        maxMeshletIndices,
+        maxMeshletPrimitives,
+        meshletConeWeight));
+
+      const auto& lastMeshlet = result.meshlets.back();
+      result.vertices         = storage.vertices.first(lastMeshlet.vertex_offset + lastMeshlet.vertex_count);
+      result.primitives       = storage.primitives.first(lastMeshlet.triangle_offset + lastMeshlet.triangle_count * 3);
+      for (auto& vertex : result.vertices)
+      {
+        vertex = localToGlobal[vertex];
+      }
+      return result;
+    }
+
+    // Builds coarser levels of detail on top of the full-detail meshlets. New meshlets are appended to the existing arrays and refer to the same vertices.
+    // Each level is made by merging groups of adjacent meshlets, simplifying them with their outer boundary locked (so that neighboring groups still line up),
+    // then splitting the result into meshlets again. Every meshlet made from a group shares the group's bounds and error, which become the parent LOD of the
+    // group's meshlets. Errors never decrease towards the root, so a cut through the hierarchy can be selected by testing each meshlet independently.
+    // Groups are independent, so large levels are simplified in parallel. Their results are appended in order, so the output doesn't depend on scheduling.
+    // Every temporary, including the returned LODs, is allocated from scratch.
+    std::pmr::vector<MeshletLod> BuildMeshletLods(std::span<const Render::Vertex> vertices,
+      std::pmr::vector<meshopt_Meshlet>& meshlets,
+      std::pmr::vector<Render::index_t>& meshletVertices,
+      std::pmr::vector<Render::primitive_t>& meshletPrimitives,
+      std::pmr::memory_resource* scratch)
+    {
+      ZoneScoped;
+      auto lods = std::pmr::vector<MeshletLod>(meshlets.size(), scratch);
+      ForEachIndex(meshlets.size(), meshlets.size() >= minParallelMeshlets, scratch, [&](size_t i)
+      {
+        const auto& meshlet = meshlets[i];
+        const auto bounds   = meshopt_computeMeshletBounds(&meshletVertices[meshlet.vertex_offset],
+          &meshletPrimitives[meshlet.triangle_offset],
+          meshlet.triangle_count,
+          reinterpret_cast<const float*>(vertices.data()),
+          vertices.size(),
+          sizeof(Render::Vertex));
+        lods[i].bounds = glm::vec4(bounds.center[0], bounds.center[1], bounds.center[2], bounds.radius);
+      });
+
+      auto level = std::pmr::vector<size_t>(meshlets.size(), scratch);
+      std::iota(level.begin(), level.end(), size_t(0));
+
+      for (uint32_t depth = 0; depth < maxMeshletLodLevels && level.size() > 1; depth++)
+      {
+        ZoneScopedN("Build LOD Level");
+        SortMeshletsSpatially(level, lods, scratch);
+
+        const auto groupCount = (level.size() + meshletLodGroupSize - 1) / meshletLodGroupSize;
+        const auto parallel   = groupCount >= minParallelLodGroups;
+        auto groups           = std::pmr::vector<LodGroup>(groupCount, scratch);
+        auto GetGroup         = [&](size_t groupIndex)
+        {
+          const auto groupStart = groupIndex * meshletLodGroupSize;
+          return std::span<const size_t>(level).subspan(groupStart, std::min<size_t>(meshletLodGroupSize, level.size() - groupStart));
+        };
+
+        // The new meshlets of every group are written to their own slice of these arrays, which outlive the tasks that simplify the groups
+        auto groupMeshletStarts = std::pmr::vector<size_t>(groupCount + 1, scratch);
+        for (size_t groupIndex = 0; groupIndex < groupCount; groupIndex++)
+        {
+          const auto maxGroupMeshlets = meshopt_buildMeshletsBound(GetLodGroupIndexCount(GetGroup(groupIndex), meshlets), maxMeshletIndices, maxMeshletPrimitives);
+          groupMeshletStarts[groupIndex + 1] = groupMeshletStarts[groupIndex] + maxGroupMeshlets;
+        }
+        auto levelMeshlets   = std::pmr::vector<meshopt_Meshlet>(groupMeshletStarts.back(), scratch);
+        auto levelVertices   = std::pmr::vector<uint32_t>(groupMeshletStarts.back() * maxMeshletIndices, scratch);
+        auto levelPrimitives = std::pmr::vector<uint8_t>(groupMeshletStarts.back() * maxMeshletPrimitives * 3, scratch);
+        auto GetGroupStorage = [&](size_t groupIndex)
+        {
+          const auto first = groupMeshletStarts[groupIndex];
+          const auto count = groupMeshletStarts[groupIndex + 1] - first;
+          return LodGroup{
+            .meshlets   = std::span(levelMeshlets).subspan(first, count),
+            .vertices   = std::span(levelVertices).subspan(first * maxMeshletIndices, count * maxMeshletIndices),
+            .primitives = std::span(levelPrimitives).subspan(first * maxMeshletPrimitives * 3, count * maxMeshletPrimitives * 3),
+          };
+        };
+
+        ForEachIndex(groupCount, parallel, scratch, [&](size_t groupIndex)
+        {
+          const auto storage = GetGroupStorage(groupIndex);
+          if (parallel)
+          {
+            auto taskScratch   = ScratchArena();
+            groups[groupIndex] = SimplifyLodGroup(vertices, GetGroup(groupIndex), meshlets, meshletVertices, meshletPrimitives, lods, storage, taskScratch.Get());
+          }
+          else
+          {
+            groups[groupIndex] = SimplifyLodGroup(vertices, GetGroup(groupIndex), meshlets, meshletVertices, meshletPrimitives, lods, storage, scratch);
+          }
+        });
+
+        auto nextLevel     = std::pmr::vector<size_t>(scratch);
+        bool anySimplified = false;
+        for (size_t groupIndex = 0; groupIndex < groupCount; groupIndex++)
+        {
+          const auto group = GetGroup(groupIndex);
+          const auto& lod  = groups[groupIndex];
+          if (lod.meshlets.empty())
+          {
+            nextLevel.insert(nextLevel.end(), group.begin(), group.end());
+            continue;
+          }
+          anySimplified = true;
+
+          for (auto meshletIndex : group)
+          {
+            lods[meshletIndex].parentBounds = lod.bounds;
+            lods[meshletIndex].parentError  = lod.error;
+          }
+
+          for (const auto& newMeshlet : lod.meshlets)
+          {
+            meshlets.emplace_back(meshopt_Meshlet{
+              .vertex_offset   = uint32_t(meshletVertices.size()),
+              .triangle_offset = uint32_t(meshletPrimitives.size()),
+              .vertex_count    = newMeshlet.vertex_count,
+              .triangle_count  = newMeshlet.triangle_count,
+            });
+            const auto* newVertices = &lod.vertices[newMeshlet.vertex_offset];
+            meshletVertices.insert(meshletVertices.end(), newVertices, newVertices + newMeshlet.vertex_count);
+
+            // Keep primitives 4-byte aligned, like meshopt_buildMeshlets does
+            const auto* primitives = &lod.primitives[newMeshlet.triangle_offset];
+            meshletPrimitives.insert(meshletPrimitives.end(), primitives, primitives + newMeshlet.triangle_count * 3);
+            meshletPrimitives.resize((meshletPrimitives.size() + 3) & ~size_t(3));
+
+            lods.emplace_back(MeshletLod{.bounds = lod.bounds, .error = lod.error});
+            nextLevel.emplace_back(meshlets.size() - 1);
+          }
+        }
+
+        if (!anySimplified)
+        {
+          break;
+        }
+
+        level = std::move(nextLevel);
+      }
+
+      return lods;
+    }
+
+    // Converts one component to float. Normalized integers are mapped to [-1, 1] or [0, 1] as the glTF spec (and KHR_mesh_quantization) requires.
+    template<typename T>
+    float DecodeComponent(const std::byte* src, bool normalized)
+    {
+      T value;
+      std::memcpy(&value, src, sizeof(T));
+      if constexpr (std::is_floating_point_v<T>)
+      {
+        return value;
+      }
+      else
+      {
+        if (!normalized)
+        {
+          return static_cast<float>(value);
+        }
+        if constexpr (std::is_signed_v<T>)
+        {
+          return std::max(static_cast<float>(value) / static_cast<float>(std::numeric_limits<T>::max()), -1.0f);
+        }
+        return static_cast<float>(value) / static_cast<float>(std::numeric_limits<T>::max());
+      }
+    }
+
+    template<typename T, glm::length_t N, typename F>
+    void DecodeElements(AccessorView view, size_t first, size_t count, bool normalized, F&& store)
+    {
+      for (size_t i = first; i < first + count; i++)
+      {
+        const auto* element = view.data + i * view.stride;
+        auto value          = glm::vec<N, float>();
+        for (glm::length_t c = 0; c < N; c++)
+        {
+          value[c] = DecodeComponent<T>(element + size_t(c) * sizeof(T), normalized);
+        }
+        store(value, i);
+      }
+    }
+
+    // Calls store(value, index) for the elements in [first, first + count) of an accessor that can be read in place.
+    // Returns false if the accessor doesn't have N components of a type that is valid for vertex attributes.
+    template<glm::length_t N, typename F>
+    bool DecodeAccessorView(const fastgltf::Accessor& accessor, AccessorView view, size_t first, size_t count, F&& store)
+    {
+      if (fastgltf::getNumComponents(accessor.type) != static_cast<size_t>(N))
+      {
+        return false;
+      }
+
+      const auto normalized = accessor.normalized;
+      switch (accessor.componentType)
+      {
+      case fastgltf::ComponentType::Float: DecodeElements<float, N>(view, first, count, normalized, store); return true;
+      case fastgltf::ComponentType::Byte: DecodeElements<int8_t, N>(view, first, count, normalized, store); return true;
+      case fastgltf::ComponentType::UnsignedByte: DecodeElements<uint8_t, N>(view, first, count, normalized, store); return true;
+      case fastgltf::ComponentType::Short: DecodeElements<int16_t, N>(view, first, count, normalized, store); return true;
+      case fastgltf::ComponentType::UnsignedShort: DecodeElements<uint16_t, N>(view, first, count, normalized, store); return true;
+      default: return false;
+      }
+    }
+
+    // Calls store(value, index) for every element of an accessor, reading it in place when possible
+    template<glm::length_t N, typename F>
+    void DecodeAccessor(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, F&& store)
+    {
+      if (const auto view = GetAccessorView(asset, accessor); view && DecodeAccessorView<N>(accessor, *view, 0, accessor.count, store))
+      {
+        return;
+      }
+      fastgltf::iterateAccessorWithIndex<glm::vec<N, float>>(asset, accessor, store);
+    }
+
+    // Normals are decoded and encoded in blocks that fit in L1, so they never exist in full as floats
+    constexpr size_t normalBlockSize = 256;
+
+    // Does the same as glm::packSnorm2x16(Math::Vec3ToOct(normal)) for each normal, four at a time where SSE2 is available.
+    // Components are separate (SoA) so that they can be loaded straight into vector registers.
+    void EncodeOctahedralNormals(const float* x, const float* y, const float* z, size_t count, Render::Vertex* dst)
+    {
+      size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+      const auto one      = _mm_set1_ps(1.0f);
+      const auto minusOne = _mm_set1_ps(-1.0f);
+      const auto zero     = _mm_setzero_ps();
+      const auto half     = _mm_set1_ps(0.5f);
+      const auto absMask  = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+      const auto signMask = _mm_castsi128_ps(_mm_set1_epi32(int32_t(0x80000000)));
+
+      auto Select     = [](__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); };
+      auto SignNotZero = [&](__m128 v) { return Select(_mm_cmpge_ps(v, zero), one, minusOne); };
+
+      // Rounds half away from zero like std::round. Truncating, then stepping away from zero if the remainder is at least one half, is exact.
+      auto PackSnorm16 = [&](__m128 v)
+      {
+        const auto scaled    = _mm_mul_ps(_mm_min_ps(_mm_max_ps(v, minusOne), one), _mm_set1_ps(32767.0f));
+        const auto truncated = _mm_cvttps_epi32(scaled);
+        const auto remainder = _mm_sub_ps(scaled, _mm_cvtepi32_ps(truncated));
+        const auto roundAway = _mm_cmpge_ps(_mm_and_ps(remainder, absMask), half);
+        const auto step      = _mm_or_ps(_mm_and_ps(scaled, signMask), one); // +-1 with the sign of scaled
+        return _mm_add_epi32(truncated, _mm_cvttps_epi32(_mm_and_ps(roundAway, step)));
+      };
+
+      for (; i + 4 <= count; i += 4)
+      {
+        const auto vx  = _mm_loadu_ps(x + i);
+        const auto vy  = _mm_loadu_ps(y + i);
+        const auto vz  = _mm_loadu_ps(z + i);
+        const auto l1  = _mm_add_ps(_mm_add_ps(_mm_and_ps(vx, absMask), _mm_and_ps(vy, absMask)), _mm_and_ps(vz, absMask));
+        const auto inv = _mm_div_ps(one, l1);
+        const auto px  = _mm_mul_ps(vx, inv);
+        const auto py  = _mm_mul_ps(vy, inv);
+
+        // Fold the lower hemisphere over the diagonals
+        const auto lower = _mm_cmple_ps(vz, zero);
+        const auto ox    = Select(lower, _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(py, absMask)), SignNotZero(px)), px);
+        const auto oy    = Select(lower, _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(px, absMask)), SignNotZero(py)), py);
+
+        // x goes in the low half, like glm::packSnorm2x16
+        const auto packed = _mm_or_si128(_mm_and_si128(PackSnorm16(ox), _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(PackSnorm16(oy), 16));
+
+        alignas(16) uint32_t normals[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(normals), packed);
+        for (size_t j = 0; j < 4; j++)
+        {
+          dst[i + j].normal = normals[j];
+        }
+      }
+#endif
+
+      for (; i < count; i++)
+      {
+        dst[i].normal = glm::packSnorm2x16(Math::Vec3ToOct({x[i], y[i], z[i]}));
+      }
+    }
+
+    // Decodes every EXT_meshopt_compression buffer view into one new buffer owned by the asset, and points the views at their decoded data.
+    // Views are decoded in parallel. Their meshoptCompression is kept to describe the source data, which is cheaper to hash.
+    // Returns false if any view couldn't be decoded.
+    bool DecodeMeshoptBufferViews(fastgltf::Asset& asset)
+    {
+      ZoneScoped;
+      auto compressedViews = std::vector<size_t>();
+      auto decodedOffsets  = std::vector<size_t>();
+      auto decodedSize     = size_t(0);
+      for (size_t i = 0; i < asset.bufferViews.size(); i++)
+      {
+        if (const auto& compressed = asset.bufferViews[i].meshoptCompression)
+        {
+          compressedViews.emplace_back(i);
+          decodedOffsets.emplace_back(decodedSize);
+          // Keep every view 4-byte aligned, as accessors require
+          decodedSize += (compressed->count * compressed->byteStride + 3) & ~size_t(3);
+        }
+      }
+
+      if (compressedViews.empty())
+      {
+        return true;
       }
-    };
+      ZoneTextF("Views: %llu, decoded bytes: %llu", static_cast<unsigned long long>(compressedViews.size()), static_cast<unsigned long long>(decodedSize));
 
-    template<typename... TT>
-    struct hash<std::tuple<TT...>>
-    {
-      size_t operator()(const std::tuple<TT...>& tt) const
+      auto decoded = fastgltf::StaticVector<std::byte>(decodedSize);
+      auto failed  = std::atomic_bool(false);
+
+      auto indices = std::vector<size_t>(compressedViews.size());
+      std::iota(indices.begin(), indices.end(), size_t(0));
+      std::for_each(std::execution::par,
+        indices.begin(),
+        indices.end(),
+        [&](size_t i)
+        {
+          ZoneScopedN("Decode Buffer View");
+          const auto& compressed = *asset.bufferViews[compressedViews[i]].meshoptCompression;
+          const auto* source     = std::get_if<fastgltf::sources::Array>(&asset.buffers[compressed.bufferIndex].data);
+          if (!source || compressed.byteOffset + compressed.byteLength > source->bytes.size())
+          {
+            failed = true;
+            return;
+          }
+
+          const auto* src = reinterpret_cast<const unsigned char*>(source->bytes.data() + compressed.byteOffset);
+          auto* dst       = decoded.data() + decodedOffsets[i];
+          auto result     = -1;
+          switch (compressed.mode)
+          {
+          case fastgltf::MeshoptCompressionMode::Attributes:
+            result = meshopt_decodeVertexBuffer(dst, compressed.count, compressed.byteStride, src, compressed.byteLength);
+            break;
+          case fastgltf::MeshoptCompressionMode::Triangles:
+            result = meshopt_decodeIndexBuffer(dst, compressed.count, compressed.byteStride, src, compressed.byteLength);
+            break;
+          case fastgltf::MeshoptCompressionMode::Indices:
+            result = meshopt_decodeIndexSequence(dst, compressed.count, compressed.byteStride, src, compressed.byteLength);
+            break;
+          }
+
+          if (result != 0)
+          {
+            failed = true;
+            return;
+          }
+
+          switch (compressed.filter)
+          {
+          case fastgltf::MeshoptCompressionFilter::None: break;
+          case fastgltf::MeshoptCompressionFilter::Octahedral: meshopt_decodeFilterOct(dst, compressed.count, compressed.byteStride); break;
+          case fastgltf::MeshoptCompressionFilter::Quaternion: meshopt_decodeFilterQuat(dst, compressed.count, compressed.byteStride); break;
+          case fastgltf::MeshoptCompressionFilter::Exponential: meshopt_decodeFilterExp(dst, compressed.count, compressed.byteStride); break;
+          }
+        });
+
+      if (failed)
       {
-        size_t seed = 0;
-        HashValueImpl<std::tuple<TT...>>::apply(seed, tt);
-        return seed;
+        return false;
       }
-    };
 
-    struct AccessorIndices
-    {
-      std::optional<std::size_t> positionsIndex;
-      std::optional<std::size_t> normalsIndex;
-      std::optional<std::size_t> texcoordsIndex;
-      std::optional<std::size_t> indicesIndex;
+      const auto decodedBufferIndex = asset.buffers.size();
+      auto& decodedBuffer           = asset.buffers.emplace_back();
+      decodedBuffer.byteLength      = decodedSize;
+      decodedBuffer.data            = fastgltf::sources::Array{.bytes = std::move(decoded)};
 
-      auto operator<=>(const AccessorIndices&) const = default;
-    };
-    
-    struct HashAccessorIndices
-    {
-      std::size_t operator()(const AccessorIndices& v) const
+      for (size_t i = 0; i < compressedViews.size(); i++)
       {
-        auto tup = std::make_tuple(v.positionsIndex, v.normalsIndex, v.texcoordsIndex, v.indicesIndex);
-        return hash<decltype(tup)>{}(tup);
+        auto& bufferView      = asset.bufferViews[compressedViews[i]];
+        const auto& compressed = *bufferView.meshoptCompression;
+        bufferView.bufferIndex = decodedBufferIndex;
+        bufferView.byteOffset  = decodedOffsets[i];
+        bufferView.byteLength  = compressed.count * compressed.byteStride;
+        if (compressed.mode == fastgltf::MeshoptCompressionMode::Attributes)
+        {
+          bufferView.byteStride = compressed.byteStride;
+        }
       }
-    };
+
+      return true;
+    }
   } // namespace
 
+  // Attributes are decoded straight into the interleaved vertices, and normals are encoded as they are decoded, so no per-attribute arrays are made.
   std::pmr::vector<Render::Vertex> ConvertVertexBufferFormat(const fastgltf::Asset& model,
                                                 std::size_t positionAccessorIndex,
                                                 std::size_t normalAccessorIndex,
-                                                std::optional<std::size_t> texcoordAccessorIndex)
+                                                std::optional<std::size_t> texcoordAccessorIndex,
+                                                std::pmr::memory_resource* memory)
   {
     ZoneScoped;
-    std::vector<glm::vec3> positions;
     auto& positionAccessor = model.accessors[positionAccessorIndex];
-    positions.resize(positionAccessor.count);
-    fastgltf::iterateAccessorWithIndex<glm::vec3>(model, positionAccessor, [&](glm::vec3 position, std::size_t idx) { positions[idx] = position; });
+    auto& normalAccessor   = model.accessors[normalAccessorIndex];
 
-    std::vector<glm::vec3> normals;
-    auto& normalAccessor = model.accessors[normalAccessorIndex];
-    normals.resize(normalAccessor.count);
-    fastgltf::iterateAccessorWithIndex<glm::vec3>(model, normalAccessor, [&](glm::vec3 normal, std::size_t idx) { normals[idx] = normal; });
+    // Textureless meshes will use factors instead of textures. Without a texcoord attribute, texcoords are left zeroed to keep everything consistent and happy.
+    std::pmr::vector<Render::Vertex> vertices(positionAccessor.count, memory);
+    assert(normalAccessor.count == vertices.size());
 
-    std::vector<glm::vec2> texcoords;
+    DecodeAccessor<3>(model, positionAccessor, [&](glm::vec3 position, std::size_t idx) { vertices[idx].position = position; });
 
-    // Textureless meshes will use factors instead of textures
     if (texcoordAccessorIndex.has_value())
     {
       auto& texcoordAccessor = model.accessors[texcoordAccessorIndex.value()];
-      texcoords.resize(texcoordAccessor.count);
-      fastgltf::iterateAccessorWithIndex<glm::vec2>(model, texcoordAccessor, [&](glm::vec2 texcoord, std::size_t idx) { texcoords[idx] = texcoord; });
+      assert(texcoordAccessor.count == vertices.size());
+      DecodeAccessor<2>(model, texcoordAccessor, [&](glm::vec2 texcoord, std::size_t idx) { vertices[idx].texcoord = texcoord; });
     }
-    else
+
+    const auto normalView = GetAccessorView(model, normalAccessor);
+    bool normalsDecoded   = false;
+    if (normalView)
     {
-      // If no texcoord attribute, fill with empty texcoords to keep everything consistent and happy
-      texcoords.resize(positions.size(), {});
+      alignas(16) float x[normalBlockSize];
+      alignas(16) float y[normalBlockSize];
+      alignas(16) float z[normalBlockSize];
+      for (size_t first = 0; first < vertices.size(); first += normalBlockSize)
+      {
+        const auto count = std::min(normalBlockSize, vertices.size() - first);
+        normalsDecoded   = DecodeAccessorView<3>(normalAccessor,
+          *normalView,
+          first,
+          count,
+          [&](glm::vec3 normal, std::size_t idx)
+          {
+            x[idx - first] = normal.x;
+            y[idx - first] = normal.y;
+            z[idx - first] = normal.z;
+          });
+        if (!normalsDecoded)
+        {
+          break;
+        }
+        EncodeOctahedralNormals(x, y, z, count, vertices.data() + first);
+      }
     }
 
-    assert(positions.size() == normals.size() && positions.size() == texcoords.size());
-
-    std::pmr::vector<Render::Vertex> vertices;
-    vertices.resize(positions.size());
-
-    for (size_t i = 0; i < positions.size(); i++)
+    if (!normalsDecoded)
     {
-      vertices[i] = {positions[i], glm::packSnorm2x16(Math::Vec3ToOct(normals[i])), texcoords[i]};
+      std::pmr::vector<float> normals(vertices.size() * 3, memory);
+      fastgltf::iterateAccessorWithIndex<glm::vec3>(model,
+        normalAccessor,
+        [&](glm::vec3 normal, std::size_t idx)
+        {
+          normals[idx]                       = normal.x;
+          normals[vertices.size() + idx]     = normal.y;
+          normals[vertices.size() * 2 + idx] = normal.z;
+        });
+      EncodeOctahedralNormals(normals.data(), normals.data() + vertices.size(), normals.data() + vertices.size() * 2, vertices.size(), vertices.data());
     }
 
     return vertices;
   }
 
-  std::pmr::vector<Render::index_t> ConvertIndexBufferFormat(const fastgltf::Asset& model, std::size_t indicesAccessorIndex)
+  std::pmr::vector<Render::index_t> ConvertIndexBufferFormat(const fastgltf::Asset& model, std::size_t indicesAccessorIndex, std::pmr::memory_resource* memory)
   {
     ZoneScoped;
-    auto indices   = std::pmr::vector<Render::index_t>();
+    auto indices   = std::pmr::vector<Render::index_t>(memory);
     auto& accessor = model.accessors[indicesAccessorIndex];
     indices.resize(accessor.count);
     fastgltf::iterateAccessorWithIndex<Render::index_t>(model, accessor, [&](Render::index_t index, size_t idx) { indices[idx] = index; });
     return indices;
   }
 
-  std::vector<Render::Material> LoadMaterials(const fastgltf::Asset& model, std::span<Fvog::Texture> images)
+  std::vector<MaterialData> LoadMaterials(const fastgltf::Asset& model)
   {
     ZoneScoped;
-    auto LoadSampler = [](const fastgltf::Sampler& sampler)
+    auto GetImageRef = [&](size_t textureIndex, std::string_view defaultName)
     {
-      Fvog::SamplerCreateInfo samplerState{};
-
-      samplerState.addressModeU = ConvertGlAddressMode((GLint)sampler.wrapS);
-      samplerState.addressModeV = ConvertGlAddressMode((GLint)sampler.wrapT);
-      if (sampler.minFilter.has_value())
-      {
-        samplerState.minFilter = ConvertGlFilterMode((GLint)sampler.minFilter.value());
-        samplerState.mipmapMode = GetGlMipmapFilter((GLint)sampler.minFilter.value());
-        samplerState.maxAnisotropy = 16;
-      }
-      if (sampler.magFilter.has_value())
-      {
-        samplerState.magFilter = ConvertGlFilterMode((GLint)sampler.magFilter.value());
-      }
-
-      return samplerState;
+      const auto& texture = model.textures[textureIndex];
+      return MaterialData::ImageRef{
+        .imageIndex = (texture.imageIndex ? texture.imageIndex : texture.basisuImageIndex).value(),
+        .name       = texture.name.empty() ? std::string(defaultName) : std::string(texture.name),
+      };
     };
 
-    std::vector<Render::Material> materials;
+    std::vector<MaterialData> materials;
 
     for (const auto& loaderMaterial : model.materials)
     {
-      Render::Material material;
+      auto material = MaterialData{};
 
       if (loaderMaterial.occlusionTexture.has_value())
       {
         material.gpuMaterial.flags |= Render::MaterialFlagBit::HAS_OCCLUSION_TEXTURE;
-        const auto& occlusionTexture     = model.textures[loaderMaterial.occlusionTexture->textureIndex];
-        auto& image                      = images[(occlusionTexture.imageIndex ? occlusionTexture.imageIndex : occlusionTexture.basisuImageIndex).value()];
-        auto name                        = occlusionTexture.name.empty() ? "Occlusion" : occlusionTexture.name;
-        auto view                        = image.CreateFormatView(image.GetCreateInfo().format, name.c_str());
-        material.occlusionTextureSampler = {
-          std::move(view),
-          // LoadSampler(model.samplers[occlusionTexture.samplerIndex.value()]),
-        };
-
-        material.gpuMaterial.occlusionTextureIndex = material.occlusionTextureSampler->texture.GetSampledResourceHandle().index;
+        material.occlusionTexture = GetImageRef(loaderMaterial.occlusionTexture->textureIndex, "Occlusion");
       }
 
       if (loaderMaterial.emissiveTexture.has_value())
       {
         material.gpuMaterial.flags |= Render::MaterialFlagBit::HAS_EMISSION_TEXTURE;
-        const auto& emissiveTexture     = model.textures[loaderMaterial.emissiveTexture->textureIndex];
-        auto& image                     = images[(emissiveTexture.imageIndex ? emissiveTexture.imageIndex : emissiveTexture.basisuImageIndex).value()];
-        auto name                       = emissiveTexture.name.empty() ? "Emissive" : emissiveTexture.name;
-        auto view                       = image.CreateFormatView(FormatToSrgb(image.GetCreateInfo().format), name.c_str());
-        material.emissiveTextureSampler = {
-          std::move(view),
-          // LoadSampler(model.samplers[emissiveTexture.samplerIndex.value()]),
-        };
-
-        material.gpuMaterial.emissionTextureIndex = material.emissiveTextureSampler->texture.GetSampledResourceHandle().index;
+        material.emissiveTexture = GetImageRef(loaderMaterial.emissiveTexture->textureIndex, "Emissive");
       }
 
       if (loaderMaterial.normalTexture.has_value())
       {
         material.gpuMaterial.flags |= Render::MaterialFlagBit::HAS_NORMAL_TEXTURE;
-        const auto& normalTexture     = model.textures[loaderMaterial.normalTexture->textureIndex];
-        auto& image                   = images[(normalTexture.imageIndex ? normalTexture.imageIndex : normalTexture.basisuImageIndex).value()];
-        auto name                     = normalTexture.name.empty() ? "Normal Map" : normalTexture.name;
-        auto view                     = image.CreateFormatView(image.GetCreateInfo().format, name.c_str());
-        material.normalTextureSampler = {
-          std::move(view),
-          // LoadSampler(model.samplers[normalTexture.samplerIndex.value()]),
-        };
+        material.normalTexture = GetImageRef(loaderMaterial.normalTexture->textureIndex, "Normal Map");
         material.gpuMaterial.normalXyScale = loaderMaterial.normalTexture->scale;
-
-        material.gpuMaterial.normalTextureIndex = material.normalTextureSampler->texture.GetSampledResourceHandle().index;
       }
       
       if (loaderMaterial.pbrData.baseColorTexture.has_value())
       {
         material.gpuMaterial.flags |= Render::MaterialFlagBit::HAS_BASE_COLOR_TEXTURE;
-        const auto& baseColorTexture  = model.textures[loaderMaterial.pbrData.baseColorTexture->textureIndex];
-        auto& image                   = images[(baseColorTexture.imageIndex ? baseColorTexture.imageIndex : baseColorTexture.basisuImageIndex).value()];
-        auto name                     = baseColorTexture.name.empty() ? "Base Color" : baseColorTexture.name;
-        auto view                     = image.CreateFormatView(FormatToSrgb(image.GetCreateInfo().format), name.c_str());
-        material.albedoTextureSampler = {
-          std::move(view),
-          // LoadSampler(model.samplers[baseColorTexture.samplerIndex.value()]),
-        };
-
-        material.gpuMaterial.baseColorTextureIndex = material.albedoTextureSampler->texture.GetSampledResourceHandle().index;
+        material.albedoTexture = GetImageRef(loaderMaterial.pbrData.baseColorTexture->textureIndex, "Base Color");
       }
 
       if (loaderMaterial.pbrData.metallicRoughnessTexture.has_value())
       {
         material.gpuMaterial.flags |= Render::MaterialFlagBit::HAS_METALLIC_ROUGHNESS_TEXTURE;
-        const auto& metallicRoughnessTexture     = model.textures[loaderMaterial.pbrData.metallicRoughnessTexture->textureIndex];
-        auto& image                              = images[(metallicRoughnessTexture.imageIndex ? metallicRoughnessTexture.imageIndex : metallicRoughnessTexture.basisuImageIndex).value()];
-        auto name                                = metallicRoughnessTexture.name.empty() ? "MetallicRoughness" : metallicRoughnessTexture.name;
-        auto view                                = image.CreateFormatView(image.GetCreateInfo().format, name.c_str());
-        material.metallicRoughnessTextureSampler = {
-          std::move(view),
-          // LoadSampler(model.samplers[metallicRoughnessTexture.samplerIndex.value()]),
-        };
-
-        material.gpuMaterial.metallicRoughnessTextureIndex = material.metallicRoughnessTextureSampler->texture.GetSampledResourceHandle().index;
+        material.metallicRoughnessTexture = GetImageRef(loaderMaterial.pbrData.metallicRoughnessTexture->textureIndex, "MetallicRoughness");
       }
 
       material.gpuMaterial.baseColorFactor  = glm::make_vec4(loaderMaterial.pbrData.baseColorFactor.data());
@@ -809,31 +2058,21 @@ namespace Utility
       material.gpuMaterial.emissiveFactor   = glm::make_vec3(loaderMaterial.emissiveFactor.data());
       material.gpuMaterial.alphaCutoff      = loaderMaterial.alphaCutoff;
       material.gpuMaterial.emissiveStrength = loaderMaterial.emissiveStrength;
+      if (loaderMaterial.doubleSided)
+      {
+        material.gpuMaterial.flags |= Render::MaterialFlagBit::IS_DOUBLE_SIDED;
+      }
       materials.emplace_back(std::move(material));
     }
 
     return materials;
   }
 
-  // Corresponds to a glTF primitive. In other words, it's the mesh data that corresponds to a draw call.
-  struct RawMesh
-  {
-    std::pmr::vector<Render::Vertex> vertices;
-    std::pmr::vector<Render::index_t> indices;
-    Render::Box3D boundingBox;
-  };
-
-  struct LoadModelResult
-  {
-    std::pmr::vector<std::unique_ptr<LoadModelNode>> nodes;
-    std::pmr::vector<RawMesh> rawMeshes;
-    std::pmr::vector<Render::Material> materials;
-    std::vector<Fvog::Texture> images;
-  };
-
-  std::optional<LoadModelResult> LoadModelFromFileBase(std::filesystem::path path, glm::mat4 rootTransform, bool skipMaterials)
+  // Parses the glTF and loads its buffers, but leaves images encoded
+  std::optional<fastgltf::Asset> ParseGltf(const std::filesystem::path& path)
   {
     ZoneScoped;
+    ZoneText(path.string().c_str(), path.string().size());
 
     const auto extension = path.extension();
     const auto isText = extension == ".gltf";
@@ -845,51 +2084,54 @@ namespace Utility
       return std::nullopt;
     }
 
-    auto maybeAsset = [&]() -> fastgltf::Expected<fastgltf::Asset>
+    using fastgltf::Extensions;
+    constexpr auto gltfExtensions = Extensions::KHR_texture_basisu | Extensions::KHR_mesh_quantization | Extensions::EXT_meshopt_compression |
+                                    Extensions::KHR_lights_punctual | Extensions::KHR_materials_emissive_strength |
+                                    Extensions::EXT_mesh_gpu_instancing;
+    auto parser = fastgltf::Parser(gltfExtensions);
+    
+    auto dataBuffer = fastgltf::GltfDataBuffer::FromPath(path);
+    if (dataBuffer.error() != fastgltf::Error::None)
     {
-      ZoneScopedN("Parse glTF");
-      using fastgltf::Extensions;
-      constexpr auto gltfExtensions = Extensions::KHR_texture_basisu | Extensions::KHR_mesh_quantization | Extensions::EXT_meshopt_compression |
-                                      Extensions::KHR_lights_punctual | Extensions::KHR_materials_emissive_strength;
-      auto parser = fastgltf::Parser(gltfExtensions);
-      
-      auto dataBuffer = fastgltf::GltfDataBuffer::FromPath(path);
-      if (dataBuffer.error() != fastgltf::Error::None)
-      {
-        std::cout << "fastgltf: failed to load data buffer. Reason: " << fastgltf::getErrorMessage(dataBuffer.error()) << '\n';
-        return dataBuffer.error();
-      }
-
-      constexpr auto options = fastgltf::Options::LoadExternalBuffers | fastgltf::Options::LoadExternalImages;
-      
-      return parser.loadGltf(dataBuffer.get(), path.parent_path(), options);
-    }();
+      std::cout << "fastgltf: failed to load data buffer. Reason: " << fastgltf::getErrorMessage(dataBuffer.error()) << '\n';
+      return std::nullopt;
+    }
 
+    constexpr auto options = fastgltf::Options::LoadExternalBuffers | fastgltf::Options::LoadExternalImages;
+    
+    auto maybeAsset = parser.loadGltf(dataBuffer.get(), path.parent_path(), options);
     if (maybeAsset.error() != fastgltf::Error::None)
     {
       std::cout << "fastgltf: failed to load glTF. Reason: " << fastgltf::getErrorMessage(maybeAsset.error()) << '\n';
       return std::nullopt;
     }
 
-    const auto& asset = maybeAsset.get();
-
     // Let's not deal with glTFs containing multiple scenes right now
-    assert(asset.scenes.size() == 1);
-
-    // Load images and boofers
-    auto images = std::vector<Fvog::Texture>();
-    auto materials = std::vector<Render::Material>();
-
-    LoadModelResult scene;
+    if (maybeAsset.get().scenes.size() != 1)
+    {
+      std::cout << "Only glTFs with exactly one scene are supported, but " << path << " has " << maybeAsset.get().scenes.size() << '\n';
+      return std::nullopt;
+    }
 
-    if (!skipMaterials)
+    // Everything after this reads accessors through their buffer views, so they must refer to decoded data
+    if (!DecodeMeshoptBufferViews(maybeAsset.get()))
     {
-      images = LoadImages(asset);
-      materials = LoadMaterials(asset, images);
-      std::ranges::move(materials, std::back_inserter(scene.materials));
-      std::ranges::move(images, std::back_inserter(scene.images));
+      std::cout << "Failed to decode EXT_meshopt_compression buffer views in " << path << '\n';
+      return std::nullopt;
     }
-    
+
+    return std::move(maybeAsset.get());
+  }
+
+  // Creates the node hierarchy of the scene in nodes, with the root first.
+  // Returns the accessors of each unique mesh, which LoadModelNode::MeshIndices::meshIndex refers to.
+  std::vector<AccessorIndices> TraverseScene(const fastgltf::Asset& asset,
+    const std::filesystem::path& path,
+    const glm::mat4& rootTransform,
+    bool skipMaterials,
+    std::pmr::vector<std::unique_ptr<LoadModelNode>>& nodes)
+  {
+    ZoneScoped;
     auto uniqueAccessorCombinations = std::unordered_map<AccessorIndices, std::size_t, HashAccessorIndices>();
 
     // <node*, global transform>
@@ -911,14 +2153,14 @@ namespace Utility
     const auto rootRotation = glm::quat{rootRotationArray[3], rootRotationArray[0], rootRotationArray[1], rootRotationArray[2]};
     const auto rootScale = glm::make_vec3(rootScaleArray.data());
 
-    LoadModelNode* rootNode = scene.nodes.emplace_back(std::make_unique<LoadModelNode>(path.stem().string(), rootTranslation, rootRotation, rootScale)).get();
+    LoadModelNode* rootNode = nodes.emplace_back(std::make_unique<LoadModelNode>(path.stem().string(), rootTranslation, rootRotation, rootScale)).get();
 
     // All nodes referenced in the scene MUST be root nodes
     for (auto nodeIndex : asset.scenes[0].nodeIndices)
     {
       const auto& assetNode    = asset.nodes[nodeIndex];
       const auto name          = assetNode.name.empty() ? std::string("Node") : std::string(assetNode.name);
-      LoadModelNode* sceneNode = scene.nodes.emplace_back(std::make_unique<LoadModelNode>(name, rootTranslation, rootRotation, rootScale)).get();
+      LoadModelNode* sceneNode = nodes.emplace_back(std::make_unique<LoadModelNode>(name, rootTranslation, rootRotation, rootScale)).get();
       rootNode->children.emplace_back(sceneNode);
       nodeStack.emplace(sceneNode, &assetNode);
     }
@@ -954,7 +2196,7 @@ namespace Utility
         {
           const auto& assetNode = asset.nodes[childNodeIndex];
           const auto name       = assetNode.name.empty() ? std::string("Node") : std::string(assetNode.name);
-          auto& childSceneNode  = scene.nodes.emplace_back(std::make_unique<LoadModelNode>(name));
+          auto& childSceneNode  = nodes.emplace_back(std::make_unique<LoadModelNode>(name));
           node->children.emplace_back(childSceneNode.get());
           nodeStack.emplace(childSceneNode.get(), &assetNode);
         }
@@ -1025,6 +2267,8 @@ namespace Utility
 
             node->meshes.emplace_back(rawMeshIndex, materialId);
           }
+
+          node->instanceTransforms = LoadInstanceTransforms(asset, *gltfNode);
         }
 
         // Deduplicating lights is not a concern (they are small and quick to decode), so we load them here for convenience.
@@ -1060,156 +2304,429 @@ namespace Utility
       ZoneTextF("Nodes traversed: %llu", count);
     }
 
-    scene.rawMeshes.resize(uniqueAccessorCombinations.size());
-    
-    std::for_each(
-      std::execution::par,
-      uniqueAccessorCombinations.begin(),
-      uniqueAccessorCombinations.end(),
-      [&](const auto& keyValue)
+    auto meshAccessors = std::vector<AccessorIndices>(uniqueAccessorCombinations.size());
+    for (const auto& [accessorIndices, index] : uniqueAccessorCombinations)
+    {
+      meshAccessors[index] = accessorIndices;
+    }
+
+    return meshAccessors;
+  }
+
+  // Corresponds to a glTF primitive. In other words, it's the mesh data that corresponds to a draw call.
+  struct RawMesh
+  {
+    std::pmr::vector<Render::Vertex> vertices;
+    std::pmr::vector<Render::index_t> indices;
+    Render::Box3D boundingBox;
+
+    // Set if the mesh's source data could be hashed
+    std::optional<uint64_t> cacheKey;
+    // Set if meshlets for this mesh were found in the cache, in which case vertices and indices are empty
+    std::optional<MeshGeometry> cachedGeometry;
+  };
+
+  // Vertices and indices are allocated from scratch, while cached geometry is read straight into output
+  RawMesh ConvertRawMesh(const fastgltf::Asset& asset,
+    const AccessorIndices& accessorIndices,
+    bool optimizeVertexOrder,
+    std::pmr::memory_resource* scratch,
+    std::pmr::memory_resource* output)
+  {
+    ZoneScopedN("Convert vertices and indices");
+    auto cacheKey       = MakeMeshGeometryCacheKey(asset, accessorIndices, optimizeVertexOrder);
+    auto cachedGeometry = cacheKey ? LoadCachedMeshGeometry(*cacheKey, output) : std::nullopt;
+
+    auto vertices = std::pmr::vector<Render::Vertex>(scratch);
+    auto indices  = std::pmr::vector<Render::index_t>(scratch);
+    if (!cachedGeometry)
+    {
+      vertices = ConvertVertexBufferFormat(asset, accessorIndices.positionsIndex.value(), accessorIndices.normalsIndex.value(), accessorIndices.texcoordsIndex, scratch);
+      indices  = ConvertIndexBufferFormat(asset, accessorIndices.indicesIndex.value(), scratch);
+    }
+
+    const auto& positionAccessor = asset.accessors[accessorIndices.positionsIndex.value()];
+
+    glm::vec3 bboxMin{};
+    if (auto* dv = std::get_if<std::pmr::vector<double>>(&positionAccessor.min))
+    {
+      bboxMin = {(*dv)[0], (*dv)[1], (*dv)[2]};
+    }
+    if (auto* iv = std::get_if<std::pmr::vector<int64_t>>(&positionAccessor.min))
+    {
+      bboxMin = {(*iv)[0], (*iv)[1], (*iv)[2]};
+    }
+
+    glm::vec3 bboxMax{};
+    if (auto* dv = std::get_if<std::pmr::vector<double>>(&positionAccessor.max))
+    {
+      bboxMax = {(*dv)[0], (*dv)[1], (*dv)[2]};
+    }
+    if (auto* iv = std::get_if<std::pmr::vector<int64_t>>(&positionAccessor.max))
+    {
+      bboxMax = {(*iv)[0], (*iv)[1], (*iv)[2]};
+    }
+
+    return RawMesh{
+      .vertices = std::move(vertices),
+      .indices = std::move(indices),
+      .boundingBox = {.min = bboxMin, .max = bboxMax},
+      .cacheKey = cacheKey,
+      .cachedGeometry = std::move(cachedGeometry),
+    };
+  }
+
+  // Reorders triangles for the post-transform cache and then for overdraw, and finally reorders vertices to match.
+  // Meshlets built from the result reference more local ranges of vertices, and the BLAS gets the same benefit from the original indices.
+  void OptimizeVertexOrder(RawMesh& mesh)
+  {
+    ZoneScoped;
+    constexpr uint32_t cacheSize = 16;
+    const auto before = meshopt_analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), cacheSize, 0, 0);
+
+    meshopt_optimizeVertexCache(mesh.indices.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+
+    // Allow the vertex cache efficiency to get slightly worse if it reduces overdraw
+    constexpr float overdrawThreshold = 1.05f;
+    meshopt_optimizeOverdraw(mesh.indices.data(),
+      mesh.indices.data(),
+      mesh.indices.size(),
+      reinterpret_cast<const float*>(mesh.vertices.data()),
+      mesh.vertices.size(),
+      sizeof(Render::Vertex),
+      overdrawThreshold);
+
+    // Also drops vertices that no triangle references
+    const auto vertexCount = meshopt_optimizeVertexFetch(mesh.vertices.data(),
+      mesh.indices.data(),
+      mesh.indices.size(),
+      mesh.vertices.data(),
+      mesh.vertices.size(),
+      sizeof(Render::Vertex));
+    mesh.vertices.resize(vertexCount);
+
+    const auto after = meshopt_analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), cacheSize, 0, 0);
+    ZoneTextF("ACMR: %.3f -> %.3f", before.acmr, after.acmr);
+    ZoneTextF("ATVR: %.3f -> %.3f", before.atvr, after.atvr);
+  }
+
+  // Temporaries are allocated from scratch. The arrays of the returned geometry are allocated from output with their final sizes,
+  // so no memory is wasted in an arena that can't reuse it.
+  MeshGeometry BuildMeshGeometry(RawMesh& mesh, bool optimizeVertexOrder, std::pmr::memory_resource* scratch, std::pmr::memory_resource* output)
+  {
+    ZoneScopedN("Create meshlets for mesh");
+    if (mesh.cachedGeometry)
+    {
+      ZoneTextF("Cache hit: %016llx", static_cast<unsigned long long>(*mesh.cacheKey));
+      return std::move(*mesh.cachedGeometry);
+    }
+
+    if (optimizeVertexOrder)
+    {
+      OptimizeVertexOrder(mesh);
+    }
+
+    auto meshGeometry = MakeMeshGeometry(output);
+
+    auto rawMeshlets       = std::pmr::vector<meshopt_Meshlet>(scratch);
+    auto meshletVertices   = std::pmr::vector<Render::index_t>(scratch);
+    auto meshletPrimitives = std::pmr::vector<Render::primitive_t>(scratch);
+    BuildMeshlets(mesh.vertices, mesh.indices, rawMeshlets, meshletVertices, meshletPrimitives, scratch);
+
+    const auto lods = BuildMeshletLods(mesh.vertices, rawMeshlets, meshletVertices, meshletPrimitives, scratch);
+
+    // The LODs are done appending, so the final arrays can be allocated once
+    meshGeometry.remappedIndices.assign(meshletVertices.begin(), meshletVertices.end());
+    meshGeometry.primitives.assign(meshletPrimitives.begin(), meshletPrimitives.end());
+    meshGeometry.originalIndices.assign(mesh.indices.begin(), mesh.indices.end());
+    meshGeometry.meshlets.resize(rawMeshlets.size());
+
+    // Meshlets are built from full-precision vertices, but their bounds must enclose the quantized vertices that will actually be rendered
+    QuantizeVertices(mesh.vertices, meshGeometry);
+
+    // LOD bounds and errors are moved into the same space
+    const auto& dequantization = meshGeometry.dequantization;
+    auto QuantizeBounds = [&](glm::vec4 bounds, float (&dst)[4])
+    {
+      const auto center = (glm::vec3(bounds) - dequantization.positionOffset) / dequantization.positionScale;
+      dst[0] = center.x;
+      dst[1] = center.y;
+      dst[2] = center.z;
+      dst[3] = bounds.w / dequantization.positionScale;
+    };
+    auto QuantizeError = [&](float error)
+    {
+      return error == std::numeric_limits<float>::max() ? error : error / dequantization.positionScale;
+    };
+
+    ForEachIndex(rawMeshlets.size(), rawMeshlets.size() >= minParallelMeshlets, scratch, [&](size_t meshletIndex)
+    {
+      const auto& meshlet = rawMeshlets[meshletIndex];
+      const auto& lod     = lods[meshletIndex];
+      auto min = glm::vec3(std::numeric_limits<float>::max());
+      auto max = glm::vec3(std::numeric_limits<float>::lowest());
+      for (uint32_t i = 0; i < meshlet.triangle_count * 3; ++i)
       {
-        ZoneScopedN("Convert vertices and indices");
-        const auto& [accessorIndices, index] = keyValue;
-        auto vertices = ConvertVertexBufferFormat(asset, accessorIndices.positionsIndex.value(), accessorIndices.normalsIndex.value(), accessorIndices.texcoordsIndex);
-        auto indices = ConvertIndexBufferFormat(asset, accessorIndices.indicesIndex.value());
+        const auto position = DecodePosition(meshGeometry.positions[meshGeometry.remappedIndices[meshlet.vertex_offset + meshGeometry.primitives[meshlet.triangle_offset + i]]]);
+        min                 = glm::min(min, position);
+        max                 = glm::max(max, position);
+      }
+      
+      auto& gpuMeshlet = meshGeometry.meshlets[meshletIndex];
+      gpuMeshlet       = Render::Meshlet{
+        .vertexOffset    = 0,
+        .indexOffset     = meshlet.vertex_offset,
+        .primitiveOffset = meshlet.triangle_offset,
+        .indexCount      = meshlet.vertex_count,
+        .primitiveCount  = meshlet.triangle_count,
+        .aabbMin         = {min.x, min.y, min.z},
+        .aabbMax         = {max.x, max.y, max.z},
+        .lodError        = QuantizeError(lod.error),
+        .parentLodError  = QuantizeError(lod.parentError),
+      };
+      QuantizeBounds(lod.bounds, gpuMeshlet.lodBounds);
+      QuantizeBounds(lod.parentBounds, gpuMeshlet.parentLodBounds);
+
+      // The cone axis is unaffected by the uniform scale of the quantization
+      const auto bounds = meshopt_computeMeshletBounds(&meshGeometry.remappedIndices[meshlet.vertex_offset],
+        &meshGeometry.primitives[meshlet.triangle_offset],
+        meshlet.triangle_count,
+        reinterpret_cast<const float*>(mesh.vertices.data()),
+        mesh.vertices.size(),
+        sizeof(Render::Vertex));
+      gpuMeshlet.coneAxisCutoff = uint32_t(uint8_t(bounds.cone_axis_s8[0])) | uint32_t(uint8_t(bounds.cone_axis_s8[1])) << 8 |
+                                  uint32_t(uint8_t(bounds.cone_axis_s8[2])) << 16 | uint32_t(uint8_t(bounds.cone_cutoff_s8)) << 24;
+    });
+
+    if (mesh.cacheKey)
+    {
+      meshGeometry.contentHash = *mesh.cacheKey;
+      StoreCachedMeshGeometry(*mesh.cacheKey, meshGeometry);
+    }
+    else
+    {
+      meshGeometry.contentHash = HashMeshGeometry(meshGeometry);
+    }
 
-        const auto& positionAccessor = asset.accessors[accessorIndices.positionsIndex.value()];
+    return meshGeometry;
+  }
 
-        glm::vec3 bboxMin{};
-        if (auto* dv = std::get_if<std::pmr::vector<double>>(&positionAccessor.min))
-        {
-          bboxMin = {(*dv)[0], (*dv)[1], (*dv)[2]};
-        }
-        if (auto* iv = std::get_if<std::pmr::vector<int64_t>>(&positionAccessor.min))
-        {
-          bboxMin = {(*iv)[0], (*iv)[1], (*iv)[2]};
-        }
+  std::vector<std::optional<LoadModelResultA>> LoadModelsFromFiles(std::span<const LoadModelRequest> requests, LoadModelStats* stats)
+  {
+    ZoneScoped;
+    ZoneTextF("Files: %llu", static_cast<unsigned long long>(requests.size()));
 
-        glm::vec3 bboxMax{};
-        if (auto* dv = std::get_if<std::pmr::vector<double>>(&positionAccessor.max))
+    // Each stage is flattened across every file before it's handed to the parallel algorithms,
+    // so a level made of many small files keeps every core busy just like one big file does.
+    struct LoadingFile
+    {
+      std::optional<fastgltf::Asset> asset;
+      std::vector<ImageUsage> imageUsages;
+      std::vector<AccessorIndices> meshAccessors;
+      // Moved into result.meshGeometries once every mesh is built. MeshGeometry isn't allocator-aware, so assigning into
+      // a preallocated element would copy arrays out of the arena they were built in.
+      std::vector<std::optional<MeshGeometry>> builtGeometries;
+      LoadModelResultA result;
+    };
+
+    const auto parseStart = std::chrono::steady_clock::now();
+
+    auto files       = std::vector<LoadingFile>(requests.size());
+    auto fileIndices = std::vector<size_t>(requests.size());
+    std::iota(fileIndices.begin(), fileIndices.end(), size_t(0));
+
+    std::for_each(std::execution::par,
+      fileIndices.begin(),
+      fileIndices.end(),
+      [&](size_t fileIndex)
+      {
+        auto& file          = files[fileIndex];
+        const auto& request = requests[fileIndex];
+        file.asset          = ParseGltf(request.path);
+        if (!file.asset)
         {
-          bboxMax = {(*dv)[0], (*dv)[1], (*dv)[2]};
+          return;
         }
-        if (auto* iv = std::get_if<std::pmr::vector<int64_t>>(&positionAccessor.max))
+
+        if (!request.skipMaterials)
         {
-          bboxMax = {(*iv)[0], (*iv)[1], (*iv)[2]};
+          file.imageUsages = GetImageUsages(*file.asset);
+          file.result.images.resize(file.asset->images.size());
+          std::ranges::move(LoadMaterials(*file.asset), std::back_inserter(file.result.materials));
         }
 
-        scene.rawMeshes[index] = RawMesh{
-          .vertices = std::move(vertices),
-          .indices = std::move(indices),
-          .boundingBox = {.min = bboxMin, .max = bboxMax},
-        };
+        file.meshAccessors = TraverseScene(*file.asset, request.path, request.rootTransform, request.skipMaterials, file.result.nodes);
+        file.result.rootNodes.emplace_back(file.result.nodes.front().get());
+        file.builtGeometries.resize(file.meshAccessors.size());
+        file.result.geometryArena = std::make_unique<GeometryArena>();
       });
 
-    std::cout << "Loaded glTF: " << path << '\n';
+    const auto decodeBuildStart = std::chrono::steady_clock::now();
 
-    return scene;
-  }
-
-  LoadModelResultA LoadModelFromFile(const std::filesystem::path& fileName, const glm::mat4& rootTransform, bool skipMaterials)
-  {
-    ZoneScoped;
-    ZoneText(fileName.string().c_str(), fileName.string().size());
+    // Images and meshes only depend on their own file's asset, so all of them can be processed at once.
+    // Mesh conversion and meshlet building are fused so the full-precision vertices of each mesh don't outlive its task.
+    struct Task
+    {
+      enum class Kind
+      {
+        DECODE_IMAGE,
+        BUILD_MESH,
+      };
 
-    auto loadedScene = LoadModelFromFileBase(fileName, rootTransform, skipMaterials);
+      Kind kind;
+      size_t fileIndex;
+      size_t index;
+    };
 
-    // Give each mesh a set of "default" meshlet instances.
-    auto meshletInstances     = std::vector<Render::MeshletInstance>(loadedScene->rawMeshes.size());
-    auto loadModelResult      = LoadModelResultA{};
-    loadModelResult.materials = std::move(loadedScene->materials);
-    loadModelResult.images    = std::move(loadedScene->images);
-    loadModelResult.meshGeometries.resize(loadedScene->rawMeshes.size());
+    auto tasks = std::vector<Task>();
+    for (size_t fileIndex = 0; fileIndex < files.size(); fileIndex++)
+    {
+      // Images tend to take the longest, so they are started first
+      for (size_t i = 0; i < files[fileIndex].result.images.size(); i++)
+      {
+        tasks.emplace_back(Task::Kind::DECODE_IMAGE, fileIndex, i);
+      }
+    }
+    for (size_t fileIndex = 0; fileIndex < files.size(); fileIndex++)
+    {
+      for (size_t i = 0; i < files[fileIndex].meshAccessors.size(); i++)
+      {
+        tasks.emplace_back(Task::Kind::BUILD_MESH, fileIndex, i);
+      }
+    }
 
-    auto meshIndices = std::vector<size_t>(loadedScene->rawMeshes.size());
-    std::iota(meshIndices.begin(), meshIndices.end(), 0);
+    // In nanoseconds
+    auto imageDecodeTime = std::atomic<int64_t>(0);
+    auto meshBuildTime   = std::atomic<int64_t>(0);
 
-    std::for_each(
-      std::execution::par,
-      meshIndices.begin(),
-      meshIndices.end(),
-      [&] (size_t meshIdx) -> void
+    std::for_each(std::execution::par,
+      tasks.begin(),
+      tasks.end(),
+      [&](const Task& task)
       {
-        ZoneScopedN("Create meshlets for mesh");
-        auto& mesh = loadedScene->rawMeshes[meshIdx];
+        const auto taskStart = std::chrono::steady_clock::now();
+        auto& file           = files[task.fileIndex];
+        switch (task.kind)
+        {
+        case Task::Kind::DECODE_IMAGE:
+        {
+          auto& image = file.result.images[task.index];
+          image       = DecodeImage(*file.asset, task.index, file.imageUsages[task.index]);
+          if (auto* decodedImages = requests[task.fileIndex].decodedImages)
+          {
+            // Only the pixels move to the queue. The rest is still needed for the materials that refer to this image.
+            decodedImages->Push(task.index, image);
+            image.levels.clear();
+            image.storage.reset();
+          }
+          break;
+        }
+        case Task::Kind::BUILD_MESH:
+        {
+          const auto optimizeVertexOrder = requests[task.fileIndex].optimizeVertexOrder;
+          auto scratch                   = ScratchArena();
+          auto* output                   = file.result.geometryArena->GetThreadArena();
+          auto rawMesh                   = ConvertRawMesh(*file.asset, file.meshAccessors[task.index], optimizeVertexOrder, scratch.Get(), output);
+          file.builtGeometries[task.index].emplace(BuildMeshGeometry(rawMesh, optimizeVertexOrder, scratch.Get(), output));
+          break;
+        }
+        }
 
-        const auto maxMeshlets = meshopt_buildMeshletsBound(mesh.indices.size(), maxMeshletIndices, maxMeshletPrimitives);
+        const auto taskTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - taskStart).count();
+        (task.kind == Task::Kind::DECODE_IMAGE ? imageDecodeTime : meshBuildTime).fetch_add(taskTime, std::memory_order_relaxed);
+      });
 
-        auto meshGeometry = MeshGeometry{};
+    if (stats)
+    {
+      const auto end          = std::chrono::steady_clock::now();
+      stats->parseStage       = decodeBuildStart - parseStart;
+      stats->decodeBuildStage = end - decodeBuildStart;
+      stats->imageDecodeTasks = std::chrono::nanoseconds(imageDecodeTime.load());
+      stats->meshBuildTasks   = std::chrono::nanoseconds(meshBuildTime.load());
+    }
 
-        auto rawMeshlets = std::vector<meshopt_Meshlet>(maxMeshlets);
-        
-        meshGeometry.vertices = std::move(mesh.vertices);
-        meshGeometry.remappedIndices.resize(maxMeshlets * maxMeshletIndices);
-        meshGeometry.primitives.resize(maxMeshlets * maxMeshletPrimitives * 3);
-        
-        const auto meshletCount = [&]
+    auto results = std::vector<std::optional<LoadModelResultA>>(files.size());
+    for (size_t fileIndex = 0; fileIndex < files.size(); fileIndex++)
+    {
+      if (files[fileIndex].asset)
+      {
+        auto& meshGeometries = files[fileIndex].result.meshGeometries;
+        meshGeometries.reserve(files[fileIndex].builtGeometries.size());
+        for (auto& geometry : files[fileIndex].builtGeometries)
         {
-          ZoneScopedN("Build Meshlets");
-          return meshopt_buildMeshlets(rawMeshlets.data(),
-            meshGeometry.remappedIndices.data(),
-            meshGeometry.primitives.data(),
-            mesh.indices.data(),
-            mesh.indices.size(),
-            reinterpret_cast<const float*>(meshGeometry.vertices.data()),
-            meshGeometry.vertices.size(),
-            sizeof(Render::Vertex),
-            maxMeshletIndices,
-            maxMeshletPrimitives,
-            meshletConeWeight);
-
-          // Faster, but generates less efficient meshlets
-          //{
-          //  ZoneScopedN("Optimize Vertex Cache");
-          //  meshopt_optimizeVertexCache(mesh.indices.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
-          //}
-          //return meshopt_buildMeshletsScan(rawMeshlets.data(),
-          //  meshGeometry.indices.data(),
-          //  meshGeometry.primitives.data(),
-          //  mesh.indices.data(),
-          //  mesh.indices.size(),
-          //  meshGeometry.vertices.size(),
-          //  maxMeshletIndices,
-          //  maxMeshletPrimitives);
-        }();
-
-        // TODO: replace with rawMeshlets.back() AFTER moving rawMeshlets.resize() before this
-        const auto& lastMeshlet = rawMeshlets[meshletCount - 1];
-        meshGeometry.remappedIndices.resize(lastMeshlet.vertex_offset + lastMeshlet.vertex_count);
-        meshGeometry.primitives.resize(lastMeshlet.triangle_offset + ((lastMeshlet.triangle_count * 3 + 3) & ~3));
-        rawMeshlets.resize(meshletCount);
-        meshGeometry.meshlets.reserve(meshletCount);
-        meshGeometry.originalIndices = std::move(mesh.indices);
-
-        for (const auto& meshlet : rawMeshlets)
+          meshGeometries.emplace_back(std::move(*geometry));
+        }
+
+        // Where metallic and roughness are stored is only known once the images are decoded
+        auto& result = files[fileIndex].result;
+        for (auto& material : result.materials)
         {
-          auto min = glm::vec3(std::numeric_limits<float>::max());
-          auto max = glm::vec3(std::numeric_limits<float>::lowest());
-          for (uint32_t i = 0; i < meshlet.triangle_count * 3; ++i)
+          if (material.metallicRoughnessTexture && result.images[material.metallicRoughnessTexture->imageIndex].metallicRoughnessInRg)
           {
-            const auto& vertex = meshGeometry.vertices[meshGeometry.remappedIndices[meshlet.vertex_offset + meshGeometry.primitives[meshlet.triangle_offset + i]]];
-            min                = glm::min(min, vertex.position);
-            max                = glm::max(max, vertex.position);
+            material.gpuMaterial.flags |= Render::MaterialFlagBit::METALLIC_ROUGHNESS_IN_RG;
           }
-          
-          meshGeometry.meshlets.emplace_back(Render::Meshlet{
-            .vertexOffset    = 0,
-            .indexOffset     = meshlet.vertex_offset,
-            .primitiveOffset = meshlet.triangle_offset,
-            .indexCount      = meshlet.vertex_count,
-            .primitiveCount  = meshlet.triangle_count,
-            .aabbMin         = {min.x, min.y, min.z},
-            .aabbMax         = {max.x, max.y, max.z},
-          });
         }
 
-        loadModelResult.meshGeometries[meshIdx] = meshGeometry;
-      });
-    
-    loadModelResult.rootNodes.emplace_back(loadedScene->nodes.front().get());
-    loadModelResult.nodes = std::move(loadedScene->nodes);
+        std::cout << "Loaded glTF: " << requests[fileIndex].path << '\n';
+        results[fileIndex] = std::move(files[fileIndex].result);
+      }
+    }
+
+    ScratchArena::ReleaseRetainedBuffers();
+    return results;
+  }
+
+  std::optional<LoadModelResultA> LoadModelFromFile(const std::filesystem::path& fileName,
+    const glm::mat4& rootTransform,
+    bool skipMaterials,
+    DecodedImageQueue* decodedImages)
+  {
+    ZoneScoped;
+    ZoneText(fileName.string().c_str(), fileName.string().size());
+
+    const auto request = LoadModelRequest{.path = fileName, .rootTransform = rootTransform, .skipMaterials = skipMaterials, .decodedImages = decodedImages};
+    auto results       = LoadModelsFromFiles(std::span(&request, 1));
+    return std::move(results.front());
+  }
+
+  size_t ImageData::SizeBytes() const noexcept
+  {
+    return std::transform_reduce(levels.begin(), levels.end(), size_t(0), std::plus{}, [](const Level& level) { return level.data.size(); });
+  }
+
+  void DecodedImageQueue::Push(size_t imageIndex, ImageData image)
+  {
+    auto lock = std::lock_guard(mutex_);
+    entries_.emplace_back(imageIndex, std::move(image));
+  }
+
+  std::vector<DecodedImageQueue::Entry> DecodedImageQueue::TakeAll()
+  {
+    auto lock = std::lock_guard(mutex_);
+    return std::exchange(entries_, {});
+  }
 
-    return loadModelResult;
+  std::pmr::memory_resource* GeometryArena::GetThreadArena()
+  {
+    struct LastArena
+    {
+      uint64_t ownerId = 0;
+      std::pmr::memory_resource* resource = nullptr;
+    };
+    thread_local auto lastArena = LastArena{};
+    if (lastArena.ownerId == id_)
+    {
+      return lastArena.resource;
+    }
+
+    auto lock   = std::lock_guard(mutex_);
+    auto& arena = arenas_[std::this_thread::get_id()];
+    if (!arena)
+    {
+      arena = std::make_unique<std::pmr::monotonic_buffer_resource>(size_t(1) << 20, std::pmr::new_delete_resource());
+    }
+    lastArena = {id_, arena.get()};
+    return arena.get();
   }
 
   glm::mat4 LoadModelNode::CalcLocalTransform() const noexcept
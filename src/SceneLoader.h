@@ -2,11 +2,21 @@
 #include "Renderables.h"
 #include "shaders/ShadeDeferredPbr.h.glsl"
 
-#include "Fvog/Texture2.h"
+#include "Fvog/BasicTypes2.h"
 
 #include <glm/gtc/quaternion.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <memory_resource>
 
@@ -15,10 +25,16 @@ namespace Utility
   struct MeshGeometry
   {
     std::pmr::vector<Render::Meshlet> meshlets;
-    std::pmr::vector<Render::Vertex> vertices;
+    std::pmr::vector<Render::QuantizedPosition> positions;
+    std::pmr::vector<Render::VertexAttributes> attributes;
+    std::pmr::vector<glm::vec2> texcoords; // Only filled if the texcoord range is too wide to quantize, in which case VertexAttributes::texcoord is unused
     std::pmr::vector<Render::index_t> remappedIndices; // meshletIndices
     std::pmr::vector<Render::primitive_t> primitives;
     std::pmr::vector<Render::index_t> originalIndices;
+    Render::VertexDequantization dequantization;
+
+    // Identical geometry from different files has the same hash, which lets scenes share it
+    uint64_t contentHash = 0;
   };
 
   struct LoadModelNode
@@ -41,9 +57,92 @@ namespace Utility
       std::optional<size_t> materialIndex;
     };
     std::vector<MeshIndices> meshes;
+    // Set by EXT_mesh_gpu_instancing. If non-empty, each mesh is drawn once per transform (relative to this node).
+    std::vector<glm::mat4> instanceTransforms;
     std::optional<GpuLight> light; // TODO: hold a light without position/direction type safety
   };
 
+  // A decoded (or transcoded) image whose mip levels are ready to be copied into a texture
+  struct ImageData
+  {
+    struct Level
+    {
+      Fvog::Extent3D extent;
+      std::span<const std::byte> data;
+    };
+
+    std::string name;
+    uint64_t contentHash = 0; // Hash of the encoded image and its usage, which lets scenes share identical images from different files
+    Fvog::Format format;
+    std::vector<Level> levels;
+
+    // Set when a metallic-roughness image was stored in two channels, which moves roughness (G) to R and metallic (B) to G
+    bool metallicRoughnessInRg = false;
+
+    // Owns the memory referenced by levels. Type-erased so that pixels can be referenced in-place regardless of which library decoded them.
+    std::shared_ptr<const void> storage;
+
+    [[nodiscard]] size_t SizeBytes() const noexcept;
+  };
+
+  // Receives images from the loader's workers as soon as each one is decoded, so they can be uploaded while the rest of the model is still loading.
+  // The pixels of a published image are moved out of LoadModelResultA::images, which keeps everything else (e.g. the content hash).
+  class DecodedImageQueue
+  {
+  public:
+    struct Entry
+    {
+      size_t imageIndex; // Into LoadModelResultA::images
+      ImageData image;
+    };
+
+    void Push(size_t imageIndex, ImageData image);
+
+    // Returns the images published since the last call, in the order they finished
+    [[nodiscard]] std::vector<Entry> TakeAll();
+
+  private:
+    std::mutex mutex_;
+    std::vector<Entry> entries_;
+  };
+
+  // A material whose textures refer to images in LoadModelResultA::images.
+  // The texture indices in gpuMaterial are only valid once the material has been created with CreateMaterial().
+  struct MaterialData
+  {
+    struct ImageRef
+    {
+      size_t imageIndex;
+      std::string name;
+    };
+
+    Render::GpuMaterial gpuMaterial;
+    std::optional<ImageRef> albedoTexture;
+    std::optional<ImageRef> metallicRoughnessTexture;
+    std::optional<ImageRef> normalTexture;
+    std::optional<ImageRef> occlusionTexture;
+    std::optional<ImageRef> emissiveTexture;
+  };
+
+  // Owns the memory of the mesh geometry of a LoadModelResultA. Each loader thread bump-allocates from its own monotonic arena,
+  // so meshes are built in parallel without contending on an allocator. Everything is freed at once when the arena is destroyed.
+  class GeometryArena
+  {
+  public:
+    // Only the calling thread may allocate from the returned resource.
+    // Each thread remembers the last arena it got, so repeated calls for the same GeometryArena don't take the lock.
+    [[nodiscard]] std::pmr::memory_resource* GetThreadArena();
+
+  private:
+    static inline std::atomic_uint64_t nextId_ = 1;
+
+    // Unlike the address, never reused by another GeometryArena, so a thread's remembered arena can't be mistaken for one of ours
+    const uint64_t id_ = nextId_.fetch_add(1, std::memory_order_relaxed);
+    std::mutex mutex_;
+    std::unordered_map<std::thread::id, std::unique_ptr<std::pmr::monotonic_buffer_resource>> arenas_;
+  };
+
+  // Everything in here lives in CPU memory, so it can be produced on any thread.
   struct LoadModelResultA
   {
     // These nodes are a different type that refer to not-yet-uploaded
@@ -53,18 +152,57 @@ namespace Utility
     std::pmr::vector<LoadModelNode*> rootNodes;
     std::pmr::vector<std::unique_ptr<LoadModelNode>> nodes;
 
+    // Declared before meshGeometries so that it outlives them
+    std::unique_ptr<GeometryArena> geometryArena;
     std::pmr::vector<MeshGeometry> meshGeometries;
-    std::pmr::vector<Render::Material> materials;
-    std::vector<Fvog::Texture> images;
+    std::pmr::vector<MaterialData> materials;
+    std::vector<ImageData> images;
   };
 
   // TODO: maybe customizeable (not recommended though)
   inline constexpr auto maxMeshletIndices = 64u;
   inline constexpr auto maxMeshletPrimitives = 64u;
-  inline constexpr auto meshletConeWeight = 0.0f;
+  inline constexpr auto meshletConeWeight = 0.25f; // Biases meshlets towards having tighter normal cones, which makes them easier to cull
+
+  // Number of meshlets that are merged and simplified together to make the next level of detail
+  inline constexpr auto meshletLodGroupSize = 4u;
+  inline constexpr auto maxMeshletLodLevels = 16u;
 
-  [[nodiscard]] LoadModelResultA LoadModelFromFile(
+  // Returns nothing if the file could not be loaded.
+  // Does not touch the GPU, so it is safe to call from worker threads.
+  [[nodiscard]] std::optional<LoadModelResultA> LoadModelFromFile(
     const std::filesystem::path& fileName,
     const glm::mat4& rootTransform,
-    bool skipMaterials = false);
-}
\ No newline at end of file
+    bool skipMaterials = false,
+    DecodedImageQueue* decodedImages = nullptr);
+
+  struct LoadModelRequest
+  {
+    std::filesystem::path path;
+    glm::mat4 rootTransform{1};
+    bool skipMaterials = false;
+
+    // Reorders each mesh's triangles and vertices for the vertex cache, overdraw, and vertex fetch before meshlets are built
+    bool optimizeVertexOrder = true;
+
+    // If set, every image is published here once it is decoded. Must outlive the load.
+    DecodedImageQueue* decodedImages = nullptr;
+  };
+
+  // Where the time of a LoadModelsFromFiles() call went.
+  // Stage times are wall-clock time, while task times are summed over every worker thread.
+  struct LoadModelStats
+  {
+    using Duration = std::chrono::duration<double, std::milli>;
+
+    Duration parseStage{};       // Parsing glTFs, loading materials, and traversing scenes
+    Duration decodeBuildStage{}; // Decoding images and building mesh geometry
+    Duration imageDecodeTasks{};
+    Duration meshBuildTasks{};
+  };
+
+  // Loads many files as one batch. Parsing, image decoding, and meshlet building from every file share the same pool of workers,
+  // so throughput scales with core count even when the files are small. results[i] is empty if requests[i] failed to load.
+  // Does not touch the GPU, so it is safe to call from worker threads.
+  [[nodiscard]] std::vector<std::optional<LoadModelResultA>> LoadModelsFromFiles(std::span<const LoadModelRequest> requests, LoadModelStats* stats = nullptr);
+}
@@ -0,0 +1,335 @@
+#include "SceneLoaderGpu.h"
+
+#include "Fvog/detail/ApiToEnum2.h"
+#include "Fvog/detail/Common.h"
+#include "Fvog/Rendering2.h"
+#include "Fvog/Buffer2.h"
+
+#include <tracy/Tracy.hpp>
+
+#include <volk.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <execution>
+#include <span>
+#include <vector>
+
+// The GPU stage of the loader. Everything in here must run on the thread that owns the device.
+namespace Utility
+{
+  namespace
+  {
+    // Converts a format to the sRGB version of itself, for use in a texture view
+    Fvog::Format FormatToSrgb(Fvog::Format format)
+    {
+      switch (format)
+      {
+      case Fvog::Format::BC1_RGBA_UNORM: return Fvog::Format::BC1_RGBA_SRGB;
+      case Fvog::Format::BC1_RGB_UNORM:  return Fvog::Format::BC1_RGB_SRGB;
+      case Fvog::Format::BC2_RGBA_UNORM: return Fvog::Format::BC2_RGBA_SRGB;
+      case Fvog::Format::BC3_RGBA_UNORM: return Fvog::Format::BC3_RGBA_SRGB;
+      case Fvog::Format::BC7_RGBA_UNORM: return Fvog::Format::BC7_RGBA_SRGB;
+      case Fvog::Format::R8G8B8A8_UNORM: return Fvog::Format::R8G8B8A8_SRGB;
+      default: return format;
+      }
+    }
+  } // namespace
+
+  StagingRing::StagingRing()
+  {
+    ZoneScoped;
+    using namespace Fvog::detail;
+    auto& device = Fvog::GetDevice();
+
+    CheckVkResult(vkCreateCommandPool(device.device_, Address(VkCommandPoolCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+      .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+      .queueFamilyIndex = device.graphicsQueueFamilyIndex_,
+    }), nullptr, &commandPool_));
+
+    CheckVkResult(vkCreateSemaphore(device.device_, Address(VkSemaphoreCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+      .pNext = Address(VkSemaphoreTypeCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+      }),
+    }), nullptr, &timelineSemaphore_));
+
+    chunks_.resize(chunkCount);
+  }
+
+  StagingRing::~StagingRing()
+  {
+    ZoneScoped;
+    Wait(submitCount_);
+    vkDestroySemaphore(Fvog::GetDevice().device_, timelineSemaphore_, nullptr);
+    vkDestroyCommandPool(Fvog::GetDevice().device_, commandPool_, nullptr);
+  }
+
+  StagingRing::Chunk& StagingRing::Acquire()
+  {
+    ZoneScoped;
+    using namespace Fvog::detail;
+    auto& chunk = chunks_[submitCount_ % chunkCount];
+    Wait(chunk.submitValue);
+
+    if (!chunk.buffer)
+    {
+      chunk.buffer.emplace(Fvog::BufferCreateInfo{.size = chunkSize, .flag = Fvog::BufferFlagThingy::MAP_SEQUENTIAL_WRITE}, "Scene Loader Staging Chunk");
+      CheckVkResult(vkAllocateCommandBuffers(Fvog::GetDevice().device_, Address(VkCommandBufferAllocateInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = commandPool_,
+        .commandBufferCount = 1,
+      }), &chunk.commandBuffer));
+    }
+
+    CheckVkResult(vkResetCommandBuffer(chunk.commandBuffer, 0));
+    CheckVkResult(vkBeginCommandBuffer(chunk.commandBuffer, Address(VkCommandBufferBeginInfo{
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    })));
+    return chunk;
+  }
+
+  void StagingRing::Submit(Chunk& chunk)
+  {
+    ZoneScoped;
+    using namespace Fvog::detail;
+    assert(&chunk == &chunks_[submitCount_ % chunkCount]);
+    CheckVkResult(vkEndCommandBuffer(chunk.commandBuffer));
+
+    chunk.submitValue = ++submitCount_;
+    CheckVkResult(vkQueueSubmit2(Fvog::GetDevice().graphicsQueue_, 1, Address(VkSubmitInfo2{
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+      .commandBufferInfoCount = 1,
+      .pCommandBufferInfos = Address(VkCommandBufferSubmitInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+        .commandBuffer = chunk.commandBuffer,
+      }),
+      .signalSemaphoreInfoCount = 1,
+      .pSignalSemaphoreInfos = Address(VkSemaphoreSubmitInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+        .semaphore = timelineSemaphore_,
+        .value = chunk.submitValue,
+        .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+      }),
+    }), VK_NULL_HANDLE));
+  }
+
+  bool StagingRing::IsComplete(uint64_t submitValue) const
+  {
+    auto value = uint64_t(0);
+    Fvog::detail::CheckVkResult(vkGetSemaphoreCounterValue(Fvog::GetDevice().device_, timelineSemaphore_, &value));
+    return value >= submitValue;
+  }
+
+  void StagingRing::Wait(uint64_t submitValue) const
+  {
+    ZoneScopedN("Wait for staging chunk");
+    if (submitValue == 0)
+    {
+      return;
+    }
+
+    using namespace Fvog::detail;
+    CheckVkResult(vkWaitSemaphores(Fvog::GetDevice().device_, Address(VkSemaphoreWaitInfo{
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+      .semaphoreCount = 1,
+      .pSemaphores = &timelineSemaphore_,
+      .pValues = &submitValue,
+    }), UINT64_MAX));
+  }
+
+  std::vector<Fvog::Texture> UploadImages(StagingRing& ring, std::span<const ImageData> images)
+  {
+    ZoneScoped;
+
+    // Whole block rows of one mip level. Levels that don't fit in a staging chunk are split into several regions.
+    struct UploadRegion
+    {
+      size_t imageIndex;
+      uint32_t level;
+      uint32_t y;
+      Fvog::Extent3D extent;
+      std::span<const std::byte> data;
+      size_t bufferOffset = 0;
+    };
+
+    auto loadedImages = std::vector<Fvog::Texture>();
+    loadedImages.reserve(images.size());
+
+    auto regions = std::vector<UploadRegion>();
+
+    // Create image objects
+    for (const auto& image : images)
+    {
+      ZoneScopedN("Create Image");
+      const auto& baseExtent = image.levels.front().extent;
+      constexpr auto usage = Fvog::TextureUsage::READ_ONLY;
+
+      loadedImages.emplace_back(Fvog::CreateTexture2DMip({baseExtent.width, baseExtent.height}, image.format, static_cast<uint32_t>(image.levels.size()), usage, image.name));
+
+      const auto blockHeight = Fvog::detail::FormatIsBlockCompressed(image.format) ? 4u : 1u;
+      for (uint32_t level = 0; level < image.levels.size(); level++)
+      {
+        const auto& levelData = image.levels[level];
+        const auto& extent    = levelData.extent;
+        assert(extent.depth == 1);
+
+        const auto blockRows    = (extent.height + blockHeight - 1) / blockHeight;
+        const auto blockRowSize = levelData.data.size() / blockRows;
+        assert(blockRowSize <= StagingRing::chunkSize);
+        const auto regionHeight = static_cast<uint32_t>(StagingRing::chunkSize / blockRowSize) * blockHeight;
+
+        if (regionHeight >= extent.height)
+        {
+          regions.emplace_back(UploadRegion{
+            .imageIndex = loadedImages.size() - 1,
+            .level      = level,
+            .y          = 0,
+            .extent     = extent,
+            .data       = levelData.data,
+          });
+          continue;
+        }
+
+        for (uint32_t y = 0; y < extent.height; y += regionHeight)
+        {
+          const auto height = std::min(regionHeight, extent.height - y);
+          regions.emplace_back(UploadRegion{
+            .imageIndex = loadedImages.size() - 1,
+            .level      = level,
+            .y          = y,
+            .extent     = {extent.width, height, 1},
+            .data       = levelData.data.subspan((y / blockHeight) * blockRowSize, ((height + blockHeight - 1) / blockHeight) * blockRowSize),
+          });
+        }
+      }
+    }
+
+    // Stream the regions through the staging ring. Filling a chunk overlaps with the GPU copying out of the previous ones.
+    for (size_t firstRegion = 0; firstRegion < regions.size();)
+    {
+      ZoneScopedN("Upload staging chunk");
+
+      // Pack as many regions into the chunk as will fit
+      auto lastRegion  = firstRegion;
+      auto chunkOffset = size_t(0);
+      while (lastRegion < regions.size() && chunkOffset + regions[lastRegion].data.size() <= StagingRing::chunkSize)
+      {
+        regions[lastRegion].bufferOffset = chunkOffset;
+        chunkOffset += (regions[lastRegion].data.size() + StagingRing::regionAlign - 1) & ~(StagingRing::regionAlign - 1);
+        lastRegion++;
+      }
+      const auto chunkRegions = std::span(regions).subspan(firstRegion, lastRegion - firstRegion);
+
+      auto& chunk = ring.Acquire();
+
+      {
+        ZoneScopedN("Memcpy to buffer");
+        std::for_each(std::execution::par,
+          chunkRegions.begin(),
+          chunkRegions.end(),
+          [&](const UploadRegion& region)
+          { std::memcpy(static_cast<std::byte*>(chunk.buffer->GetMappedMemory()) + region.bufferOffset, region.data.data(), region.data.size()); });
+      }
+
+      auto ctx = Fvog::Context(chunk.commandBuffer);
+
+      // Later submissions on the queue are ordered after these barriers
+      if (firstRegion == 0)
+      {
+        for (auto& loadedImage : loadedImages)
+        {
+          ctx.ImageBarrierDiscard(loadedImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        }
+      }
+
+      for (const auto& region : chunkRegions)
+      {
+        vkCmdCopyBufferToImage2(chunk.commandBuffer, Fvog::detail::Address(VkCopyBufferToImageInfo2{
+          .sType = VK_STRUCTURE_TYPE_COPY_BUFFER_TO_IMAGE_INFO_2,
+          .srcBuffer = chunk.buffer->Handle(),
+          .dstImage = loadedImages[region.imageIndex].Image(),
+          .dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          .regionCount = 1,
+          .pRegions = Fvog::detail::Address(VkBufferImageCopy2{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2,
+            .bufferOffset = region.bufferOffset,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = VkImageSubresourceLayers{
+              .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+              .mipLevel = region.level,
+              .layerCount = 1,
+            },
+            .imageOffset = {0, static_cast<int32_t>(region.y), 0},
+            .imageExtent = {region.extent.width, region.extent.height, region.extent.depth},
+          }),
+        }));
+      }
+
+      // Transition every loaded image to READ_ONLY after the last copy
+      if (lastRegion == regions.size())
+      {
+        for (auto& loadedImage : loadedImages)
+        {
+          ctx.ImageBarrier(loadedImage, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL);
+        }
+      }
+
+      ring.Submit(chunk);
+      firstRegion = lastRegion;
+    }
+
+    return loadedImages;
+  }
+
+  Render::Material CreateMaterial(const MaterialData& material, std::span<const Fvog::Texture> textures)
+  {
+    ZoneScoped;
+    auto MakeTextureSampler = [&](const MaterialData::ImageRef& imageRef, bool isSrgb)
+    {
+      const auto& image = textures[imageRef.imageIndex];
+      const auto format = isSrgb ? FormatToSrgb(image.GetCreateInfo().format) : image.GetCreateInfo().format;
+      return Render::CombinedTextureSampler{image.CreateFormatView(format, imageRef.name)};
+    };
+
+    auto result = Render::Material{.gpuMaterial = material.gpuMaterial};
+
+    if (material.occlusionTexture)
+    {
+      result.occlusionTextureSampler = MakeTextureSampler(*material.occlusionTexture, false);
+      result.gpuMaterial.occlusionTextureIndex = result.occlusionTextureSampler->texture.GetSampledResourceHandle().index;
+    }
+
+    if (material.emissiveTexture)
+    {
+      result.emissiveTextureSampler = MakeTextureSampler(*material.emissiveTexture, true);
+      result.gpuMaterial.emissionTextureIndex = result.emissiveTextureSampler->texture.GetSampledResourceHandle().index;
+    }
+
+    if (material.normalTexture)
+    {
+      result.normalTextureSampler = MakeTextureSampler(*material.normalTexture, false);
+      result.gpuMaterial.normalTextureIndex = result.normalTextureSampler->texture.GetSampledResourceHandle().index;
+    }
+
+    if (material.albedoTexture)
+    {
+      result.albedoTextureSampler = MakeTextureSampler(*material.albedoTexture, true);
+      result.gpuMaterial.baseColorTextureIndex = result.albedoTextureSampler->texture.GetSampledResourceHandle().index;
+    }
+
+    if (material.metallicRoughnessTexture)
+    {
+      result.metallicRoughnessTextureSampler = MakeTextureSampler(*material.metallicRoughnessTexture, false);
+      result.gpuMaterial.metallicRoughnessTextureIndex = result.metallicRoughnessTextureSampler->texture.GetSampledResourceHandle().index;
+    }
+
+    return result;
+  }
+} // namespace Utility
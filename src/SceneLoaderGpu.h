@@ -0,0 +1,96 @@
+#pragma once
+#include "Renderables.h"
+#include "SceneLoader.h"
+
+#include "Fvog/Buffer2.h"
+#include "Fvog/Texture2.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+// The GPU stage of the loader (SceneLoaderGpu.cpp). It is kept out of SceneLoader.h so that the CPU stage can be built without the device.
+
+namespace Render
+{
+  struct CombinedTextureSampler
+  {
+    // Fwog::TextureView texture;
+    // Fwog::SamplerState sampler;
+
+    Fvog::TextureView texture;
+  };
+
+  struct Material
+  {
+    bool operator==(const Material& other) const noexcept
+    {
+      return gpuMaterial == other.gpuMaterial;
+    }
+
+    GpuMaterial gpuMaterial{};
+    std::optional<CombinedTextureSampler> albedoTextureSampler;
+    std::optional<CombinedTextureSampler> metallicRoughnessTextureSampler;
+    std::optional<CombinedTextureSampler> normalTextureSampler;
+    std::optional<CombinedTextureSampler> occlusionTextureSampler;
+    std::optional<CombinedTextureSampler> emissiveTextureSampler;
+  };
+}
+
+// Everything below creates GPU resources and must be called on the thread that owns the device.
+namespace Utility
+{
+  // A fixed number of host-visible staging chunks that are recycled as soon as the GPU has finished copying out of them.
+  // While the GPU copies out of one chunk, the next one is being filled, so uploads stream with bounded memory.
+  // Meant to live as long as the scene it uploads to. Chunks are only allocated once they are first needed.
+  class StagingRing
+  {
+  public:
+    static constexpr size_t chunkSize   = size_t(64) << 20;
+    static constexpr size_t chunkCount  = 3;
+    static constexpr size_t regionAlign = 16; // Buffer offsets for image copies must be aligned to the texel block size
+
+    struct Chunk
+    {
+      std::optional<Fvog::Buffer> buffer;
+      VkCommandBuffer commandBuffer{};
+      uint64_t submitValue = 0; // Value of the timeline semaphore once the GPU is done with this chunk
+    };
+
+    StagingRing();
+    ~StagingRing();
+
+    StagingRing(const StagingRing&)            = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+
+    // Waits for the GPU to finish with the least-recently submitted chunk, then begins recording its commands
+    [[nodiscard]] Chunk& Acquire();
+
+    // Submits the commands of the chunk returned by the last call to Acquire() without waiting for them
+    void Submit(Chunk& chunk);
+
+    // Value that IsComplete() and Wait() accept to check for everything submitted so far
+    [[nodiscard]] uint64_t GetLastSubmitValue() const noexcept
+    {
+      return submitCount_;
+    }
+
+    [[nodiscard]] bool IsComplete(uint64_t submitValue) const;
+    void Wait(uint64_t submitValue) const;
+
+  private:
+    VkCommandPool commandPool_{};
+    VkSemaphore timelineSemaphore_{};
+    uint64_t submitCount_ = 0;
+    std::vector<Chunk> chunks_;
+  };
+
+  // Records and submits the copies without waiting for them. The textures must not be used until
+  // ring.IsComplete(ring.GetLastSubmitValue()) is true.
+  [[nodiscard]] std::vector<Fvog::Texture> UploadImages(StagingRing& ring, std::span<const ImageData> images);
+
+  // textures[i] must correspond to LoadModelResultA::images[i]
+  [[nodiscard]] Render::Material CreateMaterial(const MaterialData& material, std::span<const Fvog::Texture> textures);
+}
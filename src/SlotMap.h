@@ -0,0 +1,203 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Utility
+{
+  // Stores values contiguously and hands out keys that stay valid until their value is erased.
+  // A key holds a slot index in its low 32 bits and the slot's generation in its high 32 bits, so a lookup is two array reads,
+  // and the key of an erased value is detected instead of referring to whatever reuses its slot.
+  // Keys are never 0, which render IDs reserve for null.
+  // Inserting and erasing invalidate references to values, but not keys.
+  template<typename T>
+  class SlotMap
+  {
+  public:
+    [[nodiscard]] uint64_t Insert(T value)
+    {
+      auto slotIndex = firstFreeSlot_;
+      if (slotIndex != noSlot)
+      {
+        firstFreeSlot_ = slots_[slotIndex].index;
+      }
+      else
+      {
+        slotIndex = static_cast<uint32_t>(slots_.size());
+        slots_.push_back({.generation = 1});
+      }
+
+      auto& slot = slots_[slotIndex];
+      slot.index = static_cast<uint32_t>(values_.size());
+      values_.push_back(std::move(value));
+      valueSlots_.push_back(slotIndex);
+      return MakeKey(slotIndex, slot.generation);
+    }
+
+    void Erase(uint64_t key)
+    {
+      assert(Contains(key));
+      const auto slotIndex  = static_cast<uint32_t>(key);
+      auto& slot            = slots_[slotIndex];
+      const auto valueIndex = slot.index;
+
+      // Keep values contiguous by moving the last one into the hole
+      if (valueIndex != values_.size() - 1)
+      {
+        values_[valueIndex]                   = std::move(values_.back());
+        valueSlots_[valueIndex]               = valueSlots_.back();
+        slots_[valueSlots_[valueIndex]].index = valueIndex;
+      }
+      values_.pop_back();
+      valueSlots_.pop_back();
+
+      // Invalidates outstanding keys. Generation 0 is skipped so keys can't be 0.
+      slot.generation = slot.generation == UINT32_MAX ? 1 : slot.generation + 1;
+      slot.index      = firstFreeSlot_;
+      firstFreeSlot_  = slotIndex;
+    }
+
+    [[nodiscard]] bool Contains(uint64_t key) const noexcept
+    {
+      const auto slotIndex = static_cast<uint32_t>(key);
+      return slotIndex < slots_.size() && slots_[slotIndex].generation == static_cast<uint32_t>(key >> 32);
+    }
+
+    // Returns nullptr if the key's value was erased
+    [[nodiscard]] T* Find(uint64_t key) noexcept
+    {
+      return Contains(key) ? &values_[slots_[static_cast<uint32_t>(key)].index] : nullptr;
+    }
+
+    [[nodiscard]] const T* Find(uint64_t key) const noexcept
+    {
+      return Contains(key) ? &values_[slots_[static_cast<uint32_t>(key)].index] : nullptr;
+    }
+
+    [[nodiscard]] T& at(uint64_t key) noexcept
+    {
+      assert(Contains(key));
+      return values_[slots_[static_cast<uint32_t>(key)].index];
+    }
+
+    [[nodiscard]] const T& at(uint64_t key) const noexcept
+    {
+      assert(Contains(key));
+      return values_[slots_[static_cast<uint32_t>(key)].index];
+    }
+
+    [[nodiscard]] std::span<T> Values() noexcept
+    {
+      return values_;
+    }
+
+    [[nodiscard]] std::span<const T> Values() const noexcept
+    {
+      return values_;
+    }
+
+    [[nodiscard]] size_t size() const noexcept
+    {
+      return values_.size();
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+      return values_.empty();
+    }
+
+    void clear()
+    {
+      // Bump the generation of every slot so no key from before the clear is valid after it
+      while (!values_.empty())
+      {
+        Erase(MakeKey(valueSlots_.back(), slots_[valueSlots_.back()].generation));
+      }
+    }
+
+    // Iterates over (key, value) pairs in storage order
+    template<bool IsConst>
+    class Iterator
+    {
+    public:
+      using Map             = std::conditional_t<IsConst, const SlotMap, SlotMap>;
+      using value_type      = std::pair<uint64_t, std::conditional_t<IsConst, const T&, T&>>;
+      using difference_type = std::ptrdiff_t;
+
+      Iterator() = default;
+      Iterator(Map* map, size_t index) : map_(map), index_(index) {}
+
+      value_type operator*() const
+      {
+        const auto slotIndex = map_->valueSlots_[index_];
+        return {MakeKey(slotIndex, map_->slots_[slotIndex].generation), map_->values_[index_]};
+      }
+
+      Iterator& operator++()
+      {
+        index_++;
+        return *this;
+      }
+
+      Iterator operator++(int)
+      {
+        auto copy = *this;
+        index_++;
+        return copy;
+      }
+
+      bool operator==(const Iterator& other) const noexcept
+      {
+        return index_ == other.index_;
+      }
+
+    private:
+      Map* map_     = nullptr;
+      size_t index_ = 0;
+    };
+
+    Iterator<false> begin() noexcept
+    {
+      return {this, 0};
+    }
+
+    Iterator<false> end() noexcept
+    {
+      return {this, values_.size()};
+    }
+
+    Iterator<true> begin() const noexcept
+    {
+      return {this, 0};
+    }
+
+    Iterator<true> end() const noexcept
+    {
+      return {this, values_.size()};
+    }
+
+  private:
+    static constexpr uint32_t noSlot = UINT32_MAX;
+
+    static uint64_t MakeKey(uint32_t slotIndex, uint32_t generation) noexcept
+    {
+      return (uint64_t(generation) << 32) | slotIndex;
+    }
+
+    struct Slot
+    {
+      uint32_t generation = 1;
+      uint32_t index      = 0; // Index of the value while the slot is occupied, otherwise the next free slot
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<T> values_;
+    std::vector<uint32_t> valueSlots_; // Slot of each value, used to fix up the slot of a value when it is moved
+    uint32_t firstFreeSlot_ = noSlot;
+  };
+} // namespace Utility
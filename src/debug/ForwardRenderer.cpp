@@ -2,6 +2,7 @@
 #include "RendererUtilities.h"
 #include "Fvog/Rendering2.h"
 #include "Application.h"
+#include "SceneLoader.h"
 #include <vector>
 #include <tracy/Tracy.hpp>
 
@@ -98,16 +99,22 @@ namespace Debug
       auto uniforms = Uniforms{
         .clipFromWorld       = view.clipFromWorld,
         .worldFromObject     = draw.worldFromObject,
+        .positionBufferAddress = draw.positionBufferAddress,
         .vertexBufferAddress = draw.vertexBufferAddress,
+        .texcoordBufferAddress = draw.texcoordBufferAddress.value_or(0),
+        .uvOffset = draw.uvOffset,
+        .uvScale = draw.uvScale,
         .materialId = draw.materialId,
         .materialBufferIndex = materialBuffer.GetResourceHandle().index,
         .samplerIndex = sampler.GetResourceHandle().index,
+        .fullPrecisionTexcoords = draw.texcoordBufferAddress.has_value(),
+        .geometryBufferIndex = draw.geometryBuffer->GetResourceHandle().index,
+        .meshletOffset = draw.meshletOffset,
       };
       std::memcpy(uniformBuffer_.value().GetMappedMemory(), &uniforms, sizeof(Uniforms));
 
-      ctx.BindIndexBuffer(*draw.indexBuffer, draw.indexBufferOffset, VK_INDEX_TYPE_UINT32);
       ctx.SetPushConstants(uniformBuffer_.value().GetResourceHandle().index);
-      ctx.DrawIndexed(draw.indexCount, 1, 0, 0, 0);
+      ctx.Draw(draw.meshletCount * Utility::maxMeshletPrimitives * 3, 1, 0, 0);
     }
     ctx.EndRendering();
 
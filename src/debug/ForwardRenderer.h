@@ -6,6 +6,7 @@
 #include "PipelineManager.h"
 
 #include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
 
 #include <vulkan/vulkan_core.h>
 
@@ -31,11 +32,15 @@ namespace Debug
 
     struct Drawable
     {
+      VkDeviceAddress positionBufferAddress{};
       VkDeviceAddress vertexBufferAddress{};
-      Fvog::Buffer* indexBuffer{};
-      VkDeviceSize indexBufferOffset{};
-      uint32_t indexCount;
-      glm::mat4 worldFromObject{};
+      std::optional<VkDeviceAddress> texcoordBufferAddress; // Full-precision texcoords, which take the place of the quantized ones
+      Fvog::Buffer* geometryBuffer{}; // Holds the meshlets that triangles are pulled from
+      uint32_t meshletOffset{};       // Of the geometry's first meshlet
+      uint32_t meshletCount{};        // Of full-detail meshlets, which cover every triangle of the mesh exactly once
+      glm::mat4 worldFromObject{}; // Includes the dequantization transform of the positions
+      glm::vec2 uvOffset{};
+      glm::vec2 uvScale{1};
       uint32_t materialId{};
     };
 
@@ -52,10 +57,17 @@ namespace Debug
     {
       glm::mat4 clipFromWorld;
       glm::mat4 worldFromObject;
+      VkDeviceAddress positionBufferAddress;
       VkDeviceAddress vertexBufferAddress;
+      VkDeviceAddress texcoordBufferAddress;
+      glm::vec2 uvOffset;
+      glm::vec2 uvScale;
       uint32_t materialId;
       uint32_t materialBufferIndex;
       uint32_t samplerIndex;
+      uint32_t fullPrecisionTexcoords;
+      uint32_t geometryBufferIndex;
+      uint32_t meshletOffset;
     };
 
     // Pipeline is recreated if last RT format doesn't match
@@ -0,0 +1,194 @@
+// frogLoadBench: runs the CPU stage of the scene loader on one or more glTF files and reports where the time and memory went.
+// No Vulkan device is created, so this can run on build machines without a GPU.
+//
+// Usage: frogLoadBench [--runs N] [--cold] [--cache DIR] [--skip-materials] [--no-vertex-order] <file.gltf|file.glb>...
+
+#include "Paths.h"
+#include "SceneLoader.h"
+
+#include <charconv>
+#include <cstdio>
+#include <filesystem>
+#include <numeric>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+  #define NOMINMAX
+  #include <Windows.h>
+  #include <Psapi.h>
+#else
+  #include <sys/resource.h>
+#endif
+
+namespace
+{
+  std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path() / "frogLoadBenchCache";
+
+  size_t GetPeakMemoryUsage()
+  {
+#ifdef _WIN32
+    auto counters = PROCESS_MEMORY_COUNTERS{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize;
+#else
+    auto usage = rusage{};
+    getrusage(RUSAGE_SELF, &usage);
+  #ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss); // Bytes
+  #else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024; // Kilobytes
+  #endif
+#endif
+  }
+
+  // Faults from first touching freshly allocated memory make up much of this, so it shows how well the loader reuses memory
+  size_t GetPageFaultCount()
+  {
+#ifdef _WIN32
+    auto counters = PROCESS_MEMORY_COUNTERS{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PageFaultCount;
+#else
+    auto usage = rusage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_minflt + usage.ru_majflt);
+#endif
+  }
+
+  double ToMiB(size_t bytes)
+  {
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+  }
+
+  int PrintUsage()
+  {
+    std::fprintf(stderr, "Usage: frogLoadBench [--runs N] [--cold] [--cache DIR] [--skip-materials] [--no-vertex-order] <file.gltf|file.glb>...\n");
+    std::fprintf(stderr, "  --runs N           Load the files N times (default 1)\n");
+    std::fprintf(stderr, "  --cold             Clear the asset cache before every run\n");
+    std::fprintf(stderr, "  --cache DIR        Asset cache directory (default: %s)\n", cacheDirectory.string().c_str());
+    std::fprintf(stderr, "  --skip-materials   Do not load materials or images\n");
+    std::fprintf(stderr, "  --no-vertex-order  Do not optimize the vertex order of meshes\n");
+    return 1;
+  }
+} // namespace
+
+int main(int argc, char** argv)
+{
+  auto runs                = 1;
+  auto cold                = false;
+  auto skipMaterials       = false;
+  auto optimizeVertexOrder = true;
+  auto requests            = std::vector<Utility::LoadModelRequest>();
+
+  for (int i = 1; i < argc; i++)
+  {
+    const auto arg = std::string_view(argv[i]);
+    if (arg == "--runs" && i + 1 < argc)
+    {
+      const auto value = std::string_view(argv[++i]);
+      if (std::from_chars(value.data(), value.data() + value.size(), runs).ec != std::errc() || runs < 1)
+      {
+        return PrintUsage();
+      }
+    }
+    else if (arg == "--cold")
+    {
+      cold = true;
+    }
+    else if (arg == "--cache" && i + 1 < argc)
+    {
+      cacheDirectory = argv[++i];
+    }
+    else if (arg == "--skip-materials")
+    {
+      skipMaterials = true;
+    }
+    else if (arg == "--no-vertex-order")
+    {
+      optimizeVertexOrder = false;
+    }
+    else if (arg.starts_with("--"))
+    {
+      return PrintUsage();
+    }
+    else
+    {
+      requests.emplace_back(Utility::LoadModelRequest{.path = argv[i]});
+    }
+  }
+
+  if (requests.empty())
+  {
+    return PrintUsage();
+  }
+
+  // Options apply to every file, regardless of where they appear
+  for (auto& request : requests)
+  {
+    request.skipMaterials       = skipMaterials;
+    request.optimizeVertexOrder = optimizeVertexOrder;
+  }
+
+  // The default cache lives in the asset directory, which may not exist where this runs
+  SetCacheDirectory(cacheDirectory);
+
+  std::printf("%-4s %10s %10s %10s %10s %10s %12s\n", "run", "total ms", "parse ms", "decode ms", "images ms", "meshes ms", "page faults");
+
+  for (int run = 0; run < runs; run++)
+  {
+    if (cold)
+    {
+      auto ec = std::error_code();
+      std::filesystem::remove_all(cacheDirectory, ec);
+    }
+
+    const auto pageFaultsBefore = GetPageFaultCount();
+    auto stats                  = Utility::LoadModelStats{};
+    auto results                = Utility::LoadModelsFromFiles(requests, &stats);
+    const auto pageFaults       = GetPageFaultCount() - pageFaultsBefore;
+
+    std::printf("%-4d %10.2f %10.2f %10.2f %10.2f %10.2f %12zu\n",
+      run,
+      (stats.parseStage + stats.decodeBuildStage).count(),
+      stats.parseStage.count(),
+      stats.decodeBuildStage.count(),
+      stats.imageDecodeTasks.count(),
+      stats.meshBuildTasks.count(),
+      pageFaults);
+
+    // Only describe the output once, since every run produces the same thing
+    if (run != runs - 1)
+    {
+      continue;
+    }
+
+    size_t failed = 0, images = 0, imageBytes = 0, meshes = 0, meshlets = 0, vertices = 0, triangles = 0;
+    for (const auto& result : results)
+    {
+      if (!result)
+      {
+        failed++;
+        continue;
+      }
+
+      images += result->images.size();
+      imageBytes += std::transform_reduce(result->images.begin(), result->images.end(), size_t(0), std::plus{}, [](const Utility::ImageData& image) { return image.SizeBytes(); });
+      meshes += result->meshGeometries.size();
+      for (const auto& meshGeometry : result->meshGeometries)
+      {
+        meshlets += meshGeometry.meshlets.size();
+        vertices += meshGeometry.positions.size();
+        triangles += meshGeometry.originalIndices.size() / 3;
+      }
+    }
+
+    std::printf("\nFiles: %zu (%zu failed)\n", requests.size(), failed);
+    std::printf("Images: %zu (%.2f MiB)\n", images, ToMiB(imageBytes));
+    std::printf("Meshes: %zu, meshlets: %zu, vertices: %zu, triangles: %zu\n", meshes, meshlets, vertices, triangles);
+  }
+
+  std::printf("Peak memory: %.2f MiB\n", ToMiB(GetPeakMemoryUsage()));
+
+  return 0;
+}